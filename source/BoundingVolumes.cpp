@@ -0,0 +1,118 @@
+#include "pch.h"
+#include "BoundingVolumes.h"
+
+namespace dae {
+	Vector3 AABB::GetCenter() const
+	{
+		return (min + max) * 0.5f;
+	}
+
+	Vector3 AABB::GetExtents() const
+	{
+		return (max - min) * 0.5f;
+	}
+
+	AABB AABB::FromPoints(const std::vector<Vector3>& points)
+	{
+		if (points.empty()) {
+			return AABB{};
+		}
+
+		AABB box{ points[0], points[0] };
+		for (const Vector3& point : points) {
+			box.min.x = std::min(box.min.x, point.x);
+			box.min.y = std::min(box.min.y, point.y);
+			box.min.z = std::min(box.min.z, point.z);
+			box.max.x = std::max(box.max.x, point.x);
+			box.max.y = std::max(box.max.y, point.y);
+			box.max.z = std::max(box.max.z, point.z);
+		}
+		return box;
+	}
+
+	AABB AABB::Transform(const AABB& box, const Matrix& matrix)
+	{
+		//Transform the center and project the extents on the absolute axes of the matrix
+		const Vector3 center = matrix.TransformPoint(box.GetCenter());
+		const Vector3 extents = box.GetExtents();
+
+		const Vector3 axisX = matrix.GetAxisX();
+		const Vector3 axisY = matrix.GetAxisY();
+		const Vector3 axisZ = matrix.GetAxisZ();
+		const Vector3 newExtents{
+			std::abs(axisX.x) * extents.x + std::abs(axisY.x) * extents.y + std::abs(axisZ.x) * extents.z,
+			std::abs(axisX.y) * extents.x + std::abs(axisY.y) * extents.y + std::abs(axisZ.y) * extents.z,
+			std::abs(axisX.z) * extents.x + std::abs(axisY.z) * extents.y + std::abs(axisZ.z) * extents.z
+		};
+		return AABB{ center - newExtents, center + newExtents };
+	}
+
+	BoundingSphere CreateBoundingSphere(const std::vector<Vector3>& points, const AABB& box)
+	{
+		BoundingSphere sphere{ box.GetCenter(), 0.f };
+		float maxSqrDistance{};
+		for (const Vector3& point : points) {
+			maxSqrDistance = std::max(maxSqrDistance, (point - sphere.center).SqrMagnitude());
+		}
+		sphere.radius = sqrtf(maxSqrDistance);
+		return sphere;
+	}
+
+	BoundingSphere TransformBoundingSphere(const BoundingSphere& sphere, const Matrix& matrix)
+	{
+		const float maxSqrScale = std::max(matrix.GetAxisX().SqrMagnitude(), std::max(matrix.GetAxisY().SqrMagnitude(), matrix.GetAxisZ().SqrMagnitude()));
+		return BoundingSphere{ matrix.TransformPoint(sphere.center), sphere.radius * sqrtf(maxSqrScale) };
+	}
+
+	Frustum Frustum::FromViewProjection(const Matrix& viewProjectionMatrix)
+	{
+		//Row vectors are multiplied with the matrix, so the planes are made from the columns
+		//Clip space is -w <= x, y <= w and 0 <= z <= w
+		const Matrix& m = viewProjectionMatrix;
+		const Vector4 column0{ m[0].x, m[1].x, m[2].x, m[3].x };
+		const Vector4 column1{ m[0].y, m[1].y, m[2].y, m[3].y };
+		const Vector4 column2{ m[0].z, m[1].z, m[2].z, m[3].z };
+		const Vector4 column3{ m[0].w, m[1].w, m[2].w, m[3].w };
+
+		Frustum frustum{};
+		frustum.planes[0] = column3 + column0;
+		frustum.planes[1] = column3 - column0;
+		frustum.planes[2] = column3 + column1;
+		frustum.planes[3] = column3 - column1;
+		frustum.planes[4] = column2;
+		frustum.planes[5] = column3 - column2;
+
+		//Normalize so the distance to a plane is in world units
+		for (Vector4& plane : frustum.planes) {
+			const float length = plane.GetXYZ().Magnitude();
+			plane = plane * (1.f / length);
+		}
+		return frustum;
+	}
+
+	bool Frustum::IsVisible(const BoundingSphere& sphere) const
+	{
+		for (const Vector4& plane : planes) {
+			if (Vector3::Dot(plane.GetXYZ(), sphere.center) + plane.w < -sphere.radius) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool Frustum::IsVisible(const AABB& box) const
+	{
+		//Only the corner furthest along the plane normal has to be tested
+		for (const Vector4& plane : planes) {
+			const Vector3 positiveCorner{
+				plane.x >= 0.f ? box.max.x : box.min.x,
+				plane.y >= 0.f ? box.max.y : box.min.y,
+				plane.z >= 0.f ? box.max.z : box.min.z
+			};
+			if (Vector3::Dot(plane.GetXYZ(), positiveCorner) + plane.w < 0.f) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include "Vector3.h"
+#include "Vector4.h"
+#include "Matrix.h"
+
+namespace dae
+{
+	struct BoundingSphere
+	{
+		Vector3 center{};
+		float radius{};
+	};
+
+	//Axis aligned bounding box
+	struct AABB
+	{
+		Vector3 min{};
+		Vector3 max{};
+
+		Vector3 GetCenter() const;
+		Vector3 GetExtents() const;
+
+		static AABB FromPoints(const std::vector<Vector3>& points);
+		//AABB around the transformed box, stays axis aligned
+		static AABB Transform(const AABB& box, const Matrix& matrix);
+	};
+
+	//Smallest sphere around the points with the center of their AABB as center
+	BoundingSphere CreateBoundingSphere(const std::vector<Vector3>& points, const AABB& box);
+	//Sphere around the transformed sphere, the radius uses the largest scale axis
+	BoundingSphere TransformBoundingSphere(const BoundingSphere& sphere, const Matrix& matrix);
+
+	//Planes of the view frustum in world space, the normals point inwards
+	struct Frustum
+	{
+		//Left, Right, Bottom, Top, Near, Far
+		//xyz is the plane normal, w the distance
+		Vector4 planes[6]{};
+
+		//Works with a world view projection matrix as well, then the planes are in object space
+		static Frustum FromViewProjection(const Matrix& viewProjectionMatrix);
+
+		bool IsVisible(const BoundingSphere& sphere) const;
+		bool IsVisible(const AABB& box) const;
+	};
+}
@@ -1,7 +1,9 @@
 #pragma once
 #include <cassert>
+#if !defined(DAE_SOFTWARE_ONLY)
 #include <SDL_keyboard.h>
 #include <SDL_mouse.h>
+#endif
 
 #include "Math.h"
 #include "Timer.h"
@@ -61,8 +63,8 @@ namespace dae
 			up = Vector3::Cross(forward, right).Normalized();
 
 			invViewMatrix = Matrix(Vector4(right, 0), Vector4(up, 0), Vector4(forward, 0), Vector4(origin, 1));
-			//Inverse(ONB) => ViewMatrix
-			viewMatrix = Matrix::Inverse(invViewMatrix);
+			//Inverse(ONB) => ViewMatrix, the ONB only rotates and translates
+			viewMatrix = Matrix::InverseRigid(invViewMatrix);
 			//ViewMatrix => Matrix::CreateLookAtLH(...) [not implemented yet]
 			//DirectX Implementation => https://learn.microsoft.com/en-us/windows/win32/direct3d9/d3dxmatrixlookatlh
 		}
@@ -83,6 +85,8 @@ namespace dae
 			//Movementspeed set to normal
 			movementSpeed = normalMovementSpeed;
 
+			//The software renderer library has no input, the application that embeds it moves the camera itself
+#if !defined(DAE_SOFTWARE_ONLY)
 			//Keyboard Input
 			const uint8_t* pKeyboardState = SDL_GetKeyboardState(nullptr);
 			if (pKeyboardState[SDL_SCANCODE_LSHIFT]) {
@@ -116,6 +120,9 @@ namespace dae
 				origin += mouseY / 5.f * forward * movementSpeed * deltaTime;
 				totalYaw += mouseX * rotationSpeed * deltaTime;
 			}
+#else
+			(void)deltaTime;
+#endif
 			//Update Matrices
 			CalculateViewMatrix();
 			CalculateProjectionMatrix();
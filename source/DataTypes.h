@@ -4,7 +4,11 @@ using namespace dae;
 
 #include "Math.h"
 #include "vector"
-#include "Texture.h"
+#include "TextureManager.h"
+#include "BoundingVolumes.h"
+#include "Meshlet.h"
+#include "IndexBuffer.h"
+#include "FrameArena.h"
 
 
 struct Vertex_In
@@ -19,6 +23,19 @@ struct Vertex_In
 	}
 };
 
+//Compact form of Vertex_In, 18 bytes instead of 44, decoded when the vertices are transformed
+struct QuantizedVertex
+{
+	//Position inside the bounds of the mesh, 0 is the minimum and 65535 the maximum of an axis
+	uint16_t position[3];
+	//Half floats, UVs can lie outside of 0 to 1
+	uint16_t uv[2];
+	//Octahedral unit vectors as snorm16
+	int16_t normal[2];
+	//No handedness is stored, the renderers build the binormal as cross(normal, tangent) for every vertex format
+	int16_t tangent[2];
+};
+
 struct Vertex_Out
 {
 	Vector4 position{};
@@ -26,6 +43,7 @@ struct Vertex_Out
 	Vector3 normal{};
 	Vector3 tangent{};
 	Vector3 viewDirection{};
+	Vector3 worldPosition{};
 
 	bool operator==(Vertex_Out other) {
 		return other.position == position;
@@ -38,28 +56,30 @@ enum class PrimitiveTopology
 	TriangleStrip
 };
 
-struct Mesh {
-	Mesh(std::vector<Vertex_In>& verticesIn, std::vector<uint32_t>& indicesIn, Vector3& translation, Vector3& scale,
-		float yawRotation, std::vector<Texture*> pTexturesIn) {
-		vertices = verticesIn;
-		indices = indicesIn;
+//Simplified version of a mesh, with its own vertices
+struct MeshLOD {
+	std::vector<Vertex_In> vertices{};
+	std::vector<QuantizedVertex> quantizedVertices{};
+	IndexBuffer indices{};
+	//Strip of every meshlet, see Stripifier
+	IndexBuffer stripIndices{};
+	std::vector<Meshlet> meshlets{};
+	//Largest quadric error of the collapses that made this level, in object space units
+	//That is the root mean square distance of a merged vertex to the planes of the triangles it replaced, weighted by their area,
+	//an estimate of how far the level is from the full detail mesh and not an upper bound on it
+	float error{};
+};
+
+//Transform of one copy of a mesh, the vertices, indices and textures are shared by all instances
+struct MeshInstance {
+	MeshInstance(const Vector3& translation, const Vector3& scale, float yawRotation, const AABB& localBoxIn, const BoundingSphere& localSphereIn) {
+		localBox = localBoxIn;
+		localSphere = localSphereIn;
 		Translate(translation);
 		Scale(scale);
 		RotateY(yawRotation);
-		pTextures = pTexturesIn;
 	}
 
-	~Mesh() {
-		//Delete all the textures
-		for (auto pTexture : pTextures) {
-			delete pTexture;
-			pTexture = nullptr;
-		}
-	}
-
-	std::vector<Vertex_In> vertices{};
-	std::vector<uint32_t> indices{};
-
 	dae::Matrix worldMatrix{};
 
 	dae::Matrix translationTransform{};
@@ -67,8 +87,14 @@ struct Mesh {
 	dae::Matrix rotationTransform{};
 	float totalYaw{};
 
-	//Diffuse, Normal, Specular, Glossiness
-	std::vector<dae::Texture*> pTextures{};
+	//Bounds of the mesh, the world bounds follow the world matrix
+	dae::AABB localBox{};
+	dae::BoundingSphere localSphere{};
+	dae::AABB worldBox{};
+	dae::BoundingSphere worldSphere{};
+
+	//Goes up every time the world matrix changes, so cached world space data can tell when it is stale
+	uint32_t worldVersion{};
 
 	void Translate(const dae::Vector3& translation) {
 		translationTransform = Matrix::CreateTranslation(translation);
@@ -86,7 +112,131 @@ struct Mesh {
 
 	void UpdateWorldMatrix() {
 		worldMatrix = scaleTransform * rotationTransform * translationTransform;
+		worldBox = AABB::Transform(localBox, worldMatrix);
+		worldSphere = TransformBoundingSphere(localSphere, worldMatrix);
+		++worldVersion;
+	}
+};
+
+struct Mesh {
+	Mesh(std::vector<Vertex_In>& verticesIn, std::vector<uint32_t>& indicesIn, Vector3& translation, Vector3& scale,
+		float yawRotation, std::vector<TextureHandle> pTexturesIn, bool isTransparentIn = false) {
+		vertices = verticesIn;
+		pTextures = pTexturesIn;
+		isTransparent = isTransparentIn;
+		BuildClusters(indicesIn);
+		//The mesh always has at least one instance
+		AddInstance(translation, scale, yawRotation);
+	}
+
+	std::vector<Vertex_In> vertices{};
+	IndexBuffer indices{};
+	//Replaces the vertices of every level once the mesh is quantized, the positions are relative to localBox
+	std::vector<QuantizedVertex> quantizedVertices{};
+	bool isQuantized{};
+	//Triangles of every meshlet as a strip, only filled for meshes the software renderer draws as strips, see Stripifier
+	IndexBuffer stripIndices{};
+
+	std::vector<MeshInstance> instances{};
+
+	//Object space bounds, shared by all instances
+	dae::AABB localBox{};
+	dae::BoundingSphere localSphere{};
+	//Ranges of the index buffer with their own bounds and normal cone
+	std::vector<Meshlet> meshlets{};
+	//Coarser levels of detail, lods[0] is LOD 1, the mesh itself is LOD 0
+	std::vector<MeshLOD> lods{};
+
+	//Diffuse, Normal, Specular, Glossiness
+	//Transparent meshes only have a diffuse texture
+	//Shared with the other meshes that use the same texture, it is deleted with the last of them
+	std::vector<dae::TextureHandle> pTextures{};
+	bool isTransparent{};
+
+	//Returns the index of the new instance
+	size_t AddInstance(const dae::Vector3& translation, const dae::Vector3& scale, float yawRotation) {
+		instances.emplace_back(translation, scale, yawRotation, localBox, localSphere);
+		return instances.size() - 1;
+	}
+
+	uint32_t GetAmountOfLODs() const {
+		return static_cast<uint32_t>(lods.size()) + 1;
+	}
+	//Empty for quantized meshes
+	const std::vector<Vertex_In>& GetVertices(uint32_t lod) const {
+		return lod == 0 ? vertices : lods[lod - 1].vertices;
+	}
+	const std::vector<QuantizedVertex>& GetQuantizedVertices(uint32_t lod) const {
+		return lod == 0 ? quantizedVertices : lods[lod - 1].quantizedVertices;
+	}
+	size_t GetAmountOfVertices(uint32_t lod) const {
+		return isQuantized ? GetQuantizedVertices(lod).size() : GetVertices(lod).size();
+	}
+	const IndexBuffer& GetIndices(uint32_t lod) const {
+		return lod == 0 ? indices : lods[lod - 1].indices;
 	}
+	const IndexBuffer& GetStripIndices(uint32_t lod) const {
+		return lod == 0 ? stripIndices : lods[lod - 1].stripIndices;
+	}
+	const std::vector<Meshlet>& GetMeshlets(uint32_t lod) const {
+		return lod == 0 ? meshlets : lods[lod - 1].meshlets;
+	}
+	float GetLODError(uint32_t lod) const {
+		return lod == 0 ? 0.f : lods[lod - 1].error;
+	}
+
+	//Rotates every instance
+	void RotateY(float yaw) {
+		for (auto& instance : instances) {
+			instance.RotateY(yaw);
+		}
+	}
+
+	//Calculates the bounds and splits the triangles in meshlets, the indices are stored in the order of the meshlets
+	void BuildClusters(std::vector<uint32_t> triangleIndices) {
+		std::vector<Vector3> positions{};
+		positions.reserve(vertices.size());
+		for (const auto& vertex : vertices) {
+			positions.push_back(vertex.position);
+		}
+		localBox = AABB::FromPoints(positions);
+		localSphere = CreateBoundingSphere(positions, localBox);
+		meshlets = MeshletUtils::BuildMeshlets(positions, triangleIndices);
+		indices = IndexBuffer{ triangleIndices, vertices.size() };
+	}
+};
+
+//Instance that passed the frustum culling
+struct VisibleInstance
+{
+	uint32_t instanceIndex{};
+	//Level of detail used this frame
+	uint32_t lod{};
+	//Start of the transformed vertices of the instance in vertices_out
+	uint32_t firstVertex{};
+};
+
+//Vertex attributes that only depend on the world matrix
+struct WorldVertex
+{
+	Vector3 position{};
+	Vector3 normal{};
+	Vector3 tangent{};
+};
+
+//What an instance looked like in the last frame that was drawn
+struct RenderedInstanceState
+{
+	uint32_t worldVersion{};
+	dae::AABB worldBox{};
+};
+
+//Meshlet of a visible instance that passed the cluster culling
+struct VisibleMeshlet
+{
+	//Index into the visible instances of the mesh
+	uint32_t instanceSlot{};
+	uint32_t meshletIndex{};
 };
 
 struct Mesh_Software 
@@ -95,11 +245,57 @@ struct Mesh_Software
 	{
 		primitiveTopology = topology;
 		internalMesh = pMesh;
+
+		//Resolve the shading textures once instead of for every pixel
+		//Diffuse, Normal, Specular, Glossiness
+		if (pMesh->pTextures.size() == 4) {
+			pDiffuse = pMesh->pTextures[0].get();
+			pNormal = pMesh->pTextures[1].get();
+			pSpecular = pMesh->pTextures[2].get();
+			pGloss = pMesh->pTextures[3].get();
+		}
+		//Transparent meshes only have a diffuse texture, they are blended instead of shaded
+		else if (pMesh->isTransparent && !pMesh->pTextures.empty()) {
+			pDiffuse = pMesh->pTextures[0].get();
+		}
+		canBeShaded = pDiffuse && pSpecular && pGloss;
 	}
 	
 	Mesh* internalMesh;
 	PrimitiveTopology primitiveTopology{ PrimitiveTopology::TriangleList };
-	std::vector<Vertex_Out> vertices_out{};
+	//Instances inside the view frustum this frame, vertices_out has a range for each of them
+	//Only valid during the frame, they live in the frame arena of the renderer
+	FrameVector<VisibleInstance> visibleInstances{};
+	FrameVector<VisibleMeshlet> visibleMeshlets{};
+	FrameVector<Vertex_Out> vertices_out{};
+	//One for every instance, the level of detail it used last frame in this renderer, 0 is full detail
+	//Every renderer picks its own levels, views at different distances don't move each other's hysteresis
+	std::vector<uint32_t> currentLODs{};
+	//One for every instance, the screen area of instances that moved is redrawn
+	std::vector<RenderedInstanceState> renderedInstances{};
+
+	dae::Texture* pDiffuse{};
+	dae::Texture* pNormal{};
+	dae::Texture* pSpecular{};
+	dae::Texture* pGloss{};
+	bool canBeShaded{};
+};
+
+//Depth buffer a triangle is rasterized into, only the pixels from min up to max, exclusive, are written
+struct RasterTarget
+{
+	float* pDepthPixels{};
+	int width{};
+	Int2 min{};
+	Int2 max{};
+};
+
+//Interpolated vertex that won the depth test for a pixel, shaded after rasterization
+struct GBufferPixel
+{
+	Vertex_Out vertex{};
+	//nullptr if no geometry covers the pixel
+	Mesh_Software* pMesh{};
 };
 
 enum class LightType
@@ -110,18 +306,51 @@ enum class LightType
 
 struct Light
 {
-	Light(Vector3 originIn, Vector3 directionIn, ColorRGB colorIn, float intensityIn, LightType typeIn) {
+	Light(Vector3 originIn, Vector3 directionIn, ColorRGB colorIn, float intensityIn, LightType typeIn, float rangeIn = 0.f) {
 		origin = originIn;
 		direction = directionIn;
 		color = colorIn;
 		intensity = intensityIn;
 		type = typeIn;
+		range = rangeIn;
 	}
 
 	Vector3 origin{};
 	Vector3 direction{};
 	ColorRGB color{};
 	float intensity{};
+	//Only used by point lights, 0 means the light has no range limit
+	float range{};
 
 	LightType type{};
 };
+
+//What the software renderer did in one call of Render, copied as is into shared memory by FrameTelemetry
+//Only fixed size fields without padding, so other processes and compilers read the same layout
+struct FrameStatistics
+{
+	//Goes up for every call of Render, skipped frames included
+	uint64_t frameIndex{};
+	float frameTimeMs{};
+	//Stages of the frame in order, every stage ends where the next one starts
+	float clearMs{};
+	//Instance culling, vertex transform and meshlet culling
+	float geometryMs{};
+	float rasterMs{};
+	float shadowMs{};
+	float lightCullMs{};
+	float shadeMs{};
+	float transparentMs{};
+	uint32_t amountOfVisibleInstances{};
+	uint32_t amountOfVisibleMeshlets{};
+	//Triangles of the meshlets that are left after culling, the triangles over the joins of strips aren't counted
+	uint32_t amountOfTriangles{};
+	uint32_t amountOfShadedPixels{};
+	//Pixels that took their color from last frame instead of being shaded
+	uint32_t amountOfReusedPixels{};
+	//Share of the frame the threads of the parallel loops spent in their iterations, 0 when that isn't measured
+	float threadUtilization{};
+	uint32_t amountOfThreads{};
+	//1 when nothing changed since the frame before and nothing was drawn
+	uint32_t wasFrameSkipped{};
+};
@@ -7,7 +7,7 @@ using namespace dae;
 class Effect {
 public:
 	Effect(ID3D11Device* pDevice, const std::wstring& path);
-	~Effect();
+	virtual ~Effect();
 
 	ID3DX11Effect* GetEffect();
 	ID3DX11EffectTechnique* GetEffectTechnique();
@@ -0,0 +1,176 @@
+#include "pch.h"
+#include "FrameArena.h"
+#include <atomic>
+
+FrameArena::FrameArena(size_t capacity)
+{
+	m_Blocks.push_back(Block{ new char[capacity], capacity });
+}
+
+FrameArena::~FrameArena()
+{
+	for (Block& block : m_Blocks) {
+		delete[] block.pData;
+		block.pData = nullptr;
+	}
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	//Try the current block, then the blocks after it, only make a new block if none of them fits
+	while (true) {
+		const Block& block = m_Blocks[m_CurrentBlock];
+		const uintptr_t address = reinterpret_cast<uintptr_t>(block.pData) + m_Offset;
+		const size_t padding = (alignment - address % alignment) % alignment;
+
+		if (m_Offset + padding + size <= block.size) {
+			void* pAllocation = block.pData + m_Offset + padding;
+			m_Offset += padding + size;
+			m_Used += padding + size;
+			m_HighWaterMark = std::max(m_HighWaterMark, m_Used);
+			return pAllocation;
+		}
+
+		if (m_CurrentBlock + 1 == m_Blocks.size()) {
+			const size_t blockSize = std::max(size + alignment, m_Blocks.back().size);
+			m_Blocks.push_back(Block{ new char[blockSize], blockSize });
+		}
+		++m_CurrentBlock;
+		m_Offset = 0;
+	}
+}
+
+FrameArena::Marker FrameArena::GetMarker() const
+{
+	return Marker{ m_CurrentBlock, m_Offset, m_Used };
+}
+
+void FrameArena::Rewind(const Marker& marker)
+{
+	m_CurrentBlock = marker.blockIndex;
+	m_Offset = marker.offset;
+	m_Used = marker.used;
+}
+
+void FrameArena::Reset()
+{
+	//Merge the blocks, the next frame then fits in one block and never allocates again
+	if (m_Blocks.size() > 1) {
+		size_t totalSize{};
+		for (Block& block : m_Blocks) {
+			totalSize += block.size;
+			delete[] block.pData;
+		}
+		m_Blocks.clear();
+		m_Blocks.push_back(Block{ new char[totalSize], totalSize });
+	}
+
+	m_CurrentBlock = 0;
+	m_Offset = 0;
+	m_Used = 0;
+}
+
+size_t FrameArena::GetUsed() const
+{
+	return m_Used;
+}
+
+size_t FrameArena::GetCapacity() const
+{
+	size_t capacity{};
+	for (const Block& block : m_Blocks) {
+		capacity += block.size;
+	}
+	return capacity;
+}
+
+size_t FrameArena::GetHighWaterMark() const
+{
+	return m_HighWaterMark;
+}
+
+namespace
+{
+	std::atomic<uint64_t> g_NextAllocatorId{ 1 };
+
+	//Last arena the thread got, so a thread only takes the lock the first time
+	thread_local uint64_t t_CachedAllocatorId{};
+	thread_local FrameArena* t_pCachedArena{};
+}
+
+FrameAllocator::FrameAllocator(size_t sharedCapacity, size_t threadCapacity) :
+	m_SharedArena{ sharedCapacity },
+	m_ThreadCapacity{ threadCapacity },
+	m_Id{ g_NextAllocatorId++ }
+{
+}
+
+FrameAllocator::~FrameAllocator()
+{
+	for (auto& threadArena : m_pThreadArenas) {
+		delete threadArena.second;
+		threadArena.second = nullptr;
+	}
+}
+
+FrameArena& FrameAllocator::GetSharedArena()
+{
+	return m_SharedArena;
+}
+
+FrameArena& FrameAllocator::GetThreadArena()
+{
+	if (t_CachedAllocatorId == m_Id) {
+		return *t_pCachedArena;
+	}
+
+	const std::thread::id threadId = std::this_thread::get_id();
+	std::lock_guard<std::mutex> lock{ m_ThreadArenasMutex };
+
+	FrameArena* pArena{};
+	for (const auto& threadArena : m_pThreadArenas) {
+		if (threadArena.first == threadId) {
+			pArena = threadArena.second;
+			break;
+		}
+	}
+	if (!pArena) {
+		pArena = new FrameArena(m_ThreadCapacity);
+		m_pThreadArenas.emplace_back(threadId, pArena);
+	}
+
+	t_CachedAllocatorId = m_Id;
+	t_pCachedArena = pArena;
+	return *pArena;
+}
+
+void FrameAllocator::Reset()
+{
+	m_SharedArena.Reset();
+
+	std::lock_guard<std::mutex> lock{ m_ThreadArenasMutex };
+	for (const auto& threadArena : m_pThreadArenas) {
+		threadArena.second->Reset();
+	}
+}
+
+size_t FrameAllocator::GetSharedHighWaterMark() const
+{
+	return m_SharedArena.GetHighWaterMark();
+}
+
+size_t FrameAllocator::GetThreadHighWaterMark() const
+{
+	std::lock_guard<std::mutex> lock{ m_ThreadArenasMutex };
+	size_t highWaterMark{};
+	for (const auto& threadArena : m_pThreadArenas) {
+		highWaterMark += threadArena.second->GetHighWaterMark();
+	}
+	return highWaterMark;
+}
+
+size_t FrameAllocator::GetAmountOfThreadArenas() const
+{
+	std::lock_guard<std::mutex> lock{ m_ThreadArenasMutex };
+	return m_pThreadArenas.size();
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <cassert>
+#include <type_traits>
+
+//Linear allocator for data that only lives for one frame
+//Allocating bumps an offset, Reset releases everything at once without touching the heap
+//A frame that needs more than the arena holds gets an extra block, on Reset the blocks are merged so the next frame fits in one
+class FrameArena final
+{
+public:
+	explicit FrameArena(size_t capacity);
+	~FrameArena();
+
+	//Rule of 5
+	FrameArena(const FrameArena&) = delete;
+	FrameArena(FrameArena&&) noexcept = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+	FrameArena& operator=(FrameArena&&) noexcept = delete;
+
+	//Position in the arena, everything allocated after it can be released with Rewind
+	struct Marker
+	{
+		size_t blockIndex{};
+		size_t offset{};
+		size_t used{};
+	};
+
+	void* Allocate(size_t size, size_t alignment);
+	//Uninitialized storage, the destructors are never called so only trivially destructible types are allowed
+	template<typename T>
+	T* Allocate(size_t count)
+	{
+		static_assert(std::is_trivially_destructible_v<T>, "FrameArena never calls destructors");
+		return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+	}
+
+	Marker GetMarker() const;
+	void Rewind(const Marker& marker);
+	void Reset();
+
+	size_t GetUsed() const;
+	size_t GetCapacity() const;
+	//Most memory that was in use at once since the arena was created
+	size_t GetHighWaterMark() const;
+
+private:
+	struct Block
+	{
+		char* pData{};
+		size_t size{};
+	};
+
+	std::vector<Block> m_Blocks{};
+	size_t m_CurrentBlock{};
+	size_t m_Offset{};
+	size_t m_Used{};
+	size_t m_HighWaterMark{};
+};
+
+//Vector with a fixed capacity taken from a FrameArena, only valid until the arena is reset
+template<typename T>
+class FrameVector final
+{
+public:
+	//Forgets the old elements, the old storage stays in the arena until it is reset
+	void Reserve(FrameArena& arena, size_t capacity)
+	{
+		m_pData = arena.Allocate<T>(capacity);
+		m_Size = 0;
+		m_Capacity = capacity;
+	}
+	//Elements are uninitialized
+	void Resize(FrameArena& arena, size_t size)
+	{
+		Reserve(arena, size);
+		m_Size = size;
+	}
+
+	void push_back(const T& element)
+	{
+		assert(m_Size < m_Capacity && "FrameVector capacity exceeded");
+		m_pData[m_Size] = element;
+		++m_Size;
+	}
+	void clear() { m_Size = 0; }
+
+	T* data() { return m_pData; }
+	const T* data() const { return m_pData; }
+	size_t size() const { return m_Size; }
+	bool empty() const { return m_Size == 0; }
+
+	T& operator[](size_t index) { return m_pData[index]; }
+	const T& operator[](size_t index) const { return m_pData[index]; }
+	T& back() { return m_pData[m_Size - 1]; }
+	const T& back() const { return m_pData[m_Size - 1]; }
+
+	T* begin() { return m_pData; }
+	T* end() { return m_pData + m_Size; }
+	const T* begin() const { return m_pData; }
+	const T* end() const { return m_pData + m_Size; }
+
+private:
+	T* m_pData{};
+	size_t m_Size{};
+	size_t m_Capacity{};
+};
+
+//One shared arena for the serial parts of a frame and one arena per worker thread for scratch memory in parallel loops
+//All of them are reset together at the end of the frame
+class FrameAllocator final
+{
+public:
+	FrameAllocator(size_t sharedCapacity, size_t threadCapacity);
+	~FrameAllocator();
+
+	//Rule of 5
+	FrameAllocator(const FrameAllocator&) = delete;
+	FrameAllocator(FrameAllocator&&) noexcept = delete;
+	FrameAllocator& operator=(const FrameAllocator&) = delete;
+	FrameAllocator& operator=(FrameAllocator&&) noexcept = delete;
+
+	//Only for the thread that runs the frame
+	FrameArena& GetSharedArena();
+	//Arena of the calling thread, made the first time a thread asks for one
+	FrameArena& GetThreadArena();
+
+	//No thread arena may be in use while resetting
+	void Reset();
+
+	size_t GetSharedHighWaterMark() const;
+	//Sum over all the thread arenas
+	size_t GetThreadHighWaterMark() const;
+	size_t GetAmountOfThreadArenas() const;
+
+private:
+	FrameArena m_SharedArena;
+	size_t m_ThreadCapacity{};
+	//Tells the allocators apart in the per thread cache, even when one reuses the address of a deleted one
+	uint64_t m_Id{};
+
+	//A thread only locks it the first time it asks for its arena
+	mutable std::mutex m_ThreadArenasMutex{};
+	std::vector<std::pair<std::thread::id, FrameArena*>> m_pThreadArenas{};
+};
@@ -0,0 +1,330 @@
+#include "pch.h"
+#include "FrameStream.h"
+#include <chrono>
+#include <cstring> //memcpy
+#include <stdio.h> //fdopen
+#if defined(_WIN32)
+#include <io.h> //_close
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dae
+{
+	FrameStream::FrameStream(const std::string& path, int width, int height, const Settings& settings) :
+		m_Path{ path },
+		m_Width{ width },
+		m_Height{ height },
+		m_Settings{ settings }
+	{
+		Start();
+	}
+
+	FrameStream::FrameStream(int fileDescriptor, int width, int height, const Settings& settings) :
+		m_FileDescriptor{ fileDescriptor },
+		m_Width{ width },
+		m_Height{ height },
+		m_Settings{ settings }
+	{
+		Start();
+	}
+
+	FrameStream::~FrameStream()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			m_ShouldStop = true;
+		}
+		m_FrameQueuedCondition.notify_one();
+		m_Writer.join();
+
+		for (uint32_t* pBuffer : m_pBuffers) {
+			delete[] pBuffer;
+		}
+		m_pBuffers.clear();
+		m_pFreeBuffers.clear();
+	}
+
+	void FrameStream::Start()
+	{
+		m_Settings.amountOfBufferedFrames = std::max(m_Settings.amountOfBufferedFrames, 1);
+		m_Settings.framesPerSecond = std::max(m_Settings.framesPerSecond, 1);
+
+		//All the buffers are made up front, streaming doesn't allocate
+		const size_t amountOfPixels = static_cast<size_t>(m_Width) * m_Height;
+		for (int i{}; i < m_Settings.amountOfBufferedFrames; ++i) {
+			m_pBuffers.push_back(new uint32_t[amountOfPixels]);
+		}
+		m_pFreeBuffers = m_pBuffers;
+
+		m_Writer = std::thread{ &FrameStream::RunWriter, this };
+	}
+
+	bool FrameStream::PushFrame(const uint32_t* pPixels, uint32_t amountOfRepeats)
+	{
+		if (amountOfRepeats == 0) {
+			return true;
+		}
+
+		uint32_t* pBuffer{};
+		{
+			std::unique_lock<std::mutex> lock{ m_Mutex };
+			if (m_pFreeBuffers.empty() && m_Settings.shouldBlockWhenFull) {
+				m_BufferFreedCondition.wait(lock, [this]() { return !m_pFreeBuffers.empty() || m_HasFailed; });
+			}
+			if (m_pFreeBuffers.empty() || m_HasFailed) {
+				m_AmountOfDroppedFrames += amountOfRepeats;
+				return false;
+			}
+			pBuffer = m_pFreeBuffers.back();
+			m_pFreeBuffers.pop_back();
+		}
+
+		//The buffer belongs to this thread until it is queued, so the copy doesn't hold the lock
+		std::memcpy(pBuffer, pPixels, static_cast<size_t>(m_Width) * m_Height * sizeof(uint32_t));
+
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			m_QueuedFrames.push(QueuedFrame{ pBuffer, amountOfRepeats });
+		}
+		m_FrameQueuedCondition.notify_one();
+		return true;
+	}
+
+	bool FrameStream::HasFailed() const
+	{
+		return m_HasFailed;
+	}
+
+	uint64_t FrameStream::GetAmountOfWrittenFrames() const
+	{
+		return m_AmountOfWrittenFrames;
+	}
+
+	uint64_t FrameStream::GetAmountOfDroppedFrames() const
+	{
+		return m_AmountOfDroppedFrames;
+	}
+
+	void FrameStream::RunWriter()
+	{
+#if !defined(_WIN32)
+		//A reader that closes the pipe would end the program with SIGPIPE, the failed write is handled instead
+		sigset_t signals{};
+		sigemptyset(&signals);
+		sigaddset(&signals, SIGPIPE);
+		pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+#endif
+
+		if (!Open()) {
+			std::cout << "Frame stream: couldn't open " << (m_Path.empty() ? "the file descriptor" : m_Path) << std::endl;
+			Fail();
+		}
+
+		while (true) {
+			QueuedFrame frame{};
+			{
+				std::unique_lock<std::mutex> lock{ m_Mutex };
+				m_FrameQueuedCondition.wait(lock, [this]() { return !m_QueuedFrames.empty() || m_ShouldStop; });
+				//Frames that are still queued when the stream stops are written first
+				if (m_QueuedFrames.empty()) {
+					break;
+				}
+				frame = m_QueuedFrames.front();
+				m_QueuedFrames.pop();
+			}
+
+			if (m_HasFailed) {
+				m_AmountOfDroppedFrames += frame.amountOfRepeats;
+			}
+			else {
+				const uint32_t amountWritten = WriteFrame(frame.pPixels, frame.amountOfRepeats);
+				m_AmountOfWrittenFrames += amountWritten;
+				if (amountWritten < frame.amountOfRepeats) {
+					std::cout << "Frame stream: writing failed after " << m_AmountOfWrittenFrames << " frames, the reader went away" << std::endl;
+					m_AmountOfDroppedFrames += frame.amountOfRepeats - amountWritten;
+					Fail();
+				}
+			}
+
+			{
+				std::lock_guard<std::mutex> lock{ m_Mutex };
+				m_pFreeBuffers.push_back(frame.pPixels);
+			}
+			m_BufferFreedCondition.notify_one();
+		}
+
+		if (m_pFile) {
+			std::fclose(m_pFile);
+			m_pFile = nullptr;
+		}
+	}
+
+	void FrameStream::Fail()
+	{
+		{
+			//Set under the lock, so a push can't miss it between checking and waiting
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			m_HasFailed = true;
+		}
+		m_BufferFreedCondition.notify_all();
+	}
+
+	bool FrameStream::Open()
+	{
+#if !defined(_WIN32)
+		//fopen of a named pipe blocks until a reader opens it, and the destructor would wait for that forever
+		struct stat status{};
+		if (!m_Path.empty() && stat(m_Path.c_str(), &status) == 0 && S_ISFIFO(status.st_mode)) {
+			m_FileDescriptor = OpenNamedPipe();
+			if (m_FileDescriptor < 0) {
+				return false;
+			}
+			m_Path.clear();
+		}
+#endif
+
+		if (m_Path.empty()) {
+#if defined(_WIN32)
+			m_pFile = _fdopen(m_FileDescriptor, "wb");
+#else
+			m_pFile = fdopen(m_FileDescriptor, "wb");
+#endif
+			//The descriptor is owned by the stream, fclose would have closed it
+			if (!m_pFile && m_FileDescriptor >= 0) {
+#if defined(_WIN32)
+				_close(m_FileDescriptor);
+#else
+				close(m_FileDescriptor);
+#endif
+			}
+			m_FileDescriptor = -1;
+		}
+		else {
+			m_pFile = std::fopen(m_Path.c_str(), "wb");
+		}
+		if (!m_pFile) {
+			return false;
+		}
+
+		if (m_Settings.format == Format::Y4M) {
+			//C420jpeg puts the chroma in the center of every 2x2 block, like the averaging does
+			const std::string header = "YUV4MPEG2 W" + std::to_string(m_Width) + " H" + std::to_string(m_Height)
+				+ " F" + std::to_string(m_Settings.framesPerSecond) + ":1 Ip A1:1 C420jpeg\n";
+			return std::fwrite(header.data(), 1, header.size(), m_pFile) == header.size();
+		}
+		return true;
+	}
+
+#if !defined(_WIN32)
+	int FrameStream::OpenNamedPipe()
+	{
+		while (true) {
+			//Without a reader a non blocking open fails with ENXIO instead of waiting
+			const int fileDescriptor = open(m_Path.c_str(), O_WRONLY | O_NONBLOCK);
+			if (fileDescriptor >= 0) {
+				//Writes wait for the reader again, the queue keeps that off the render thread
+				fcntl(fileDescriptor, F_SETFL, fcntl(fileDescriptor, F_GETFL) & ~O_NONBLOCK);
+				return fileDescriptor;
+			}
+			if (errno != ENXIO && errno != EINTR) {
+				return -1;
+			}
+
+			//Tried again every 50 ms, the destructor wakes it up to give up
+			std::unique_lock<std::mutex> lock{ m_Mutex };
+			if (m_FrameQueuedCondition.wait_for(lock, std::chrono::milliseconds{ 50 }, [this]() { return m_ShouldStop; })) {
+				return -1;
+			}
+		}
+	}
+#endif
+
+	uint32_t FrameStream::WriteFrame(const uint32_t* pPixels, uint32_t amountOfRepeats)
+	{
+		switch (m_Settings.format) {
+		case Format::RawRGBA:
+			ConvertToRGBA(pPixels);
+			break;
+		case Format::Y4M:
+			ConvertToYUV420(pPixels);
+			break;
+		}
+		for (uint32_t i{}; i < amountOfRepeats; ++i) {
+			if (std::fwrite(m_Output.data(), 1, m_Output.size(), m_pFile) != m_Output.size()) {
+				return i;
+			}
+		}
+		//Flushed every frame, so the reader gets it right away
+		return std::fflush(m_pFile) == 0 ? amountOfRepeats : 0;
+	}
+
+	void FrameStream::ConvertToRGBA(const uint32_t* pPixels)
+	{
+		const size_t amountOfPixels = static_cast<size_t>(m_Width) * m_Height;
+		m_Output.resize(amountOfPixels * 4);
+		uint8_t* pOutput = m_Output.data();
+		for (size_t i{}; i < amountOfPixels; ++i) {
+			const uint32_t pixel = pPixels[i];
+			pOutput[0] = static_cast<uint8_t>(pixel >> 16);
+			pOutput[1] = static_cast<uint8_t>(pixel >> 8);
+			pOutput[2] = static_cast<uint8_t>(pixel);
+			pOutput[3] = static_cast<uint8_t>(pixel >> 24);
+			pOutput += 4;
+		}
+	}
+
+	void FrameStream::ConvertToYUV420(const uint32_t* pPixels)
+	{
+		static constexpr char FrameHeader[]{ "FRAME\n" };
+		constexpr size_t FrameHeaderSize{ sizeof(FrameHeader) - 1 };
+
+		//Odd sizes get a chroma sample for the last column and row on their own
+		const int chromaWidth = (m_Width + 1) / 2;
+		const int chromaHeight = (m_Height + 1) / 2;
+		const size_t lumaSize = static_cast<size_t>(m_Width) * m_Height;
+		const size_t chromaSize = static_cast<size_t>(chromaWidth) * chromaHeight;
+		m_Output.resize(FrameHeaderSize + lumaSize + 2 * chromaSize);
+
+		std::memcpy(m_Output.data(), FrameHeader, FrameHeaderSize);
+		uint8_t* pY = m_Output.data() + FrameHeaderSize;
+		uint8_t* pU = pY + lumaSize;
+		uint8_t* pV = pU + chromaSize;
+
+		for (int py{}; py < m_Height; ++py) {
+			for (int px{}; px < m_Width; ++px) {
+				const uint32_t pixel = pPixels[px + (py * m_Width)];
+				const int r = (pixel >> 16) & 0xFF;
+				const int g = (pixel >> 8) & 0xFF;
+				const int b = pixel & 0xFF;
+				pY[px + (py * m_Width)] = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+			}
+		}
+
+		for (int cy{}; cy < chromaHeight; ++cy) {
+			for (int cx{}; cx < chromaWidth; ++cx) {
+				int r{}, g{}, b{}, amountOfSamples{};
+				for (int py{ 2 * cy }; py < std::min(2 * cy + 2, m_Height); ++py) {
+					for (int px{ 2 * cx }; px < std::min(2 * cx + 2, m_Width); ++px) {
+						const uint32_t pixel = pPixels[px + (py * m_Width)];
+						r += (pixel >> 16) & 0xFF;
+						g += (pixel >> 8) & 0xFF;
+						b += pixel & 0xFF;
+						++amountOfSamples;
+					}
+				}
+				r = (r + amountOfSamples / 2) / amountOfSamples;
+				g = (g + amountOfSamples / 2) / amountOfSamples;
+				b = (b + amountOfSamples / 2) / amountOfSamples;
+
+				const int chromaIndex = cx + (cy * chromaWidth);
+				pU[chromaIndex] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+				pV[chromaIndex] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+			}
+		}
+	}
+}
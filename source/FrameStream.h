@@ -0,0 +1,109 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	//Streams consecutive frames to a file, a named pipe or a file descriptor, for an encoder to read without intermediate images
+	//Frames are copied into a fixed set of buffers and written by a thread of the stream, so a slow reader doesn't stall rendering
+	class FrameStream final
+	{
+	public:
+		enum class Format
+		{
+			//R, G, B and A bytes per pixel, the reader has to be told the size and the frame rate
+			RawRGBA,
+			//YUV4MPEG2 with 4:2:0 chroma, the header carries the size and the frame rate
+			Y4M
+		};
+
+		struct Settings
+		{
+			Format format{ Format::Y4M };
+			int framesPerSecond{ 30 };
+			//Frames that can wait for the writer, this is all the memory the stream uses
+			int amountOfBufferedFrames{ 4 };
+			//When every buffer is waiting, false drops the new frame and true waits for the writer
+			bool shouldBlockWhenFull{ false };
+		};
+
+		//Opening a named pipe waits for a reader, that happens on the writer thread
+		//When no reader comes the destructor stops waiting and the queued frames are dropped
+		FrameStream(const std::string& path, int width, int height, const Settings& settings);
+		//The stream takes ownership of the descriptor and closes it
+		FrameStream(int fileDescriptor, int width, int height, const Settings& settings);
+		//Writes the frames that are still waiting before it returns
+		~FrameStream();
+
+		//Rule of 5
+		FrameStream(const FrameStream&) = delete;
+		FrameStream(FrameStream&&) noexcept = delete;
+		FrameStream& operator=(const FrameStream&) = delete;
+		FrameStream& operator=(FrameStream&&) noexcept = delete;
+
+		//Copies a frame of width * height 0xAARRGGBB pixels without padding, false when it was dropped
+		//The writer writes it amountOfRepeats times, for a render frame that took several video frames, at the cost of a single copy
+		bool PushFrame(const uint32_t* pPixels, uint32_t amountOfRepeats = 1);
+
+		//The output couldn't be opened or the reader went away, frames pushed after that are dropped
+		bool HasFailed() const;
+		uint64_t GetAmountOfWrittenFrames() const;
+		uint64_t GetAmountOfDroppedFrames() const;
+
+	private:
+		std::string m_Path{};
+		int m_FileDescriptor{ -1 };
+		std::FILE* m_pFile{};
+
+		int m_Width{};
+		int m_Height{};
+		Settings m_Settings{};
+
+		//Frame that waits for the writer, with the amount of times it is written
+		struct QueuedFrame
+		{
+			uint32_t* pPixels{};
+			uint32_t amountOfRepeats{};
+		};
+
+		//Every buffer is either free or queued, only the writer thread converts and writes
+		std::vector<uint32_t*> m_pBuffers{};
+		std::vector<uint32_t*> m_pFreeBuffers{};
+		std::queue<QueuedFrame> m_QueuedFrames{};
+		//Bytes of one converted frame, only used by the writer thread
+		std::vector<uint8_t> m_Output{};
+
+		std::thread m_Writer{};
+		std::mutex m_Mutex{};
+		std::condition_variable m_FrameQueuedCondition{};
+		std::condition_variable m_BufferFreedCondition{};
+		bool m_ShouldStop{};
+
+		std::atomic<bool> m_HasFailed{};
+		std::atomic<uint64_t> m_AmountOfWrittenFrames{};
+		std::atomic<uint64_t> m_AmountOfDroppedFrames{};
+
+		void Start();
+		void RunWriter();
+		//Opens the output and writes the header of the format
+		bool Open();
+#if !defined(_WIN32)
+		//Waits for a reader until the stream stops, -1 when it stopped or the pipe can't be opened
+		int OpenNamedPipe();
+#endif
+		//Wakes up waiting pushes, they drop their frame
+		void Fail();
+		//Converts the frame once and writes it amountOfRepeats times, returns how many times it was written
+		uint32_t WriteFrame(const uint32_t* pPixels, uint32_t amountOfRepeats);
+		void ConvertToRGBA(const uint32_t* pPixels);
+		//Limited range BT.601, the chroma is the average of every 2x2 block
+		void ConvertToYUV420(const uint32_t* pPixels);
+	};
+}
@@ -0,0 +1,359 @@
+#include "pch.h"
+#include "FrameTelemetry.h"
+#include <atomic>
+#include <cstring> //memcpy
+#include <new>
+#if defined(_WIN32)
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dae
+{
+	namespace
+	{
+		constexpr uint32_t TelemetryMagic{ 0x4D4C4554 };
+		//Goes up when the layout or FrameStatistics changes
+		constexpr uint32_t TelemetryVersion{ 1 };
+		constexpr size_t WordsPerRecord{ sizeof(FrameStatistics) / sizeof(uint64_t) };
+		static_assert(sizeof(FrameStatistics) % sizeof(uint64_t) == 0, "Records are copied as whole words");
+		static_assert(std::atomic<uint64_t>::is_always_lock_free, "Atomics in shared memory have to be lock free");
+
+		//Start of the shared memory, the slots follow it
+		struct SharedHeader
+		{
+			//Stored last, a reader that sees it sees the rest of the header
+			std::atomic<uint32_t> magic;
+			uint32_t version;
+			uint32_t recordSize;
+			uint32_t capacity;
+			//Amount of published records, record i is in slot i % capacity
+			alignas(64) std::atomic<uint64_t> amountOfRecords;
+			std::atomic<uint32_t> isClosed;
+		};
+
+		struct SharedSlot
+		{
+			//2 * i + 1 while record i is written, 2 * i + 2 once it is complete, 0 before the first record
+			std::atomic<uint64_t> sequence;
+			//Words instead of the struct, so a copy that races with the writer is made of atomic loads
+			std::atomic<uint64_t> words[WordsPerRecord];
+		};
+
+		size_t GetSizeInBytes(uint32_t capacity)
+		{
+			return sizeof(SharedHeader) + capacity * sizeof(SharedSlot);
+		}
+
+		SharedHeader* GetHeader(void* pMemory)
+		{
+			return static_cast<SharedHeader*>(pMemory);
+		}
+
+		SharedSlot* GetSlots(void* pMemory)
+		{
+			return reinterpret_cast<SharedSlot*>(static_cast<uint8_t*>(pMemory) + sizeof(SharedHeader));
+		}
+
+		//POSIX names start with a slash, Windows names can't have one
+		std::string GetSystemName(const std::string& name)
+		{
+#if defined(_WIN32)
+			return name;
+#else
+			return "/" + name;
+#endif
+		}
+
+		//Zero filled, for the writer
+		void* CreateSharedMemory(const std::string& name, size_t sizeInBytes, void*& pMappingHandle)
+		{
+			const std::string systemName = GetSystemName(name);
+#if defined(_WIN32)
+			HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+				static_cast<DWORD>(static_cast<uint64_t>(sizeInBytes) >> 32), static_cast<DWORD>(sizeInBytes), systemName.c_str());
+			//Windows keeps the mapping alive while anyone has it open, so an existing one has a writer of its own
+			if (!mapping || GetLastError() == ERROR_ALREADY_EXISTS) {
+				if (mapping) {
+					CloseHandle(mapping);
+				}
+				return nullptr;
+			}
+			void* pMemory = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeInBytes);
+			if (!pMemory) {
+				CloseHandle(mapping);
+				return nullptr;
+			}
+			pMappingHandle = mapping;
+			return pMemory;
+#else
+			//Readers of memory a crashed renderer left behind keep their mapping, the name goes to the new memory
+			shm_unlink(systemName.c_str());
+			const int fileDescriptor = shm_open(systemName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+			if (fileDescriptor < 0) {
+				return nullptr;
+			}
+			void* pMemory{};
+			if (ftruncate(fileDescriptor, static_cast<off_t>(sizeInBytes)) == 0) {
+				pMemory = mmap(nullptr, sizeInBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+			}
+			close(fileDescriptor);
+			if (!pMemory || pMemory == MAP_FAILED) {
+				shm_unlink(systemName.c_str());
+				return nullptr;
+			}
+			pMappingHandle = nullptr;
+			return pMemory;
+#endif
+		}
+
+		//Read only, maps all of the memory and returns its size
+		void* OpenSharedMemory(const std::string& name, size_t& sizeInBytes, void*& pMappingHandle)
+		{
+			const std::string systemName = GetSystemName(name);
+#if defined(_WIN32)
+			HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, systemName.c_str());
+			if (!mapping) {
+				return nullptr;
+			}
+			void* pMemory = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			MEMORY_BASIC_INFORMATION information{};
+			if (!pMemory || VirtualQuery(pMemory, &information, sizeof(information)) == 0) {
+				if (pMemory) {
+					UnmapViewOfFile(pMemory);
+				}
+				CloseHandle(mapping);
+				return nullptr;
+			}
+			sizeInBytes = information.RegionSize;
+			pMappingHandle = mapping;
+			return pMemory;
+#else
+			const int fileDescriptor = shm_open(systemName.c_str(), O_RDONLY, 0);
+			if (fileDescriptor < 0) {
+				return nullptr;
+			}
+			void* pMemory{};
+			struct stat status{};
+			if (fstat(fileDescriptor, &status) == 0 && status.st_size > 0) {
+				sizeInBytes = static_cast<size_t>(status.st_size);
+				pMemory = mmap(nullptr, sizeInBytes, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+			}
+			close(fileDescriptor);
+			if (!pMemory || pMemory == MAP_FAILED) {
+				return nullptr;
+			}
+			pMappingHandle = nullptr;
+			return pMemory;
+#endif
+		}
+
+		void CloseSharedMemory(void* pMemory, size_t sizeInBytes, void* pMappingHandle)
+		{
+#if defined(_WIN32)
+			(void)sizeInBytes;
+			UnmapViewOfFile(pMemory);
+			CloseHandle(pMappingHandle);
+#else
+			(void)pMappingHandle;
+			munmap(pMemory, sizeInBytes);
+#endif
+		}
+
+		uint32_t RoundUpToPowerOf2(uint32_t value)
+		{
+			uint32_t powerOf2{ 1 };
+			while (powerOf2 < value) {
+				powerOf2 <<= 1;
+			}
+			return powerOf2;
+		}
+	}
+
+	FrameTelemetry::FrameTelemetry(const Settings& settings) :
+		m_Name{ settings.name },
+		m_Capacity{ RoundUpToPowerOf2(settings.capacity) }
+	{
+		m_SizeInBytes = GetSizeInBytes(m_Capacity);
+		m_pMemory = CreateSharedMemory(m_Name, m_SizeInBytes, m_pMappingHandle);
+		if (!m_pMemory) {
+			std::cout << "Frame telemetry: couldn't create the shared memory " << m_Name << std::endl;
+			return;
+		}
+
+		SharedHeader* pHeader = new (m_pMemory) SharedHeader{};
+		pHeader->version = TelemetryVersion;
+		pHeader->recordSize = static_cast<uint32_t>(sizeof(FrameStatistics));
+		pHeader->capacity = m_Capacity;
+		SharedSlot* pSlots = GetSlots(m_pMemory);
+		for (uint32_t i{}; i < m_Capacity; ++i) {
+			new (&pSlots[i]) SharedSlot{};
+		}
+		pHeader->magic.store(TelemetryMagic, std::memory_order_release);
+	}
+
+	FrameTelemetry::~FrameTelemetry()
+	{
+		if (!m_pMemory) {
+			return;
+		}
+		GetHeader(m_pMemory)->isClosed.store(1, std::memory_order_release);
+		CloseSharedMemory(m_pMemory, m_SizeInBytes, m_pMappingHandle);
+		m_pMemory = nullptr;
+#if !defined(_WIN32)
+		shm_unlink(GetSystemName(m_Name).c_str());
+#endif
+	}
+
+	void FrameTelemetry::Publish(const FrameStatistics& statistics)
+	{
+		if (!m_pMemory) {
+			return;
+		}
+
+		uint64_t words[WordsPerRecord];
+		memcpy(words, &statistics, sizeof(words));
+
+		//Seqlock, the odd sequence is visible before any word of the new record
+		SharedSlot& slot = GetSlots(m_pMemory)[m_AmountOfRecords & (m_Capacity - 1)];
+		slot.sequence.store(2 * m_AmountOfRecords + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (size_t i{}; i < WordsPerRecord; ++i) {
+			slot.words[i].store(words[i], std::memory_order_relaxed);
+		}
+		slot.sequence.store(2 * m_AmountOfRecords + 2, std::memory_order_release);
+
+		++m_AmountOfRecords;
+		GetHeader(m_pMemory)->amountOfRecords.store(m_AmountOfRecords, std::memory_order_release);
+	}
+
+	bool FrameTelemetry::HasFailed() const
+	{
+		return m_pMemory == nullptr;
+	}
+
+	const std::string& FrameTelemetry::GetName() const
+	{
+		return m_Name;
+	}
+
+	FrameTelemetryReader::FrameTelemetryReader(const std::string& name)
+	{
+		m_pMemory = OpenSharedMemory(name, m_SizeInBytes, m_pMappingHandle);
+		if (!m_pMemory) {
+			return;
+		}
+
+		//The writer may still be filling in the header, or it is from another version
+		const SharedHeader* pHeader = GetHeader(m_pMemory);
+		const bool isValid = m_SizeInBytes >= sizeof(SharedHeader) &&
+			pHeader->magic.load(std::memory_order_acquire) == TelemetryMagic &&
+			pHeader->version == TelemetryVersion &&
+			pHeader->recordSize == sizeof(FrameStatistics) &&
+			pHeader->capacity > 0 && (pHeader->capacity & (pHeader->capacity - 1)) == 0 &&
+			m_SizeInBytes >= GetSizeInBytes(pHeader->capacity);
+		if (!isValid) {
+			CloseSharedMemory(m_pMemory, m_SizeInBytes, m_pMappingHandle);
+			m_pMemory = nullptr;
+			return;
+		}
+
+		//Starts at the oldest record that is still there
+		m_Capacity = pHeader->capacity;
+		const uint64_t amountOfRecords = pHeader->amountOfRecords.load(std::memory_order_acquire);
+		m_NextRecord = amountOfRecords > m_Capacity ? amountOfRecords - m_Capacity : 0;
+	}
+
+	FrameTelemetryReader::~FrameTelemetryReader()
+	{
+		if (m_pMemory) {
+			CloseSharedMemory(m_pMemory, m_SizeInBytes, m_pMappingHandle);
+			m_pMemory = nullptr;
+		}
+	}
+
+	bool FrameTelemetryReader::HasFailed() const
+	{
+		return m_pMemory == nullptr;
+	}
+
+	bool FrameTelemetryReader::IsWriterClosed() const
+	{
+		return !m_pMemory || GetHeader(m_pMemory)->isClosed.load(std::memory_order_acquire) != 0;
+	}
+
+	uint64_t FrameTelemetryReader::ReadNew(std::vector<FrameStatistics>& recordsOut)
+	{
+		if (!m_pMemory) {
+			return 0;
+		}
+
+		const uint64_t amountOfRecords = GetHeader(m_pMemory)->amountOfRecords.load(std::memory_order_acquire);
+		uint64_t amountOfMissedRecords{};
+		//The writer went around the ring since the last call
+		if (amountOfRecords - m_NextRecord > m_Capacity) {
+			amountOfMissedRecords = amountOfRecords - m_Capacity - m_NextRecord;
+			m_NextRecord = amountOfRecords - m_Capacity;
+		}
+		for (; m_NextRecord < amountOfRecords; ++m_NextRecord) {
+			FrameStatistics record{};
+			//The oldest records can be overwritten while they are copied
+			if (ReadRecord(m_NextRecord, record)) {
+				recordsOut.push_back(record);
+			}
+			else {
+				++amountOfMissedRecords;
+			}
+		}
+		return amountOfMissedRecords;
+	}
+
+	bool FrameTelemetryReader::ReadLatest(FrameStatistics& recordOut) const
+	{
+		if (!m_pMemory) {
+			return false;
+		}
+
+		//Only fails when the writer went around the whole ring during the copy, then a newer record is there
+		constexpr int MaxAttempts{ 4 };
+		for (int attempt{}; attempt < MaxAttempts; ++attempt) {
+			const uint64_t amountOfRecords = GetHeader(m_pMemory)->amountOfRecords.load(std::memory_order_acquire);
+			if (amountOfRecords == 0) {
+				return false;
+			}
+			if (ReadRecord(amountOfRecords - 1, recordOut)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool FrameTelemetryReader::ReadRecord(uint64_t index, FrameStatistics& recordOut) const
+	{
+		const SharedSlot& slot = GetSlots(m_pMemory)[index & (m_Capacity - 1)];
+		const uint64_t completeSequence = 2 * index + 2;
+		if (slot.sequence.load(std::memory_order_acquire) != completeSequence) {
+			return false;
+		}
+
+		uint64_t words[WordsPerRecord];
+		for (size_t i{}; i < WordsPerRecord; ++i) {
+			words[i] = slot.words[i].load(std::memory_order_relaxed);
+		}
+		//The words are loaded before the sequence is checked again
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.sequence.load(std::memory_order_relaxed) != completeSequence) {
+			return false;
+		}
+
+		memcpy(&recordOut, words, sizeof(words));
+		return true;
+	}
+}
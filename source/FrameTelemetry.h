@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "DataTypes.h"
+
+namespace dae
+{
+	//Publishes the statistics of every frame in shared memory, for monitoring tools that read them while the renderer runs
+	//The renderer is the only writer and never waits for a reader: the records go into a ring that overwrites the oldest one
+	//Every slot has a sequence number that is odd while it is written, a reader only keeps a copy when the number didn't change
+	//POSIX shared memory, a named file mapping on Windows
+	class FrameTelemetry final
+	{
+	public:
+		struct Settings
+		{
+			//Without the leading slash of POSIX, it is added there
+			std::string name{ "dae_rasterizer_telemetry" };
+			//Records a reader can fall behind before it misses some, a power of 2
+			uint32_t capacity{ 1024 };
+		};
+
+		//Replaces shared memory with the same name that a renderer left behind, readers of that one have to open the name again
+		explicit FrameTelemetry(const Settings& settings);
+		//Marks the memory as closed and removes the name, readers that have it open keep their mapping
+		~FrameTelemetry();
+
+		//Rule of 5
+		FrameTelemetry(const FrameTelemetry&) = delete;
+		FrameTelemetry(FrameTelemetry&&) noexcept = delete;
+		FrameTelemetry& operator=(const FrameTelemetry&) = delete;
+		FrameTelemetry& operator=(FrameTelemetry&&) noexcept = delete;
+
+		//Wait free, a copy into the next slot and a few atomic stores
+		void Publish(const FrameStatistics& statistics);
+
+		//The shared memory couldn't be created, Publish does nothing
+		bool HasFailed() const;
+		const std::string& GetName() const;
+
+	private:
+		std::string m_Name{};
+		void* m_pMemory{};
+		size_t m_SizeInBytes{};
+		//Handle of the file mapping on Windows, the POSIX descriptor is closed once the memory is mapped
+		void* m_pMappingHandle{};
+		uint32_t m_Capacity{};
+		uint64_t m_AmountOfRecords{};
+	};
+
+	//Reads the records a FrameTelemetry of another process publishes, at any rate, without ever blocking it
+	class FrameTelemetryReader final
+	{
+	public:
+		//Fails when nothing is published under the name or the layout is from another version
+		explicit FrameTelemetryReader(const std::string& name);
+		~FrameTelemetryReader();
+
+		//Rule of 5
+		FrameTelemetryReader(const FrameTelemetryReader&) = delete;
+		FrameTelemetryReader(FrameTelemetryReader&&) noexcept = delete;
+		FrameTelemetryReader& operator=(const FrameTelemetryReader&) = delete;
+		FrameTelemetryReader& operator=(FrameTelemetryReader&&) noexcept = delete;
+
+		bool HasFailed() const;
+		//The writer was destroyed, nothing new will be published
+		bool IsWriterClosed() const;
+
+		//Appends the records published since the last call, oldest first
+		//Returns the amount of records that were overwritten before they could be read
+		uint64_t ReadNew(std::vector<FrameStatistics>& recordsOut);
+		//Most recent record, false when nothing was published yet
+		bool ReadLatest(FrameStatistics& recordOut) const;
+
+	private:
+		void* m_pMemory{};
+		size_t m_SizeInBytes{};
+		void* m_pMappingHandle{};
+		uint32_t m_Capacity{};
+		//Index of the next record ReadNew returns
+		uint64_t m_NextRecord{};
+
+		//Copies record index out of its slot, false when it was overwritten or is being written
+		bool ReadRecord(uint64_t index, FrameStatistics& recordOut) const;
+	};
+}
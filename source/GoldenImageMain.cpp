@@ -0,0 +1,90 @@
+#include "pch.h"
+#include "GoldenImageSuite.h"
+#include "MeshSimplifier.h"
+#include "Utils.h"
+#include <cstdlib>
+#include <string>
+
+using namespace dae;
+
+//Golden image test of the software renderer library, without a window, run by ctest
+//dae_golden_images <check|record> [reference folder] [frame budget in ms]
+//Run from the source folder, the meshes and the references are found relative to it
+int main(int argc, char* args[])
+{
+	const std::string mode = argc > 1 ? args[1] : "";
+	if (mode != "check" && mode != "record") {
+		std::cout << "Usage: dae_golden_images <check|record> [reference folder] [frame budget in ms]" << std::endl;
+		return 1;
+	}
+
+	GoldenImageSuite::Settings settings{};
+	if (argc > 2) {
+		settings.referenceDirectory = args[2];
+	}
+	if (argc > 3) {
+		char* pEnd{};
+		settings.frameBudgetMs = std::strtof(args[3], &pEnd);
+		if (pEnd == args[3] || *pEnd != '\0' || settings.frameBudgetMs < 0.f) {
+			std::cout << "The frame budget has to be a number of milliseconds, not " << args[3] << std::endl;
+			return 1;
+		}
+	}
+
+	//The scene of RenderManager::LoadMeshes, so the references of the application and of this test are the same
+	constexpr int width{ 640 };
+	constexpr int height{ 480 };
+	dae::Camera camera{};
+	camera.Initialize(45.f, { 0.f, 0.f, 0.f }, static_cast<float>(width) / static_cast<float>(height));
+
+	Vector3 translation{ 0.f, 0.f, 50.f };
+	Vector3 scale{ 1.f, 1.f, 1.f };
+	const float yawRotation{ 90.f * TO_RADIANS };
+	TextureManager textureManager{};
+	std::vector<Mesh*> pMeshes{};
+	auto loadMesh = [&](const std::string& path, const std::vector<std::string>& texturePaths, bool isTransparent)
+		{
+			std::vector<Vertex_In> vertices{};
+			std::vector<uint32_t> indices{};
+			if (!Utils::ParseOBJ(path, vertices, indices)) {
+				return false;
+			}
+			std::vector<TextureHandle> pTextures{};
+			for (const std::string& texturePath : texturePaths) {
+				pTextures.push_back(textureManager.Load(texturePath));
+			}
+			Mesh* pMesh = new Mesh(vertices, indices, translation, scale, yawRotation, pTextures, isTransparent);
+			if (!isTransparent) {
+				MeshSimplifier::BuildLODs(*pMesh);
+			}
+			pMeshes.push_back(pMesh);
+			return true;
+		};
+
+	int exitCode{ 1 };
+	try {
+		if (loadMesh("Resources/vehicle.obj", { "Resources/vehicle_diffuse.png", "Resources/vehicle_normal.png", "Resources/vehicle_specular.png", "Resources/vehicle_gloss.png" }, false) &&
+			loadMesh("Resources/fireFX.obj", { "Resources/fireFX_diffuse.png" }, true)) {
+			Renderer_Software* pRenderer = new Renderer_Software(width, height, &camera, pMeshes);
+			GoldenImageSuite suite{ pRenderer, &camera, pMeshes.front(), settings };
+			if (mode == "record") {
+				exitCode = suite.Record() ? 0 : 1;
+			}
+			else {
+				exitCode = suite.Check() == 0 ? 0 : 1;
+			}
+			delete pRenderer;
+		}
+		else {
+			std::cout << "Couldn't load the meshes, run from the source folder" << std::endl;
+		}
+	}
+	catch (const std::exception& exception) {
+		std::cout << exception.what() << std::endl;
+	}
+
+	for (Mesh* pMesh : pMeshes) {
+		delete pMesh;
+	}
+	return exitCode;
+}
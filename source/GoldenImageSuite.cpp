@@ -0,0 +1,265 @@
+#include "pch.h"
+#include "GoldenImageSuite.h"
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <png.h>
+
+namespace dae
+{
+	namespace
+	{
+		//0xAARRGGBB pixels without padding, the alpha is stored as well
+		bool SaveImage(const std::string& path, const uint32_t* pPixels, int width, int height)
+		{
+			//Little endian 0xAARRGGBB is B, G, R and A in memory
+			png_image image{};
+			image.version = PNG_IMAGE_VERSION;
+			image.width = static_cast<png_uint_32>(width);
+			image.height = static_cast<png_uint_32>(height);
+			image.format = PNG_FORMAT_BGRA;
+			return png_image_write_to_file(&image, path.c_str(), 0, pPixels, 0, nullptr) != 0;
+		}
+
+		bool LoadImage(const std::string& path, std::vector<uint32_t>& pixelsOut, int& widthOut, int& heightOut)
+		{
+			png_image image{};
+			image.version = PNG_IMAGE_VERSION;
+			if (!png_image_begin_read_from_file(&image, path.c_str())) {
+				return false;
+			}
+			image.format = PNG_FORMAT_BGRA;
+			pixelsOut.resize(static_cast<size_t>(image.width) * image.height);
+			if (!png_image_finish_read(&image, nullptr, pixelsOut.data(), 0, nullptr)) {
+				png_image_free(&image);
+				return false;
+			}
+			widthOut = static_cast<int>(image.width);
+			heightOut = static_cast<int>(image.height);
+			return true;
+		}
+	}
+
+	GoldenImageSuite::GoldenImageSuite(Renderer_Software* pRenderer, Camera* pCamera, Mesh* pInstancedMesh, const Settings& settings) :
+		m_pRenderer{ pRenderer },
+		m_pCamera{ pCamera },
+		m_pInstancedMesh{ pInstancedMesh },
+		m_Settings{ settings }
+	{
+		if (!m_Settings.referenceDirectory.empty() && m_Settings.referenceDirectory.back() != '/' && m_Settings.referenceDirectory.back() != '\\') {
+			m_Settings.referenceDirectory += '/';
+		}
+		AddCases();
+	}
+
+	void GoldenImageSuite::AddCases()
+	{
+		using ShadingMode = Renderer_Software::ShadingMode;
+		using Cullmode = Renderer::Cullmode;
+
+		//The start pose of the application, looking at the front of the vehicle
+		const Vector3 frontOrigin{ 0.f, 0.f, 0.f };
+		//From the back left, so the fire is in front of the vehicle
+		const Vector3 sideOrigin{ -30.f, 10.f, 80.f };
+		const float sideYaw{ 135.f };
+		const float sidePitch{ -15.f };
+
+		Renderer_Software::RenderStates states{};
+		m_Cases.push_back(Case{ "front_combined", frontOrigin, 0.f, 0.f, states });
+
+		states.shadingMode = ShadingMode::ObservedArea;
+		m_Cases.push_back(Case{ "front_observed_area", frontOrigin, 0.f, 0.f, states });
+		states.shadingMode = ShadingMode::Diffuse;
+		m_Cases.push_back(Case{ "front_diffuse", frontOrigin, 0.f, 0.f, states });
+		states.shadingMode = ShadingMode::Specular;
+		m_Cases.push_back(Case{ "front_specular", frontOrigin, 0.f, 0.f, states });
+		states.shadingMode = ShadingMode::Combined;
+
+		states.useNormalMap = false;
+		m_Cases.push_back(Case{ "front_no_normal_map", frontOrigin, 0.f, 0.f, states });
+		states.useNormalMap = true;
+
+		states.cullmode = Cullmode::frontFace;
+		m_Cases.push_back(Case{ "front_cull_front_faces", frontOrigin, 0.f, 0.f, states });
+		states.cullmode = Cullmode::none;
+		m_Cases.push_back(Case{ "front_cull_none", frontOrigin, 0.f, 0.f, states });
+		states.cullmode = Cullmode::backFace;
+
+		states.renderDepthBuffer = true;
+		m_Cases.push_back(Case{ "front_depth", frontOrigin, 0.f, 0.f, states });
+		states.renderDepthBuffer = false;
+
+		states.renderBoundingBox = true;
+		states.useUniformClearColor = true;
+		m_Cases.push_back(Case{ "front_bounding_box", frontOrigin, 0.f, 0.f, states });
+		states.renderBoundingBox = false;
+		states.useUniformClearColor = false;
+
+		m_Cases.push_back(Case{ "side_fire", sideOrigin, sideYaw, sidePitch, states });
+		states.renderFire = false;
+		m_Cases.push_back(Case{ "side_no_fire", sideOrigin, sideYaw, sidePitch, states });
+		states.renderFire = true;
+		states.cullmode = Cullmode::none;
+		m_Cases.push_back(Case{ "side_fire_cull_none", sideOrigin, sideYaw, sidePitch, states });
+		states.cullmode = Cullmode::backFace;
+
+		states.renderShadows = true;
+		m_Cases.push_back(Case{ "side_shadows", sideOrigin, sideYaw, sidePitch, states });
+		states.shadowFilterSize = 1;
+		m_Cases.push_back(Case{ "side_shadows_hard", sideOrigin, sideYaw, sidePitch, states });
+		states.renderShadows = false;
+		states.shadowFilterSize = Renderer_Software::RenderStates{}.shadowFilterSize;
+
+		//The cases below change the scene, so they come last and every one keeps what the ones before it added
+		//Point lights in front of the vehicle whose ranges overlap, so tiles get several lights and tiles at the edges only some of them
+		Case pointLightCase{ "front_point_lights", frontOrigin, 0.f, 0.f, states };
+		pointLightCase.addedPointLights = {
+			PointLight{ Vector3{ -12.f, 4.f, 35.f }, colors::Red, 150.f, 25.f },
+			PointLight{ Vector3{ 12.f, 4.f, 35.f }, colors::Green, 150.f, 25.f },
+			PointLight{ Vector3{ 0.f, -6.f, 30.f }, colors::Blue, 150.f, 20.f },
+			PointLight{ Vector3{ 0.f, 12.f, 40.f }, colors::White, 100.f, 15.f } };
+		m_Cases.push_back(pointLightCase);
+		m_Cases.push_back(Case{ "side_point_lights", sideOrigin, sideYaw, sidePitch, states });
+
+		//Instances further away, so they are drawn at coarser levels of detail, the closest ones are lit by the point lights
+		Case instanceCase{ "front_instances", frontOrigin, 0.f, 0.f, states };
+		instanceCase.addedInstances = {
+			Vector3{ -30.f, -5.f, 65.f },
+			Vector3{ 35.f, 0.f, 80.f },
+			Vector3{ -20.f, 10.f, 95.f } };
+		m_Cases.push_back(instanceCase);
+		m_Cases.push_back(Case{ "side_instances", sideOrigin, sideYaw, sidePitch, states });
+	}
+
+	bool GoldenImageSuite::Record()
+	{
+		bool hasSucceeded{ true };
+		for (const Case& testCase : m_Cases) {
+			AddToScene(testCase);
+			const float frameTime = RenderCase(testCase);
+			const std::string path = GetImagePath(testCase);
+			if (!SaveImage(path, m_pRenderer->GetPixels(), m_pRenderer->GetWidth(), m_pRenderer->GetHeight())) {
+				std::cout << "[FAIL] " << testCase.name << ": couldn't write " << path << std::endl;
+				hasSucceeded = false;
+				continue;
+			}
+			std::cout << "[RECORDED] " << testCase.name << " " << std::fixed << std::setprecision(2) << frameTime << " ms" << std::endl;
+		}
+		return hasSucceeded;
+	}
+
+	int GoldenImageSuite::Check()
+	{
+		int amountOfFailures{};
+		for (const Case& testCase : m_Cases) {
+			AddToScene(testCase);
+			const float frameTime = RenderCase(testCase);
+			const int width = m_pRenderer->GetWidth();
+			const int height = m_pRenderer->GetHeight();
+
+			std::vector<uint32_t> reference{};
+			int referenceWidth{};
+			int referenceHeight{};
+			if (!LoadImage(GetImagePath(testCase), reference, referenceWidth, referenceHeight)) {
+				std::cout << "[FAIL] " << testCase.name << ": no reference image at " << GetImagePath(testCase) << std::endl;
+				++amountOfFailures;
+				continue;
+			}
+			if (referenceWidth != width || referenceHeight != height) {
+				std::cout << "[FAIL] " << testCase.name << ": the reference image has a different size" << std::endl;
+				++amountOfFailures;
+				continue;
+			}
+
+			const int amountOfPixels = width * height;
+			const Comparison comparison = Compare(m_pRenderer->GetPixels(), reference.data(), amountOfPixels, m_Settings.pixelTolerance);
+			const float differentPixelRatio = static_cast<float>(comparison.amountOfDifferentPixels) / static_cast<float>(amountOfPixels);
+			const bool isImageCorrect = differentPixelRatio <= m_Settings.maxDifferentPixelRatio && comparison.psnr >= m_Settings.minPSNR;
+			const bool isWithinBudget = m_Settings.frameBudgetMs <= 0.f || frameTime <= m_Settings.frameBudgetMs;
+
+			std::cout << (isImageCorrect && isWithinBudget ? "[PASS] " : "[FAIL] ") << testCase.name << ": "
+				<< std::fixed << std::setprecision(2) << comparison.psnr << " dB, "
+				<< comparison.amountOfDifferentPixels << " pixels over the tolerance, largest difference " << comparison.maxDifference << ", "
+				<< frameTime << " ms";
+			if (!isWithinBudget) {
+				std::cout << " over the budget of " << m_Settings.frameBudgetMs << " ms";
+			}
+			std::cout << std::endl;
+
+			if (!isImageCorrect || !isWithinBudget) {
+				++amountOfFailures;
+			}
+			//Keep the wrong image to look at next to the reference
+			if (!isImageCorrect) {
+				SaveImage(GetImagePath(testCase, "_failed"), m_pRenderer->GetPixels(), width, height);
+			}
+		}
+
+		std::cout << m_Cases.size() - amountOfFailures << " of " << m_Cases.size() << " golden image cases passed" << std::endl;
+		return amountOfFailures;
+	}
+
+	float GoldenImageSuite::RenderCase(const Case& testCase)
+	{
+		m_pRenderer->SetRenderStates(testCase.states);
+
+		m_pCamera->origin = testCase.cameraOrigin;
+		m_pCamera->totalYaw = testCase.cameraYaw * TO_RADIANS;
+		m_pCamera->totalPitch = testCase.cameraPitch * TO_RADIANS;
+		m_pCamera->CalculateViewMatrix();
+		m_pCamera->CalculateProjectionMatrix();
+
+		//The first frame also picks the levels of detail and fills the caches, it isn't timed
+		m_pRenderer->InvalidateFrame();
+		m_pRenderer->Render();
+
+		//Every timed frame is a full redraw, frames where nothing changed would be skipped
+		const int amountOfFrames = std::max(m_Settings.amountOfTimedFrames, 1);
+		const auto start = std::chrono::steady_clock::now();
+		for (int i{}; i < amountOfFrames; ++i) {
+			m_pRenderer->InvalidateFrame();
+			m_pRenderer->Render();
+		}
+		const std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / static_cast<float>(amountOfFrames);
+	}
+
+	void GoldenImageSuite::AddToScene(const Case& testCase)
+	{
+		for (const PointLight& light : testCase.addedPointLights) {
+			m_pRenderer->AddPointLight(light.origin, light.color, light.intensity, light.range);
+		}
+		for (const Vector3& translation : testCase.addedInstances) {
+			m_pInstancedMesh->AddInstance(translation, Vector3{ 1.f, 1.f, 1.f }, m_pInstancedMesh->instances.front().totalYaw);
+		}
+	}
+
+	std::string GoldenImageSuite::GetImagePath(const Case& testCase, const std::string& suffix) const
+	{
+		return m_Settings.referenceDirectory + testCase.name + suffix + ".png";
+	}
+
+	GoldenImageSuite::Comparison GoldenImageSuite::Compare(const uint32_t* pImage, const uint32_t* pReference, int amountOfPixels, int pixelTolerance)
+	{
+		Comparison comparison{};
+		double squaredErrorSum{};
+		for (int i{}; i < amountOfPixels; ++i) {
+			//Red, green and blue, the alpha isn't compared
+			int pixelDifference{};
+			for (int shift{}; shift < 24; shift += 8) {
+				const int difference = std::abs(static_cast<int>((pImage[i] >> shift) & 0xFF) - static_cast<int>((pReference[i] >> shift) & 0xFF));
+				pixelDifference = std::max(pixelDifference, difference);
+				squaredErrorSum += static_cast<double>(difference * difference);
+			}
+			comparison.maxDifference = std::max(comparison.maxDifference, pixelDifference);
+			if (pixelDifference > pixelTolerance) {
+				++comparison.amountOfDifferentPixels;
+			}
+		}
+
+		//Identical images have an infinite PSNR, it is capped so it still prints as a number
+		const double meanSquaredError = squaredErrorSum / (3.0 * amountOfPixels);
+		comparison.psnr = meanSquaredError > 0.0 ? static_cast<float>(10.0 * std::log10(255.0 * 255.0 / meanSquaredError)) : 100.f;
+		return comparison;
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Renderer_Software.h"
+
+namespace dae
+{
+	//Renders fixed scenes with the software renderer at fixed camera poses and compares them with stored reference images
+	//Record writes the references, Check fails on images that differ too much from them and on frames slower than the budget
+	//The references are PNG files in the repository, written with libpng
+	class GoldenImageSuite final
+	{
+	public:
+		struct Settings
+		{
+			//Folder with one reference image for every case
+			std::string referenceDirectory{ "Resources/GoldenImages/" };
+			//Largest difference of a color channel, out of 255, for two pixels to count as the same
+			int pixelTolerance{ 8 };
+			//Share of the pixels that may differ by more than the tolerance
+			float maxDifferentPixelRatio{ 0.002f };
+			//Lowest peak signal to noise ratio over the whole image, in dB
+			float minPSNR{ 40.f };
+			//Largest average time of a full redraw in milliseconds, 0 turns the check off
+			float frameBudgetMs{ 0.f };
+			//Frames rendered for the timing, after one frame to warm up
+			int amountOfTimedFrames{ 10 };
+		};
+
+		//The instance cases add copies of pInstancedMesh, it has to be one of the meshes of the renderer
+		GoldenImageSuite(Renderer_Software* pRenderer, Camera* pCamera, Mesh* pInstancedMesh, const Settings& settings);
+		~GoldenImageSuite() = default;
+
+		//Rule of 5
+		GoldenImageSuite(const GoldenImageSuite&) = delete;
+		GoldenImageSuite(GoldenImageSuite&&) noexcept = delete;
+		GoldenImageSuite& operator=(const GoldenImageSuite&) = delete;
+		GoldenImageSuite& operator=(GoldenImageSuite&&) noexcept = delete;
+
+		//Writes the reference image of every case, returns false if one couldn't be written
+		bool Record();
+		//Returns the amount of cases that failed, the image of a failed case is saved next to its reference
+		int Check();
+
+	private:
+		struct PointLight
+		{
+			Vector3 origin{};
+			ColorRGB color{};
+			float intensity{};
+			float range{};
+		};
+
+		struct Case
+		{
+			std::string name{};
+			Vector3 cameraOrigin{};
+			//In degrees
+			float cameraYaw{};
+			float cameraPitch{};
+			Renderer_Software::RenderStates states{};
+			//Added to the scene before the case is drawn, they stay for the cases after it
+			std::vector<PointLight> addedPointLights{};
+			//Translations of the instances of the instanced mesh that are added, unscaled and with the rotation of its first instance
+			std::vector<Vector3> addedInstances{};
+		};
+
+		struct Comparison
+		{
+			int amountOfDifferentPixels{};
+			int maxDifference{};
+			float psnr{};
+		};
+
+		Renderer_Software* m_pRenderer{};
+		Camera* m_pCamera{};
+		Mesh* m_pInstancedMesh{};
+		Settings m_Settings{};
+		std::vector<Case> m_Cases{};
+
+		void AddCases();
+		//Draws the case from scratch like after any change, returns the average time of a frame in milliseconds
+		float RenderCase(const Case& testCase);
+		//Adds the lights and instances of the case to the scene
+		void AddToScene(const Case& testCase);
+		std::string GetImagePath(const Case& testCase, const std::string& suffix = "") const;
+		//Both images are 0xAARRGGBB pixels without padding, of the same size
+		static Comparison Compare(const uint32_t* pImage, const uint32_t* pReference, int amountOfPixels, int pixelTolerance);
+	};
+}
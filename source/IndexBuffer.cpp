@@ -0,0 +1,171 @@
+#include "pch.h"
+#include "IndexBuffer.h"
+#include <limits>
+
+namespace
+{
+	//Largest amount of vertices 16 bit indices can reach
+	constexpr size_t MaxVerticesFor16Bit{ 65536 };
+
+	void WriteVarint(std::vector<uint8_t>& bytes, uint64_t value)
+	{
+		while (value >= 0x80) {
+			bytes.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		bytes.push_back(static_cast<uint8_t>(value));
+	}
+
+	bool ReadVarint(const uint8_t*& pData, const uint8_t* pEnd, uint64_t& value)
+	{
+		value = 0;
+		for (int shift{}; shift < 64; shift += 7) {
+			if (pData == pEnd) {
+				return false;
+			}
+			const uint8_t byte = *pData++;
+			value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//Small negative and positive differences both become small values
+	uint64_t ZigZagEncode(int64_t value)
+	{
+		return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+	}
+
+	int64_t ZigZagDecode(uint64_t value)
+	{
+		return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+	}
+
+	template<typename IndexType>
+	bool DecodeIndices(const uint8_t* pData, const uint8_t* pEnd, std::vector<IndexType>& indicesOut, size_t amountOfIndices)
+	{
+		indicesOut.resize(amountOfIndices);
+		int64_t previousIndex{};
+		for (size_t i{}; i < amountOfIndices; ++i) {
+			uint64_t encodedDifference{};
+			if (!ReadVarint(pData, pEnd, encodedDifference)) {
+				return false;
+			}
+			const int64_t index = previousIndex + ZigZagDecode(encodedDifference);
+			if (index < 0 || static_cast<uint64_t>(index) > std::numeric_limits<IndexType>::max()) {
+				return false;
+			}
+			indicesOut[i] = static_cast<IndexType>(index);
+			previousIndex = index;
+		}
+		return pData == pEnd;
+	}
+}
+
+IndexBuffer::IndexBuffer(const std::vector<uint32_t>& indices, size_t amountOfVertices) :
+	m_Is16Bit{ amountOfVertices <= MaxVerticesFor16Bit }
+{
+	if (m_Is16Bit) {
+		m_Indices16.assign(indices.begin(), indices.end());
+	}
+	else {
+		m_Indices32 = indices;
+	}
+}
+
+size_t IndexBuffer::GetAmountOfIndices() const
+{
+	return m_Is16Bit ? m_Indices16.size() : m_Indices32.size();
+}
+
+bool IndexBuffer::IsEmpty() const
+{
+	return GetAmountOfIndices() == 0;
+}
+
+bool IndexBuffer::Is16Bit() const
+{
+	return m_Is16Bit;
+}
+
+uint32_t IndexBuffer::operator[](size_t index) const
+{
+	return m_Is16Bit ? m_Indices16[index] : m_Indices32[index];
+}
+
+std::vector<uint32_t> IndexBuffer::ToVector() const
+{
+	if (m_Is16Bit) {
+		return std::vector<uint32_t>(m_Indices16.begin(), m_Indices16.end());
+	}
+	return m_Indices32;
+}
+
+const void* IndexBuffer::GetData() const
+{
+	return m_Is16Bit ? static_cast<const void*>(m_Indices16.data()) : static_cast<const void*>(m_Indices32.data());
+}
+
+size_t IndexBuffer::GetStride() const
+{
+	return m_Is16Bit ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+size_t IndexBuffer::GetSizeInBytes() const
+{
+	return GetAmountOfIndices() * GetStride();
+}
+
+std::vector<uint8_t> IndexBuffer::Compress() const
+{
+	//Width in bytes, amount of indices, then the differences
+	std::vector<uint8_t> bytes{};
+	const size_t amountOfIndices = GetAmountOfIndices();
+	bytes.reserve(amountOfIndices + 16);
+	bytes.push_back(static_cast<uint8_t>(GetStride()));
+	WriteVarint(bytes, amountOfIndices);
+
+	Visit([&](const auto* pIndices)
+		{
+			int64_t previousIndex{};
+			for (size_t i{}; i < amountOfIndices; ++i) {
+				const int64_t index = pIndices[i];
+				WriteVarint(bytes, ZigZagEncode(index - previousIndex));
+				previousIndex = index;
+			}
+		}
+	);
+	return bytes;
+}
+
+bool IndexBuffer::Decompress(const uint8_t* pData, size_t size)
+{
+	m_Indices16.clear();
+	m_Indices32.clear();
+	m_Is16Bit = false;
+
+	const uint8_t* pEnd = pData + size;
+	if (size == 0) {
+		return false;
+	}
+	const uint8_t stride = *pData++;
+	uint64_t amountOfIndices{};
+	//Every index takes at least one byte, this also stops huge allocations for corrupt data
+	if ((stride != sizeof(uint16_t) && stride != sizeof(uint32_t)) || !ReadVarint(pData, pEnd, amountOfIndices) ||
+		amountOfIndices > static_cast<uint64_t>(pEnd - pData)) {
+		return false;
+	}
+
+	m_Is16Bit = stride == sizeof(uint16_t);
+	const bool isValid = m_Is16Bit ?
+		DecodeIndices(pData, pEnd, m_Indices16, static_cast<size_t>(amountOfIndices)) :
+		DecodeIndices(pData, pEnd, m_Indices32, static_cast<size_t>(amountOfIndices));
+	if (!isValid) {
+		m_Indices16.clear();
+		m_Indices32.clear();
+		m_Is16Bit = false;
+	}
+	return isValid;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+//Indices of a mesh, stored as 16 bit when every vertex can be reached with them and as 32 bit otherwise
+//Meshlets are ranges of the index buffer of their mesh, so they use the width of their mesh
+class IndexBuffer final
+{
+public:
+	IndexBuffer() = default;
+	//All indices have to be smaller than amountOfVertices, it decides the width
+	IndexBuffer(const std::vector<uint32_t>& indices, size_t amountOfVertices);
+
+	size_t GetAmountOfIndices() const;
+	bool IsEmpty() const;
+	bool Is16Bit() const;
+	//Slower than Visit, meant for work at load time
+	uint32_t operator[](size_t index) const;
+	std::vector<uint32_t> ToVector() const;
+
+	//Raw storage for the GPU, GetStride is 2 or 4 bytes
+	const void* GetData() const;
+	size_t GetStride() const;
+	size_t GetSizeInBytes() const;
+
+	//Calls function once with a pointer to the first index, either const uint16_t* or const uint32_t*
+	//The function is compiled for both widths, so hot loops don't check the width per index
+	template<typename Function>
+	auto Visit(Function&& function) const
+	{
+		if (m_Is16Bit) {
+			return function(m_Indices16.data());
+		}
+		return function(m_Indices32.data());
+	}
+
+	//Compact encoding for files, the difference with the index before as a zigzag varint
+	//Meshlets keep neighbouring triangles together, so most indices take a single byte
+	std::vector<uint8_t> Compress() const;
+	//Decodes straight into the storage of the width the data was written with
+	//Returns false and leaves the buffer empty when the data is cut off or corrupt
+	bool Decompress(const uint8_t* pData, size_t size);
+
+private:
+	std::vector<uint16_t> m_Indices16{};
+	std::vector<uint32_t> m_Indices32{};
+	bool m_Is16Bit{};
+};
@@ -0,0 +1,94 @@
+#include "pch.h"
+#include "IndexBuffer.h"
+#include <random>
+#include <string>
+
+//Round trips and corrupt data for the index codec, run by ctest
+namespace
+{
+	int g_AmountOfFailures{};
+
+	void Expect(bool condition, const std::string& description)
+	{
+		if (!condition) {
+			std::cout << "[FAIL] " << description << std::endl;
+			++g_AmountOfFailures;
+		}
+	}
+
+	//Mostly nearby indices like a meshlet, with some far jumps that need long varints
+	std::vector<uint32_t> MakeIndices(size_t amountOfIndices, uint32_t amountOfVertices, uint32_t seed)
+	{
+		std::mt19937 random{ seed };
+		std::uniform_int_distribution<int> step{ -8, 8 };
+		std::uniform_int_distribution<uint32_t> jump{ 0, amountOfVertices - 1 };
+		std::vector<uint32_t> indices(amountOfIndices);
+		int64_t index{};
+		for (uint32_t& value : indices) {
+			index = (random() % 16 == 0) ? jump(random) : std::clamp<int64_t>(index + step(random), 0, amountOfVertices - 1);
+			value = static_cast<uint32_t>(index);
+		}
+		return indices;
+	}
+
+	void TestRoundTrip(const std::string& name, const std::vector<uint32_t>& indices, size_t amountOfVertices, bool is16Bit)
+	{
+		const IndexBuffer original{ indices, amountOfVertices };
+		Expect(original.Is16Bit() == is16Bit, name + ": width");
+		const std::vector<uint8_t> compressed = original.Compress();
+
+		IndexBuffer decompressed{};
+		Expect(decompressed.Decompress(compressed.data(), compressed.size()), name + ": decompress");
+		Expect(decompressed.Is16Bit() == is16Bit, name + ": width after the round trip");
+		Expect(decompressed.ToVector() == indices, name + ": indices after the round trip");
+
+		//Cut off versions have to be rejected and leave the buffer empty, every cut in the header and a spread of cuts after it
+		bool areAllCutsRejected{ true };
+		for (size_t size{}; size < compressed.size(); size += size < 64 ? 1 : 997) {
+			IndexBuffer cut{};
+			areAllCutsRejected &= !cut.Decompress(compressed.data(), size) && cut.IsEmpty();
+		}
+		Expect(areAllCutsRejected, name + ": cut off data");
+
+		//Trailing bytes mean the count doesn't match the data
+		std::vector<uint8_t> extended = compressed;
+		extended.push_back(0);
+		IndexBuffer extendedBuffer{};
+		Expect(!extendedBuffer.Decompress(extended.data(), extended.size()) && extendedBuffer.IsEmpty(), name + ": trailing data");
+	}
+
+	void TestCorruptData()
+	{
+		IndexBuffer buffer{};
+		//Widths other than 2 and 4 bytes
+		const std::vector<uint8_t> wrongStride{ 3, 1, 0 };
+		Expect(!buffer.Decompress(wrongStride.data(), wrongStride.size()), "corrupt: stride");
+		//A count far beyond the data would allocate a huge buffer
+		const std::vector<uint8_t> hugeCount{ 4, 0xFF, 0xFF, 0xFF, 0xFF, 0x0F, 0 };
+		Expect(!buffer.Decompress(hugeCount.data(), hugeCount.size()), "corrupt: count");
+		//A varint that never ends
+		const std::vector<uint8_t> endlessVarint{ 4, 1, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+		Expect(!buffer.Decompress(endlessVarint.data(), endlessVarint.size()), "corrupt: varint");
+		//Index 65536 doesn't fit 16 bit, zigzag 131072 is a difference of +65536
+		const std::vector<uint8_t> tooLarge{ 2, 1, 0x80, 0x80, 0x08 };
+		Expect(!buffer.Decompress(tooLarge.data(), tooLarge.size()), "corrupt: index beyond 16 bit");
+		//Difference of -1 from the start
+		const std::vector<uint8_t> negative{ 4, 1, 1 };
+		Expect(!buffer.Decompress(negative.data(), negative.size()), "corrupt: negative index");
+		Expect(buffer.IsEmpty() && !buffer.Is16Bit(), "corrupt: buffer left empty");
+		Expect(!buffer.Decompress(nullptr, 0), "corrupt: no data");
+	}
+}
+
+int main()
+{
+	TestRoundTrip("16 bit", MakeIndices(30000, 65536, 1), 65536, true);
+	TestRoundTrip("32 bit", MakeIndices(30000, 1 << 20, 2), 1 << 20, false);
+	TestRoundTrip("empty", {}, 3, true);
+	TestCorruptData();
+
+	if (g_AmountOfFailures == 0) {
+		std::cout << "All index buffer tests passed" << std::endl;
+	}
+	return g_AmountOfFailures == 0 ? 0 : 1;
+}
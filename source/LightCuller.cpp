@@ -0,0 +1,204 @@
+#include "pch.h"
+#include "LightCuller.h"
+#include "Parallel.h"
+
+using namespace dae;
+
+LightCuller::LightCuller(int width, int height) :
+	m_Width{ width },
+	m_Height{ height }
+{
+	m_AmountOfTilesX = (width + TileSize - 1) / TileSize;
+	m_AmountOfTilesY = (height + TileSize - 1) / TileSize;
+
+	const int amountOfTiles = m_AmountOfTilesX * m_AmountOfTilesY;
+	m_TileMinDepth.resize(amountOfTiles);
+	m_TileMaxDepth.resize(amountOfTiles);
+	m_TileLightOffsets.resize(amountOfTiles);
+	m_TileLightCounts.resize(amountOfTiles);
+}
+
+void LightCuller::Cull(const std::vector<Light*>& pLights, const dae::Camera* pCamera, const GBufferPixel* pGBuffer, FrameArena& frameArena)
+{
+	CalculateTileDepthBounds(pGBuffer);
+
+	//Screen and depth bounds for every light, only done once per light
+	m_LightBounds.Reserve(frameArena, pLights.size());
+	for (const auto pLight : pLights) {
+		m_LightBounds.push_back(CalculateLightBounds(pLight, pCamera));
+	}
+
+	const uint32_t amountOfTiles = static_cast<uint32_t>(m_AmountOfTilesX * m_AmountOfTilesY);
+	const uint32_t amountOfLights = static_cast<uint32_t>(m_LightBounds.size());
+
+	//Count the lights per tile
+	ParallelFor(0u, amountOfTiles, [=, this](uint32_t tileIndex)
+		{
+			const int tileX = tileIndex % m_AmountOfTilesX;
+			const int tileY = tileIndex / m_AmountOfTilesX;
+
+			uint32_t count{};
+			for (uint32_t lightIndex{}; lightIndex < amountOfLights; ++lightIndex) {
+				if (DoesLightAffectTile(m_LightBounds[lightIndex], tileX, tileY)) {
+					++count;
+				}
+			}
+			m_TileLightCounts[tileIndex] = count;
+		}
+	);
+
+	//Offsets into the compact index list
+	uint32_t totalCount{};
+	for (uint32_t tileIndex{}; tileIndex < amountOfTiles; ++tileIndex) {
+		m_TileLightOffsets[tileIndex] = totalCount;
+		totalCount += m_TileLightCounts[tileIndex];
+	}
+	m_LightIndices.Resize(frameArena, totalCount);
+
+	//Fill in the light indices
+	ParallelFor(0u, amountOfTiles, [=, this](uint32_t tileIndex)
+		{
+			const int tileX = tileIndex % m_AmountOfTilesX;
+			const int tileY = tileIndex / m_AmountOfTilesX;
+
+			uint32_t* pTileLights = m_LightIndices.data() + m_TileLightOffsets[tileIndex];
+			for (uint32_t lightIndex{}; lightIndex < amountOfLights; ++lightIndex) {
+				if (DoesLightAffectTile(m_LightBounds[lightIndex], tileX, tileY)) {
+					*pTileLights = lightIndex;
+					++pTileLights;
+				}
+			}
+		}
+	);
+}
+
+const uint32_t* LightCuller::GetTileLights(int tileIndex, uint32_t& lightCount) const
+{
+	lightCount = m_TileLightCounts[tileIndex];
+	return m_LightIndices.data() + m_TileLightOffsets[tileIndex];
+}
+
+int LightCuller::GetAmountOfTilesX() const
+{
+	return m_AmountOfTilesX;
+}
+
+int LightCuller::GetAmountOfTilesY() const
+{
+	return m_AmountOfTilesY;
+}
+
+void LightCuller::CalculateTileDepthBounds(const GBufferPixel* pGBuffer)
+{
+	const uint32_t amountOfTiles = static_cast<uint32_t>(m_AmountOfTilesX * m_AmountOfTilesY);
+	ParallelFor(0u, amountOfTiles, [=, this](uint32_t tileIndex)
+		{
+			const int startX = (tileIndex % m_AmountOfTilesX) * TileSize;
+			const int startY = (tileIndex / m_AmountOfTilesX) * TileSize;
+			const int endX = std::min(startX + TileSize, m_Width);
+			const int endY = std::min(startY + TileSize, m_Height);
+
+			//Empty tiles keep min > max so no light overlaps them
+			float minDepth{ FLT_MAX };
+			float maxDepth{ -FLT_MAX };
+			for (int py{ startY }; py < endY; ++py) {
+				for (int px{ startX }; px < endX; ++px) {
+					const GBufferPixel& pixel = pGBuffer[px + (py * m_Width)];
+					if (!pixel.pMesh) {
+						continue;
+					}
+					//w still holds the view space depth
+					minDepth = std::min(minDepth, pixel.vertex.position.w);
+					maxDepth = std::max(maxDepth, pixel.vertex.position.w);
+				}
+			}
+			m_TileMinDepth[tileIndex] = minDepth;
+			m_TileMaxDepth[tileIndex] = maxDepth;
+		}
+	);
+}
+
+LightCuller::LightBounds LightCuller::CalculateLightBounds(const Light* pLight, const dae::Camera* pCamera) const
+{
+	LightBounds bounds{};
+
+	//Directional lights and point lights without a range can reach every tile
+	if (pLight->type == LightType::Directional || pLight->range <= 0.f) {
+		bounds.isGlobal = true;
+		bounds.isVisible = true;
+		return bounds;
+	}
+
+	const Vector3 viewCenter = pCamera->viewMatrix.TransformPoint(pLight->origin);
+	const float range = pLight->range;
+
+	bounds.minDepth = viewCenter.z - range;
+	bounds.maxDepth = viewCenter.z + range;
+
+	//Completely behind the camera
+	if (bounds.maxDepth < pCamera->nearPlane) {
+		return bounds;
+	}
+	bounds.isVisible = true;
+
+	//Sphere crosses the near plane, projecting it is not possible so use the whole screen
+	if (bounds.minDepth < pCamera->nearPlane) {
+		bounds.minTile = { 0, 0 };
+		bounds.maxTile = { m_AmountOfTilesX - 1, m_AmountOfTilesY - 1 };
+		return bounds;
+	}
+
+	//Project the corners of the view space box around the sphere, this is a conservative screen rect
+	float minX{ FLT_MAX }, minY{ FLT_MAX };
+	float maxX{ -FLT_MAX }, maxY{ -FLT_MAX };
+	for (int corner{}; corner < 8; ++corner) {
+		const Vector4 viewCorner{
+			viewCenter.x + ((corner & 1) ? range : -range),
+			viewCenter.y + ((corner & 2) ? range : -range),
+			viewCenter.z + ((corner & 4) ? range : -range),
+			1.f };
+		const Vector4 projectedCorner = pCamera->projectionMatrix.TransformPoint(viewCorner);
+
+		//NDC to raster space
+		const float rasterX = (projectedCorner.x / projectedCorner.w + 1) / 2.f * static_cast<float>(m_Width);
+		const float rasterY = (1 - projectedCorner.y / projectedCorner.w) / 2.f * static_cast<float>(m_Height);
+
+		minX = std::min(minX, rasterX);
+		minY = std::min(minY, rasterY);
+		maxX = std::max(maxX, rasterX);
+		maxY = std::max(maxY, rasterY);
+	}
+
+	//Off screen
+	if (maxX < 0 || maxY < 0 || minX >= m_Width || minY >= m_Height) {
+		bounds.isVisible = false;
+		return bounds;
+	}
+
+	bounds.minTile.x = Clamp(static_cast<int>(minX) / TileSize, 0, m_AmountOfTilesX - 1);
+	bounds.minTile.y = Clamp(static_cast<int>(minY) / TileSize, 0, m_AmountOfTilesY - 1);
+	bounds.maxTile.x = Clamp(static_cast<int>(maxX) / TileSize, 0, m_AmountOfTilesX - 1);
+	bounds.maxTile.y = Clamp(static_cast<int>(maxY) / TileSize, 0, m_AmountOfTilesY - 1);
+	return bounds;
+}
+
+bool LightCuller::DoesLightAffectTile(const LightBounds& bounds, int tileX, int tileY) const
+{
+	const int tileIndex = tileX + (tileY * m_AmountOfTilesX);
+	const float tileMinDepth = m_TileMinDepth[tileIndex];
+	const float tileMaxDepth = m_TileMaxDepth[tileIndex];
+
+	//Nothing to light in this tile
+	if (tileMinDepth > tileMaxDepth || !bounds.isVisible) {
+		return false;
+	}
+	if (bounds.isGlobal) {
+		return true;
+	}
+
+	if (tileX < bounds.minTile.x || tileX > bounds.maxTile.x ||
+		tileY < bounds.minTile.y || tileY > bounds.maxTile.y) {
+		return false;
+	}
+	return bounds.maxDepth >= tileMinDepth && bounds.minDepth <= tileMaxDepth;
+}
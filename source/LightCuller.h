@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+#include "Camera.h"
+#include "DataTypes.h"
+#include "FrameArena.h"
+
+//Splits the screen in tiles and builds a compact light list per tile
+//Point lights are culled against the screen rect and depth bounds of every tile, directional lights are added to every covered tile
+class LightCuller final
+{
+public:
+	LightCuller(int width, int height);
+	~LightCuller() = default;
+
+	//Rule of 5
+	LightCuller(const LightCuller&) = delete;
+	LightCuller(LightCuller&&) noexcept = delete;
+	LightCuller& operator=(const LightCuller&) = delete;
+	LightCuller& operator=(LightCuller&&) noexcept = delete;
+
+	static constexpr int TileSize{ 16 };
+
+	//Needs a filled GBuffer, the depth bounds of every tile are taken from it
+	//The light lists are stored in the frame arena, so they are only valid until it is reset
+	void Cull(const std::vector<Light*>& pLights, const dae::Camera* pCamera, const GBufferPixel* pGBuffer, FrameArena& frameArena);
+
+	//Indices into the light vector that was culled
+	const uint32_t* GetTileLights(int tileIndex, uint32_t& lightCount) const;
+
+	int GetAmountOfTilesX() const;
+	int GetAmountOfTilesY() const;
+
+private:
+	struct LightBounds
+	{
+		dae::Int2 minTile{};
+		dae::Int2 maxTile{};
+		float minDepth{};
+		float maxDepth{};
+		bool isGlobal{};
+		bool isVisible{};
+	};
+
+	int m_Width{};
+	int m_Height{};
+	int m_AmountOfTilesX{};
+	int m_AmountOfTilesY{};
+
+	//View space depth bounds of the geometry in every tile
+	std::vector<float> m_TileMinDepth{};
+	std::vector<float> m_TileMaxDepth{};
+
+	FrameVector<LightBounds> m_LightBounds{};
+
+	//Compact light lists, tile i uses m_TileLightCounts[i] indices starting at m_TileLightOffsets[i]
+	std::vector<uint32_t> m_TileLightOffsets{};
+	std::vector<uint32_t> m_TileLightCounts{};
+	FrameVector<uint32_t> m_LightIndices{};
+
+	void CalculateTileDepthBounds(const GBufferPixel* pGBuffer);
+	LightBounds CalculateLightBounds(const Light* pLight, const dae::Camera* pCamera) const;
+	bool DoesLightAffectTile(const LightBounds& bounds, int tileX, int tileY) const;
+};
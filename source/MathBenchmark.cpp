@@ -0,0 +1,258 @@
+#include "pch.h"
+#include "MathBenchmark.h"
+#include "Texture.h"
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <memory>
+#include <random>
+
+namespace dae
+{
+	namespace
+	{
+		//Power of two so the input index is a mask, small enough for the inputs to stay in the cache
+		constexpr int AmountOfInputs{ 1024 };
+		constexpr int InputMask{ AmountOfInputs - 1 };
+
+		Vector3 RandomVector3(std::mt19937& generator)
+		{
+			std::uniform_real_distribution<float> distribution{ -10.f, 10.f };
+			return Vector3{ distribution(generator), distribution(generator), distribution(generator) };
+		}
+
+		//Rotation, scale and translation like a world matrix, so every matrix can be inverted
+		Matrix RandomWorldMatrix(std::mt19937& generator)
+		{
+			std::uniform_real_distribution<float> angle{ -PI, PI };
+			std::uniform_real_distribution<float> scale{ 0.5f, 2.f };
+			return Matrix::CreateScale(scale(generator), scale(generator), scale(generator))
+				* Matrix::CreateRotation(angle(generator), angle(generator), angle(generator))
+				* Matrix::CreateTranslation(RandomVector3(generator));
+		}
+	}
+
+	MathBenchmark::MathBenchmark(const Settings& settings) :
+		m_Settings{ settings }
+	{
+		m_Settings.amountOfRepetitions = std::max(m_Settings.amountOfRepetitions, 1);
+		m_Settings.operationsPerRepetition = std::max(m_Settings.operationsPerRepetition, 1);
+	}
+
+	std::vector<MathBenchmark::Result> MathBenchmark::Run()
+	{
+		//Same inputs on every run, so runs can be compared
+		std::mt19937 generator{ 1234 };
+		std::uniform_real_distribution<float> unit{ 0.f, 1.f };
+
+		std::vector<Matrix> matrices(AmountOfInputs);
+		std::vector<Vector3> vectors(AmountOfInputs);
+		std::vector<Vector3> otherVectors(AmountOfInputs);
+		std::vector<Vector4> points(AmountOfInputs);
+		std::vector<Vector2> uvs(AmountOfInputs);
+		std::vector<ColorRGB> colors(AmountOfInputs);
+		std::vector<ColorRGB> otherColors(AmountOfInputs);
+		for (int i{}; i < AmountOfInputs; ++i) {
+			matrices[i] = RandomWorldMatrix(generator);
+			vectors[i] = RandomVector3(generator);
+			otherVectors[i] = RandomVector3(generator);
+			points[i] = Vector4{ RandomVector3(generator), 1.f };
+			uvs[i] = Vector2{ unit(generator), unit(generator) };
+			colors[i] = ColorRGB{ unit(generator), unit(generator), unit(generator) };
+			otherColors[i] = ColorRGB{ unit(generator), unit(generator), unit(generator) };
+		}
+
+		std::cout << "Math benchmarks: " << m_Settings.amountOfRepetitions << " repetitions of " << m_Settings.operationsPerRepetition << " operations" << std::endl;
+		std::cout << std::left << std::setw(28) << "benchmark" << std::right
+			<< std::setw(12) << "min ns" << std::setw(12) << "median ns" << std::setw(12) << "mean ns" << std::setw(12) << "stddev ns"
+			<< std::setw(14) << "Mops/s" << std::endl;
+
+		std::vector<Result> results{};
+
+		//Matrix
+		Measure("Matrix multiply", [&](int i)
+			{
+				const Matrix result = matrices[i] * matrices[(i + 1) & InputMask];
+				return result[3].x;
+			}, results);
+		Measure("Matrix inverse", [&](int i)
+			{
+				const Matrix result = Matrix::Inverse(matrices[i]);
+				return result[3].x;
+			}, results);
+		Measure("Matrix inverse affine", [&](int i)
+			{
+				const Matrix result = Matrix::InverseAffine(matrices[i]);
+				return result[3].x;
+			}, results);
+		Measure("Matrix inverse rigid", [&](int i)
+			{
+				const Matrix result = Matrix::InverseRigid(matrices[i]);
+				return result[3].x;
+			}, results);
+		Measure("Matrix transpose", [&](int i)
+			{
+				const Matrix result = Matrix::Transpose(matrices[i]);
+				return result[3].x;
+			}, results);
+		Measure("Matrix TransformPoint3", [&](int i)
+			{
+				return matrices[i & 15].TransformPoint(vectors[i]).x;
+			}, results);
+		Measure("Matrix TransformPoint4", [&](int i)
+			{
+				return matrices[i & 15].TransformPoint(points[i]).w;
+			}, results);
+		Measure("Matrix TransformVector", [&](int i)
+			{
+				return matrices[i & 15].TransformVector(vectors[i]).x;
+			}, results);
+
+		//The batched transforms do a run of points per operation, the times are per point
+		constexpr int BatchSize{ 64 };
+		std::vector<Vector3> transformedVectors(AmountOfInputs);
+		std::vector<Vector4> transformedPoints(AmountOfInputs);
+		Measure("Matrix TransformPoints3 batch", [&](int i)
+			{
+				const int first = i & ~(BatchSize - 1);
+				if (i == first) {
+					matrices[i & 15].TransformPoints(&vectors[first], &transformedVectors[first], BatchSize);
+				}
+				return transformedVectors[i].x;
+			}, results);
+		Measure("Matrix TransformPoints4 batch", [&](int i)
+			{
+				const int first = i & ~(BatchSize - 1);
+				if (i == first) {
+					matrices[i & 15].TransformPoints(&vectors[first], &transformedPoints[first], BatchSize);
+				}
+				return transformedPoints[i].w;
+			}, results);
+		Measure("Matrix TransformVectors batch", [&](int i)
+			{
+				const int first = i & ~(BatchSize - 1);
+				if (i == first) {
+					matrices[i & 15].TransformVectors(&vectors[first], &transformedVectors[first], BatchSize);
+				}
+				return transformedVectors[i].x;
+			}, results);
+
+		//Vector
+		Measure("Vector3 Normalized", [&](int i)
+			{
+				return vectors[i].Normalized().x;
+			}, results);
+		Measure("Vector3 Cross", [&](int i)
+			{
+				return Vector3::Cross(vectors[i], otherVectors[i]).x;
+			}, results);
+		Measure("Vector3 Dot", [&](int i)
+			{
+				return Vector3::Dot(vectors[i], otherVectors[i]);
+			}, results);
+		Measure("Vector3 multiply add", [&](int i)
+			{
+				return (vectors[i] * 0.5f + otherVectors[i]).x;
+			}, results);
+		Measure("Vector4 Dot", [&](int i)
+			{
+				return Vector4::Dot(points[i], points[(i + 1) & InputMask]);
+			}, results);
+		Measure("Vector2 Normalized", [&](int i)
+			{
+				return uvs[i].Normalized().x;
+			}, results);
+
+		//ColorRGB
+		Measure("ColorRGB multiply add", [&](int i)
+			{
+				return (colors[i] * otherColors[i] + colors[(i + 1) & InputMask] * 0.5f).r;
+			}, results);
+		Measure("ColorRGB MaxToOne", [&](int i)
+			{
+				ColorRGB color{ colors[i] * 2.f };
+				color.MaxToOne();
+				return color.g;
+			}, results);
+		Measure("ColorRGB Lerp", [&](int i)
+			{
+				return ColorRGB::Lerp(colors[i], otherColors[i], 0.25f).b;
+			}, results);
+
+		//Texture
+		if (std::filesystem::exists(m_Settings.texturePath)) {
+			const std::unique_ptr<Texture> pTexture{ Texture::LoadFromFile(m_Settings.texturePath) };
+			Measure("Texture Sample", [&](int i)
+				{
+					return pTexture->Sample(uvs[i]).r;
+				}, results);
+			Measure("Texture Sample alpha", [&](int i)
+				{
+					float alpha{};
+					const ColorRGB color = pTexture->Sample(uvs[i], alpha);
+					return color.r + alpha;
+				}, results);
+		}
+		else {
+			std::cout << "Skipped the texture benchmarks, couldn't load " << m_Settings.texturePath << std::endl;
+		}
+
+		return results;
+	}
+
+	template<typename Operation>
+	void MathBenchmark::Measure(const std::string& name, const Operation& operation, std::vector<Result>& results)
+	{
+		if (!m_Settings.filter.empty() && name.find(m_Settings.filter) == std::string::npos) {
+			return;
+		}
+
+		const int amountOfOperations = m_Settings.operationsPerRepetition;
+		const auto runRepetition = [&]()
+			{
+				//Several sums, so the additions don't chain the operations after each other
+				float sums[4]{};
+				for (int i{}; i < amountOfOperations; ++i) {
+					sums[i & 3] += operation(i & InputMask);
+				}
+				m_Sink = m_Sink + sums[0] + sums[1] + sums[2] + sums[3];
+			};
+
+		//Warms up the caches and the clock speed
+		runRepetition();
+
+		std::vector<double> timings(m_Settings.amountOfRepetitions);
+		for (double& timing : timings) {
+			const auto start = std::chrono::steady_clock::now();
+			runRepetition();
+			const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+			timing = elapsed.count() / amountOfOperations;
+		}
+		std::sort(timings.begin(), timings.end());
+
+		Result result{};
+		result.name = name;
+		result.minNs = timings.front();
+		result.medianNs = timings[timings.size() / 2];
+		for (double timing : timings) {
+			result.meanNs += timing;
+		}
+		result.meanNs /= static_cast<double>(timings.size());
+		for (double timing : timings) {
+			result.standardDeviationNs += (timing - result.meanNs) * (timing - result.meanNs);
+		}
+		result.standardDeviationNs = std::sqrt(result.standardDeviationNs / static_cast<double>(timings.size()));
+		result.operationsPerSecond = 1e9 / result.medianNs;
+
+		PrintResult(result);
+		results.push_back(result);
+	}
+
+	void MathBenchmark::PrintResult(const Result& result)
+	{
+		std::cout << std::left << std::setw(28) << result.name << std::right << std::fixed << std::setprecision(2)
+			<< std::setw(12) << result.minNs << std::setw(12) << result.medianNs << std::setw(12) << result.meanNs << std::setw(12) << result.standardDeviationNs
+			<< std::setw(14) << result.operationsPerSecond / 1e6 << std::endl;
+	}
+}
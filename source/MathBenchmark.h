@@ -0,0 +1,56 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace dae
+{
+	//Micro benchmarks of the math primitives, to measure changes to them on their own
+	//Every benchmark runs one operation over arrays of prepared inputs, and is repeated to show how much the timing spreads
+	class MathBenchmark final
+	{
+	public:
+		struct Settings
+		{
+			int amountOfRepetitions{ 15 };
+			int operationsPerRepetition{ 1 << 20 };
+			//Only benchmarks whose name contains the filter run, empty runs everything
+			std::string filter{};
+			//Texture for the sample benchmarks
+			std::string texturePath{ "Resources/vehicle_diffuse.png" };
+		};
+
+		//Nanoseconds per operation over the repetitions
+		struct Result
+		{
+			std::string name{};
+			double minNs{};
+			double medianNs{};
+			double meanNs{};
+			double standardDeviationNs{};
+			//From the median
+			double operationsPerSecond{};
+		};
+
+		explicit MathBenchmark(const Settings& settings);
+		~MathBenchmark() = default;
+
+		//Rule of 5
+		MathBenchmark(const MathBenchmark&) = delete;
+		MathBenchmark(MathBenchmark&&) noexcept = delete;
+		MathBenchmark& operator=(const MathBenchmark&) = delete;
+		MathBenchmark& operator=(MathBenchmark&&) noexcept = delete;
+
+		//Runs the benchmarks that pass the filter and prints a table of the results
+		std::vector<Result> Run();
+
+	private:
+		Settings m_Settings{};
+		//Keeps the compiler from removing the benchmarked work
+		volatile float m_Sink{};
+
+		//The operation gets the index of its input and returns a value that depends on the result
+		template<typename Operation>
+		void Measure(const std::string& name, const Operation& operation, std::vector<Result>& results);
+		static void PrintResult(const Result& result);
+	};
+}
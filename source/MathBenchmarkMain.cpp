@@ -0,0 +1,18 @@
+#include "pch.h"
+#include "MathBenchmark.h"
+
+using namespace dae;
+
+//Micro benchmarks of the math library, on top of the software renderer library
+//dae_math_benchmark [name filter]
+//Run from the source folder, the sample benchmarks load a texture relative to it
+int main(int argc, char* args[])
+{
+	MathBenchmark::Settings settings{};
+	if (argc > 1) {
+		settings.filter = args[1];
+	}
+	MathBenchmark benchmark{ settings };
+	benchmark.Run();
+	return 0;
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <cmath>
+#include <cfloat>
 
 namespace dae
 {
@@ -33,7 +34,7 @@ namespace dae
 
 	inline bool AreEqual(float a, float b, float epsilon = FLT_EPSILON)
 	{
-		return abs(a - b) < epsilon;
+		return std::abs(a - b) < epsilon;
 	}
 
 	inline int Clamp(const int v, int min, int max)
@@ -0,0 +1,403 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+//Pick the widest instruction set the compiler targets
+//MSVC only defines __AVX2__ with /arch:AVX2, x64 always has SSE2
+#if defined(__AVX2__)
+#define DAE_SIMD_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DAE_SIMD_SSE
+#include <emmintrin.h>
+#endif
+
+#include "Vector2.h"
+#include "Vector3.h"
+#include "ColorRGB.h"
+
+namespace dae
+{
+	//Exact uses the standard library per lane, Fast uses the approximations below
+	enum class MathPrecision
+	{
+		Exact,
+		Fast
+	};
+
+	/* --- FLOAT AND MASK LANES --- */
+#if defined(DAE_SIMD_AVX2)
+	struct FloatN
+	{
+		static constexpr int Width{ 8 };
+		__m256 value;
+	};
+	struct MaskN
+	{
+		__m256 value;
+	};
+
+	inline FloatN Broadcast(float f) { return { _mm256_set1_ps(f) }; }
+	inline FloatN Load(const float* pData) { return { _mm256_loadu_ps(pData) }; }
+	inline void Store(float* pData, FloatN f) { _mm256_storeu_ps(pData, f.value); }
+
+	inline FloatN operator+(FloatN a, FloatN b) { return { _mm256_add_ps(a.value, b.value) }; }
+	inline FloatN operator-(FloatN a, FloatN b) { return { _mm256_sub_ps(a.value, b.value) }; }
+	inline FloatN operator*(FloatN a, FloatN b) { return { _mm256_mul_ps(a.value, b.value) }; }
+	inline FloatN operator/(FloatN a, FloatN b) { return { _mm256_div_ps(a.value, b.value) }; }
+	inline FloatN Min(FloatN a, FloatN b) { return { _mm256_min_ps(a.value, b.value) }; }
+	inline FloatN Max(FloatN a, FloatN b) { return { _mm256_max_ps(a.value, b.value) }; }
+	inline FloatN Sqrt(FloatN a) { return { _mm256_sqrt_ps(a.value) }; }
+	inline FloatN RsqrtEstimate(FloatN a) { return { _mm256_rsqrt_ps(a.value) }; }
+
+	inline MaskN operator<(FloatN a, FloatN b) { return { _mm256_cmp_ps(a.value, b.value, _CMP_LT_OQ) }; }
+	inline MaskN operator<=(FloatN a, FloatN b) { return { _mm256_cmp_ps(a.value, b.value, _CMP_LE_OQ) }; }
+	inline MaskN operator>(FloatN a, FloatN b) { return { _mm256_cmp_ps(a.value, b.value, _CMP_GT_OQ) }; }
+	inline MaskN operator>=(FloatN a, FloatN b) { return { _mm256_cmp_ps(a.value, b.value, _CMP_GE_OQ) }; }
+	inline MaskN operator==(FloatN a, FloatN b) { return { _mm256_cmp_ps(a.value, b.value, _CMP_EQ_OQ) }; }
+	inline MaskN operator&(MaskN a, MaskN b) { return { _mm256_and_ps(a.value, b.value) }; }
+	inline MaskN operator|(MaskN a, MaskN b) { return { _mm256_or_ps(a.value, b.value) }; }
+	inline bool Any(MaskN m) { return _mm256_movemask_ps(m.value) != 0; }
+	inline int ToBits(MaskN m) { return _mm256_movemask_ps(m.value); }
+	//mask ? a : b
+	inline FloatN Select(MaskN m, FloatN a, FloatN b) { return { _mm256_blendv_ps(b.value, a.value, m.value) }; }
+
+	//2^i for integer valued lanes in [-126, 127]
+	inline FloatN Exp2Int(FloatN i)
+	{
+		const __m256i bits = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(i.value), _mm256_set1_epi32(127)), 23);
+		return { _mm256_castsi256_ps(bits) };
+	}
+	inline FloatN RoundToNearest(FloatN a) { return { _mm256_round_ps(a.value, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC) }; }
+	//Splits a positive float in its exponent and a mantissa in [1, 2)
+	inline FloatN SplitExponent(FloatN a, FloatN& mantissa)
+	{
+		const __m256i bits = _mm256_castps_si256(a.value);
+		const __m256i exponent = _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127));
+		const __m256i mantissaBits = _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3F800000));
+		mantissa = { _mm256_castsi256_ps(mantissaBits) };
+		return { _mm256_cvtepi32_ps(exponent) };
+	}
+#elif defined(DAE_SIMD_SSE)
+	struct FloatN
+	{
+		static constexpr int Width{ 4 };
+		__m128 value;
+	};
+	struct MaskN
+	{
+		__m128 value;
+	};
+
+	inline FloatN Broadcast(float f) { return { _mm_set1_ps(f) }; }
+	inline FloatN Load(const float* pData) { return { _mm_loadu_ps(pData) }; }
+	inline void Store(float* pData, FloatN f) { _mm_storeu_ps(pData, f.value); }
+
+	inline FloatN operator+(FloatN a, FloatN b) { return { _mm_add_ps(a.value, b.value) }; }
+	inline FloatN operator-(FloatN a, FloatN b) { return { _mm_sub_ps(a.value, b.value) }; }
+	inline FloatN operator*(FloatN a, FloatN b) { return { _mm_mul_ps(a.value, b.value) }; }
+	inline FloatN operator/(FloatN a, FloatN b) { return { _mm_div_ps(a.value, b.value) }; }
+	inline FloatN Min(FloatN a, FloatN b) { return { _mm_min_ps(a.value, b.value) }; }
+	inline FloatN Max(FloatN a, FloatN b) { return { _mm_max_ps(a.value, b.value) }; }
+	inline FloatN Sqrt(FloatN a) { return { _mm_sqrt_ps(a.value) }; }
+	inline FloatN RsqrtEstimate(FloatN a) { return { _mm_rsqrt_ps(a.value) }; }
+
+	inline MaskN operator<(FloatN a, FloatN b) { return { _mm_cmplt_ps(a.value, b.value) }; }
+	inline MaskN operator<=(FloatN a, FloatN b) { return { _mm_cmple_ps(a.value, b.value) }; }
+	inline MaskN operator>(FloatN a, FloatN b) { return { _mm_cmpgt_ps(a.value, b.value) }; }
+	inline MaskN operator>=(FloatN a, FloatN b) { return { _mm_cmpge_ps(a.value, b.value) }; }
+	inline MaskN operator==(FloatN a, FloatN b) { return { _mm_cmpeq_ps(a.value, b.value) }; }
+	inline MaskN operator&(MaskN a, MaskN b) { return { _mm_and_ps(a.value, b.value) }; }
+	inline MaskN operator|(MaskN a, MaskN b) { return { _mm_or_ps(a.value, b.value) }; }
+	inline bool Any(MaskN m) { return _mm_movemask_ps(m.value) != 0; }
+	inline int ToBits(MaskN m) { return _mm_movemask_ps(m.value); }
+	//mask ? a : b, SSE2 has no blend instruction
+	inline FloatN Select(MaskN m, FloatN a, FloatN b) { return { _mm_or_ps(_mm_and_ps(m.value, a.value), _mm_andnot_ps(m.value, b.value)) }; }
+
+	//2^i for integer valued lanes in [-126, 127]
+	inline FloatN Exp2Int(FloatN i)
+	{
+		const __m128i bits = _mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(i.value), _mm_set1_epi32(127)), 23);
+		return { _mm_castsi128_ps(bits) };
+	}
+	inline FloatN RoundToNearest(FloatN a) { return { _mm_cvtepi32_ps(_mm_cvtps_epi32(a.value)) }; }
+	//Splits a positive float in its exponent and a mantissa in [1, 2)
+	inline FloatN SplitExponent(FloatN a, FloatN& mantissa)
+	{
+		const __m128i bits = _mm_castps_si128(a.value);
+		const __m128i exponent = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+		const __m128i mantissaBits = _mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000));
+		mantissa = { _mm_castsi128_ps(mantissaBits) };
+		return { _mm_cvtepi32_ps(exponent) };
+	}
+#else
+	//Scalar fallback, plain loops the compiler can still auto vectorize
+	struct FloatN
+	{
+		static constexpr int Width{ 4 };
+		float value[4];
+	};
+	struct MaskN
+	{
+		bool value[4];
+	};
+
+#define DAE_LANES(expression) for (int lane{}; lane < FloatN::Width; ++lane) { expression; }
+	inline FloatN Broadcast(float f) { FloatN r; DAE_LANES(r.value[lane] = f); return r; }
+	inline FloatN Load(const float* pData) { FloatN r; DAE_LANES(r.value[lane] = pData[lane]); return r; }
+	inline void Store(float* pData, FloatN f) { DAE_LANES(pData[lane] = f.value[lane]); }
+
+	inline FloatN operator+(FloatN a, FloatN b) { FloatN r; DAE_LANES(r.value[lane] = a.value[lane] + b.value[lane]); return r; }
+	inline FloatN operator-(FloatN a, FloatN b) { FloatN r; DAE_LANES(r.value[lane] = a.value[lane] - b.value[lane]); return r; }
+	inline FloatN operator*(FloatN a, FloatN b) { FloatN r; DAE_LANES(r.value[lane] = a.value[lane] * b.value[lane]); return r; }
+	inline FloatN operator/(FloatN a, FloatN b) { FloatN r; DAE_LANES(r.value[lane] = a.value[lane] / b.value[lane]); return r; }
+	inline FloatN Min(FloatN a, FloatN b) { FloatN r; DAE_LANES(r.value[lane] = a.value[lane] < b.value[lane] ? a.value[lane] : b.value[lane]); return r; }
+	inline FloatN Max(FloatN a, FloatN b) { FloatN r; DAE_LANES(r.value[lane] = a.value[lane] > b.value[lane] ? a.value[lane] : b.value[lane]); return r; }
+	inline FloatN Sqrt(FloatN a) { FloatN r; DAE_LANES(r.value[lane] = sqrtf(a.value[lane])); return r; }
+	inline FloatN RsqrtEstimate(FloatN a) { FloatN r; DAE_LANES(r.value[lane] = 1.f / sqrtf(a.value[lane])); return r; }
+
+	inline MaskN operator<(FloatN a, FloatN b) { MaskN r; DAE_LANES(r.value[lane] = a.value[lane] < b.value[lane]); return r; }
+	inline MaskN operator<=(FloatN a, FloatN b) { MaskN r; DAE_LANES(r.value[lane] = a.value[lane] <= b.value[lane]); return r; }
+	inline MaskN operator>(FloatN a, FloatN b) { MaskN r; DAE_LANES(r.value[lane] = a.value[lane] > b.value[lane]); return r; }
+	inline MaskN operator>=(FloatN a, FloatN b) { MaskN r; DAE_LANES(r.value[lane] = a.value[lane] >= b.value[lane]); return r; }
+	inline MaskN operator==(FloatN a, FloatN b) { MaskN r; DAE_LANES(r.value[lane] = a.value[lane] == b.value[lane]); return r; }
+	inline MaskN operator&(MaskN a, MaskN b) { MaskN r; DAE_LANES(r.value[lane] = a.value[lane] && b.value[lane]); return r; }
+	inline MaskN operator|(MaskN a, MaskN b) { MaskN r; DAE_LANES(r.value[lane] = a.value[lane] || b.value[lane]); return r; }
+	inline int ToBits(MaskN m) { int bits{}; DAE_LANES(bits |= (m.value[lane] ? 1 : 0) << lane); return bits; }
+	inline bool Any(MaskN m) { return ToBits(m) != 0; }
+	//mask ? a : b
+	inline FloatN Select(MaskN m, FloatN a, FloatN b) { FloatN r; DAE_LANES(r.value[lane] = m.value[lane] ? a.value[lane] : b.value[lane]); return r; }
+
+	//2^i for integer valued lanes in [-126, 127]
+	inline FloatN Exp2Int(FloatN i) { FloatN r; DAE_LANES(r.value[lane] = ldexpf(1.f, static_cast<int>(i.value[lane]))); return r; }
+	inline FloatN RoundToNearest(FloatN a) { FloatN r; DAE_LANES(r.value[lane] = nearbyintf(a.value[lane])); return r; }
+	//Splits a positive float in its exponent and a mantissa in [1, 2)
+	inline FloatN SplitExponent(FloatN a, FloatN& mantissa)
+	{
+		FloatN exponent;
+		DAE_LANES(int e{}; mantissa.value[lane] = frexpf(a.value[lane], &e) * 2.f; exponent.value[lane] = static_cast<float>(e - 1));
+		return exponent;
+	}
+#undef DAE_LANES
+#endif
+
+	/* --- SHARED LANE OPERATIONS --- */
+	inline FloatN operator-(FloatN a) { return Broadcast(0.f) - a; }
+	inline FloatN Clamp(FloatN a, FloatN min, FloatN max) { return Min(Max(a, min), max); }
+	inline FloatN Saturate(FloatN a) { return Clamp(a, Broadcast(0.f), Broadcast(1.f)); }
+
+	//Applies a scalar function lane by lane
+	template<typename Function>
+	inline FloatN ForEachLane(FloatN a, Function function)
+	{
+		float lanes[FloatN::Width];
+		Store(lanes, a);
+		for (int lane{}; lane < FloatN::Width; ++lane) {
+			lanes[lane] = function(lanes[lane]);
+		}
+		return Load(lanes);
+	}
+
+	//1/sqrt(a)
+	//Fast: hardware estimate refined with one Newton-Raphson step, max relative error 3e-7 with SSE/AVX2
+	template<MathPrecision Precision>
+	inline FloatN Rsqrt(FloatN a)
+	{
+		if constexpr (Precision == MathPrecision::Fast) {
+			const FloatN estimate = RsqrtEstimate(a);
+			return estimate * (Broadcast(1.5f) - Broadcast(0.5f) * a * estimate * estimate);
+		}
+		else {
+			return Broadcast(1.f) / Sqrt(a);
+		}
+	}
+
+	//2^f for f in [-0.5, 0.5], degree 6 minimax fit from Cephes exp2f, max relative error 2e-7
+	inline FloatN Exp2Fraction(FloatN f)
+	{
+		FloatN p = Broadcast(1.535336188319500e-4f);
+		p = p * f + Broadcast(1.339887440266574e-3f);
+		p = p * f + Broadcast(9.618437357674640e-3f);
+		p = p * f + Broadcast(5.550332471162809e-2f);
+		p = p * f + Broadcast(2.402264791363012e-1f);
+		p = p * f + Broadcast(6.931472028550421e-1f);
+		return p * f + Broadcast(1.f);
+	}
+
+	//2^x
+	//Fast: polynomial on the fraction around the nearest integer, max relative error 2e-7 for x in [-126, 126]
+	template<MathPrecision Precision>
+	inline FloatN Exp2(FloatN x)
+	{
+		if constexpr (Precision == MathPrecision::Fast) {
+			x = Clamp(x, Broadcast(-126.f), Broadcast(126.f));
+			const FloatN integerPart = RoundToNearest(x);
+			return Exp2Fraction(x - integerPart) * Exp2Int(integerPart);
+		}
+		else {
+			return ForEachLane(x, [](float lane) { return exp2f(lane); });
+		}
+	}
+
+	//log2(x) for x > 0
+	//Fast: odd series of atanh on a mantissa in [sqrt(0.5), sqrt(2)), max absolute error 2e-7 for x in [0.5, 2]
+	//and 4e-6 over all normal floats, where rounding of the exponent sum dominates
+	template<MathPrecision Precision>
+	inline FloatN Log2(FloatN x)
+	{
+		if constexpr (Precision == MathPrecision::Fast) {
+			FloatN mantissa{};
+			FloatN exponent = SplitExponent(x, mantissa);
+
+			//Keep the mantissa around 1 so the series converges fast
+			const MaskN isLarge = mantissa > Broadcast(1.41421356f);
+			mantissa = Select(isLarge, mantissa * Broadcast(0.5f), mantissa);
+			exponent = Select(isLarge, exponent + Broadcast(1.f), exponent);
+
+			//log2(m) = 2/ln2 * atanh(t) with t = (m - 1) / (m + 1), |t| < 0.172
+			const FloatN t = (mantissa - Broadcast(1.f)) / (mantissa + Broadcast(1.f));
+			const FloatN t2 = t * t;
+			FloatN p = Broadcast(1.f / 7.f);
+			p = p * t2 + Broadcast(1.f / 5.f);
+			p = p * t2 + Broadcast(1.f / 3.f);
+			p = p * t2 + Broadcast(1.f);
+			return exponent + Broadcast(2.88539008f) * t * p;
+		}
+		else {
+			return ForEachLane(x, [](float lane) { return log2f(lane); });
+		}
+	}
+
+	//e^x
+	//Fast: 2^k * 2^f with k the nearest integer to x*log2(e), max relative error 3e-7 for x in [-87, 87]
+	//The remainder is taken from x with ln2 split in two parts, rounding x*log2(e) itself would cost up to 4e-6
+	template<MathPrecision Precision>
+	inline FloatN Exp(FloatN x)
+	{
+		if constexpr (Precision == MathPrecision::Fast) {
+			x = Clamp(x, Broadcast(-87.3f), Broadcast(87.3f));
+			const FloatN integerPart = RoundToNearest(x * Broadcast(1.44269504f));
+			//k * 0.693359375 is exact, the second part is the rest of ln2
+			const FloatN remainder = x - integerPart * Broadcast(0.693359375f) - integerPart * Broadcast(-2.12194440e-4f);
+			return Exp2Fraction(remainder * Broadcast(1.44269504f)) * Exp2Int(integerPart);
+		}
+		else {
+			return ForEachLane(x, [](float lane) { return expf(lane); });
+		}
+	}
+
+	//base^exponent for base >= 0, follows powf for a zero base (0^0 = 1)
+	//Fast: exp2(exponent * log2(base)), relative error grows with the result exponent
+	//max relative error 1e-5 (8e-6 measured) for base in [1e-4, 1] and exponent in [0, 25], the range Phong uses,
+	//wherever the result is a normal float (at least 2^-126), smaller results have no relative error bound
+	//Most of it is the rounding of exponent * log2(base) near -126, MathSIMDTest checks the bound
+	template<MathPrecision Precision>
+	inline FloatN Pow(FloatN base, FloatN exponent)
+	{
+		if constexpr (Precision == MathPrecision::Fast) {
+			const MaskN isPositive = base > Broadcast(0.f);
+			const FloatN safeBase = Select(isPositive, base, Broadcast(1.f));
+			const FloatN result = Exp2<Precision>(exponent * Log2<Precision>(safeBase));
+			const FloatN zeroBaseResult = Select(exponent == Broadcast(0.f), Broadcast(1.f), Broadcast(0.f));
+			return Select(isPositive, result, zeroBaseResult);
+		}
+		else {
+			float bases[FloatN::Width];
+			float exponents[FloatN::Width];
+			Store(bases, base);
+			Store(exponents, exponent);
+			for (int lane{}; lane < FloatN::Width; ++lane) {
+				bases[lane] = powf(bases[lane], exponents[lane]);
+			}
+			return Load(bases);
+		}
+	}
+
+	/* --- VECTOR AND COLOR LANES --- */
+	//Structure of arrays, one Vector3 per lane
+	struct Vector3N
+	{
+		FloatN x;
+		FloatN y;
+		FloatN z;
+
+		static Vector3N Broadcast(const Vector3& v)
+		{
+			return { dae::Broadcast(v.x), dae::Broadcast(v.y), dae::Broadcast(v.z) };
+		}
+
+		static FloatN Dot(const Vector3N& v1, const Vector3N& v2)
+		{
+			return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
+		}
+
+		static Vector3N Cross(const Vector3N& v1, const Vector3N& v2)
+		{
+			return {
+				v1.y * v2.z - v1.z * v2.y,
+				v1.z * v2.x - v1.x * v2.z,
+				v1.x * v2.y - v1.y * v2.x
+			};
+		}
+
+		FloatN SqrMagnitude() const
+		{
+			return Dot(*this, *this);
+		}
+
+		template<MathPrecision Precision>
+		Vector3N Normalized() const
+		{
+			const FloatN invMagnitude = Rsqrt<Precision>(SqrMagnitude());
+			return { x * invMagnitude, y * invMagnitude, z * invMagnitude };
+		}
+
+		Vector3N operator+(const Vector3N& v) const { return { x + v.x, y + v.y, z + v.z }; }
+		Vector3N operator-(const Vector3N& v) const { return { x - v.x, y - v.y, z - v.z }; }
+		Vector3N operator-() const { return { -x, -y, -z }; }
+		Vector3N operator*(FloatN scale) const { return { x * scale, y * scale, z * scale }; }
+	};
+
+	inline Vector3N Select(MaskN m, const Vector3N& a, const Vector3N& b)
+	{
+		return { Select(m, a.x, b.x), Select(m, a.y, b.y), Select(m, a.z, b.z) };
+	}
+
+	struct Vector2N
+	{
+		FloatN x;
+		FloatN y;
+	};
+
+	struct ColorRGBN
+	{
+		FloatN r;
+		FloatN g;
+		FloatN b;
+
+		static ColorRGBN Broadcast(const ColorRGB& c)
+		{
+			return { dae::Broadcast(c.r), dae::Broadcast(c.g), dae::Broadcast(c.b) };
+		}
+
+		//Same as ColorRGB::MaxToOne, for every lane
+		void MaxToOne()
+		{
+			const FloatN maxValue = Max(r, Max(g, b));
+			const FloatN scale = Select(maxValue > dae::Broadcast(1.f), dae::Broadcast(1.f) / maxValue, dae::Broadcast(1.f));
+			r = r * scale;
+			g = g * scale;
+			b = b * scale;
+		}
+
+		ColorRGBN operator+(const ColorRGBN& c) const { return { r + c.r, g + c.g, b + c.b }; }
+		ColorRGBN operator*(const ColorRGBN& c) const { return { r * c.r, g * c.g, b * c.b }; }
+		ColorRGBN operator*(FloatN s) const { return { r * s, g * s, b * s }; }
+	};
+
+	inline ColorRGBN Select(MaskN m, const ColorRGBN& a, const ColorRGBN& b)
+	{
+		return { Select(m, a.r, b.r), Select(m, a.g, b.g), Select(m, a.b, b.b) };
+	}
+}
@@ -0,0 +1,128 @@
+#include "pch.h"
+#include "MathSIMD.h"
+#include <cfloat>
+#include <functional>
+#include <string>
+
+//Error bounds of the fast approximations in MathSIMD.h over the ranges their comments promise, run by ctest
+namespace
+{
+	using namespace dae;
+
+	int g_AmountOfFailures{};
+
+	void Expect(bool condition, const std::string& description)
+	{
+		if (!condition) {
+			std::cout << "[FAIL] " << description << std::endl;
+			++g_AmountOfFailures;
+		}
+	}
+
+	//Largest relative error of the approximation against the double reference, on amountOfSteps + 1 evenly spaced inputs
+	double MeasureRelativeError(float min, float max, int amountOfSteps, const std::function<FloatN(FloatN)>& approximation, double (*reference)(double))
+	{
+		double largestError{};
+		float inputs[FloatN::Width]{};
+		float outputs[FloatN::Width]{};
+		for (int firstStep{}; firstStep <= amountOfSteps; firstStep += FloatN::Width) {
+			for (int lane{}; lane < FloatN::Width; ++lane) {
+				const int step = std::min(firstStep + lane, amountOfSteps);
+				inputs[lane] = min + (max - min) * static_cast<float>(step) / static_cast<float>(amountOfSteps);
+			}
+			Store(outputs, approximation(Load(inputs)));
+			for (int lane{}; lane < FloatN::Width; ++lane) {
+				const double expected = reference(static_cast<double>(inputs[lane]));
+				largestError = std::max(largestError, std::abs(static_cast<double>(outputs[lane]) - expected) / std::abs(expected));
+			}
+		}
+		return largestError;
+	}
+
+	void TestExp()
+	{
+		const double exp2Error = MeasureRelativeError(-126.f, 126.f, 1000000, [](FloatN x) { return Exp2<MathPrecision::Fast>(x); }, [](double x) { return std::exp2(x); });
+		Expect(exp2Error <= 2e-7, "Exp2: relative error " + std::to_string(exp2Error));
+		const double expError = MeasureRelativeError(-87.f, 87.f, 1000000, [](FloatN x) { return Exp<MathPrecision::Fast>(x); }, [](double x) { return std::exp(x); });
+		Expect(expError <= 3e-7, "Exp: relative error " + std::to_string(expError));
+	}
+
+	void TestLog2()
+	{
+		//Absolute error, the result goes through zero at 1
+		double nearOneError{};
+		double largestError{};
+		float inputs[FloatN::Width]{};
+		float outputs[FloatN::Width]{};
+		for (int firstStep{}; firstStep <= 1000000; firstStep += FloatN::Width) {
+			for (int lane{}; lane < FloatN::Width; ++lane) {
+				inputs[lane] = 0.5f + 1.5f * static_cast<float>(firstStep + lane) / 1000000.f;
+			}
+			Store(outputs, Log2<MathPrecision::Fast>(Load(inputs)));
+			for (int lane{}; lane < FloatN::Width; ++lane) {
+				nearOneError = std::max(nearOneError, std::abs(outputs[lane] - std::log2(static_cast<double>(inputs[lane]))));
+			}
+		}
+		//Every normal float exponent, with a spread of mantissas
+		for (int exponent{ -126 }; exponent <= 127; ++exponent) {
+			for (int firstStep{}; firstStep < 1024; firstStep += FloatN::Width) {
+				for (int lane{}; lane < FloatN::Width; ++lane) {
+					inputs[lane] = std::ldexp(1.f + static_cast<float>(firstStep + lane) / 1024.f, exponent);
+				}
+				Store(outputs, Log2<MathPrecision::Fast>(Load(inputs)));
+				for (int lane{}; lane < FloatN::Width; ++lane) {
+					largestError = std::max(largestError, std::abs(outputs[lane] - std::log2(static_cast<double>(inputs[lane]))));
+				}
+			}
+		}
+		Expect(nearOneError <= 2e-7, "Log2: absolute error in [0.5, 2] " + std::to_string(nearOneError));
+		Expect(largestError <= 4e-6, "Log2: absolute error over the normal floats " + std::to_string(largestError));
+	}
+
+	void TestPow()
+	{
+		//The range of Phong, cosines down to 1e-4 and glossiness times the shininess up to 25
+		double largestError{};
+		float bases[FloatN::Width]{};
+		float outputs[FloatN::Width]{};
+		constexpr int AmountOfBases{ 2000 };
+		constexpr int AmountOfExponents{ 2500 };
+		for (int baseStep{}; baseStep <= AmountOfBases; baseStep += FloatN::Width) {
+			for (int lane{}; lane < FloatN::Width; ++lane) {
+				const float fraction = static_cast<float>(std::min(baseStep + lane, AmountOfBases)) / static_cast<float>(AmountOfBases);
+				bases[lane] = std::min(1e-4f * std::pow(1e4f, fraction), 1.f);
+			}
+			for (int exponentStep{}; exponentStep <= AmountOfExponents; ++exponentStep) {
+				const float exponent = 25.f * static_cast<float>(exponentStep) / static_cast<float>(AmountOfExponents);
+				Store(outputs, Pow<MathPrecision::Fast>(Load(bases), Broadcast(exponent)));
+				for (int lane{}; lane < FloatN::Width; ++lane) {
+					const double expected = std::pow(static_cast<double>(bases[lane]), static_cast<double>(exponent));
+					//Results below the normal floats have no relative bound
+					if (expected >= FLT_MIN) {
+						largestError = std::max(largestError, std::abs(outputs[lane] - expected) / expected);
+					}
+				}
+			}
+		}
+		Expect(largestError <= 1e-5, "Pow: relative error " + std::to_string(largestError));
+
+		//A zero base follows powf
+		float zeroResults[FloatN::Width]{};
+		Store(zeroResults, Pow<MathPrecision::Fast>(Broadcast(0.f), Broadcast(0.f)));
+		Expect(zeroResults[0] == 1.f, "Pow: 0^0");
+		Store(zeroResults, Pow<MathPrecision::Fast>(Broadcast(0.f), Broadcast(2.f)));
+		Expect(zeroResults[0] == 0.f, "Pow: 0^2");
+	}
+}
+
+int main()
+{
+	TestExp();
+	TestLog2();
+	TestPow();
+
+	if (g_AmountOfFailures == 0) {
+		std::cout << "All math tests passed" << std::endl;
+	}
+	return g_AmountOfFailures == 0 ? 0 : 1;
+}
@@ -5,9 +5,82 @@
 #include <cassert>
 
 #include "MathHelpers.h"
+#include "MathSIMD.h"
 #include <cmath>
 
+//x64 always has SSE2, the matrix code works on rows of 4 floats so it uses 128 bit registers with AVX2 too
+#if defined(DAE_SIMD_AVX2) || defined(DAE_SIMD_SSE)
+#define DAE_MATRIX_SIMD
+#endif
+
 namespace dae {
+#if defined(DAE_MATRIX_SIMD)
+	namespace
+	{
+		inline __m128 LoadRow(const Vector4& row) { return _mm_loadu_ps(&row.x); }
+		inline void StoreRow(Vector4& row, __m128 value) { _mm_storeu_ps(&row.x, value); }
+		inline void StoreVector3(Vector3& v, __m128 value)
+		{
+			_mm_storel_pi(reinterpret_cast<__m64*>(&v.x), value);
+			_mm_store_ss(&v.z, _mm_movehl_ps(value, value));
+		}
+
+		//x * row0 + y * row1 + z * row2, added in the same order as the scalar code so both give the same result
+		inline __m128 CombineRows(float x, float y, float z, __m128 row0, __m128 row1, __m128 row2)
+		{
+			return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(x), row0), _mm_mul_ps(_mm_set1_ps(y), row1)), _mm_mul_ps(_mm_set1_ps(z), row2));
+		}
+
+		//Lanes of v in the order X, Y, Z, W
+		template<int X, int Y, int Z, int W>
+		inline __m128 Swizzle(__m128 v) { return _mm_castsi128_ps(_mm_shuffle_epi32(_mm_castps_si128(v), _MM_SHUFFLE(W, Z, Y, X))); }
+		//Lanes X and Y of a, followed by lanes Z and W of b
+		template<int X, int Y, int Z, int W>
+		inline __m128 Shuffle(__m128 a, __m128 b) { return _mm_shuffle_ps(a, b, _MM_SHUFFLE(W, Z, Y, X)); }
+
+		//w is 0 when the w of both vectors is
+		inline __m128 Cross(__m128 a, __m128 b)
+		{
+			return _mm_sub_ps(_mm_mul_ps(Swizzle<1, 2, 0, 3>(a), Swizzle<2, 0, 1, 3>(b)), _mm_mul_ps(Swizzle<2, 0, 1, 3>(a), Swizzle<1, 2, 0, 3>(b)));
+		}
+		//Dot product of x, y and z in every lane
+		inline __m128 Dot3(__m128 a, __m128 b)
+		{
+			const __m128 product = _mm_mul_ps(a, b);
+			return _mm_add_ps(_mm_add_ps(Swizzle<0, 0, 0, 0>(product), Swizzle<1, 1, 1, 1>(product)), Swizzle<2, 2, 2, 2>(product));
+		}
+		//Inverse of an affine matrix from the inverse of its 3x3 part, the rows are transposed in place
+		inline void StoreAffineInverse(Vector4* pRows, __m128 row0, __m128 row1, __m128 row2, __m128 translation)
+		{
+			__m128 row3 = _mm_setzero_ps();
+			_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+			const __m128 inverseTranslation = _mm_sub_ps(_mm_setr_ps(0.f, 0.f, 0.f, 1.f),
+				CombineRows(_mm_cvtss_f32(translation), _mm_cvtss_f32(Swizzle<1, 1, 1, 1>(translation)), _mm_cvtss_f32(Swizzle<2, 2, 2, 2>(translation)), row0, row1, row2));
+			StoreRow(pRows[0], row0);
+			StoreRow(pRows[1], row1);
+			StoreRow(pRows[2], row2);
+			StoreRow(pRows[3], inverseTranslation);
+		}
+
+		//2x2 matrices, row major in the 4 lanes
+		//a * b
+		inline __m128 Matrix2Multiply(__m128 a, __m128 b)
+		{
+			return _mm_add_ps(_mm_mul_ps(a, Swizzle<0, 3, 0, 3>(b)), _mm_mul_ps(Swizzle<1, 0, 3, 2>(a), Swizzle<2, 1, 2, 1>(b)));
+		}
+		//Adjugate(a) * b
+		inline __m128 Matrix2AdjugateMultiply(__m128 a, __m128 b)
+		{
+			return _mm_sub_ps(_mm_mul_ps(Swizzle<3, 3, 0, 0>(a), b), _mm_mul_ps(Swizzle<1, 1, 2, 2>(a), Swizzle<2, 3, 0, 1>(b)));
+		}
+		//a * Adjugate(b)
+		inline __m128 Matrix2MultiplyAdjugate(__m128 a, __m128 b)
+		{
+			return _mm_sub_ps(_mm_mul_ps(a, Swizzle<3, 0, 3, 0>(b)), _mm_mul_ps(Swizzle<1, 0, 3, 2>(a), Swizzle<2, 1, 2, 1>(b)));
+		}
+	}
+#endif
+
 	Matrix::Matrix(const Vector3& xAxis, const Vector3& yAxis, const Vector3& zAxis, const Vector3& t) :
 		Matrix({ xAxis, 0 }, { yAxis, 0 }, { zAxis, 0 }, { t, 1 })
 	{
@@ -72,8 +145,78 @@ namespace dae {
 		};
 	}
 
+	void Matrix::TransformPoints(const Vector3* pPoints, Vector3* pPointsOut, size_t amountOfPoints, size_t stride, size_t strideOut) const
+	{
+		const char* pIn = reinterpret_cast<const char*>(pPoints);
+		char* pOut = reinterpret_cast<char*>(pPointsOut);
+#if defined(DAE_MATRIX_SIMD)
+		const __m128 row0 = LoadRow(data[0]);
+		const __m128 row1 = LoadRow(data[1]);
+		const __m128 row2 = LoadRow(data[2]);
+		const __m128 row3 = LoadRow(data[3]);
+		for (size_t i{}; i < amountOfPoints; ++i) {
+			const Vector3& p = *reinterpret_cast<const Vector3*>(pIn + i * stride);
+			StoreVector3(*reinterpret_cast<Vector3*>(pOut + i * strideOut), _mm_add_ps(CombineRows(p.x, p.y, p.z, row0, row1, row2), row3));
+		}
+#else
+		for (size_t i{}; i < amountOfPoints; ++i) {
+			*reinterpret_cast<Vector3*>(pOut + i * strideOut) = TransformPoint(*reinterpret_cast<const Vector3*>(pIn + i * stride));
+		}
+#endif
+	}
+
+	void Matrix::TransformPoints(const Vector3* pPoints, Vector4* pPointsOut, size_t amountOfPoints, size_t stride, size_t strideOut) const
+	{
+		const char* pIn = reinterpret_cast<const char*>(pPoints);
+		char* pOut = reinterpret_cast<char*>(pPointsOut);
+#if defined(DAE_MATRIX_SIMD)
+		const __m128 row0 = LoadRow(data[0]);
+		const __m128 row1 = LoadRow(data[1]);
+		const __m128 row2 = LoadRow(data[2]);
+		const __m128 row3 = LoadRow(data[3]);
+		for (size_t i{}; i < amountOfPoints; ++i) {
+			const Vector3& p = *reinterpret_cast<const Vector3*>(pIn + i * stride);
+			StoreRow(*reinterpret_cast<Vector4*>(pOut + i * strideOut), _mm_add_ps(CombineRows(p.x, p.y, p.z, row0, row1, row2), row3));
+		}
+#else
+		for (size_t i{}; i < amountOfPoints; ++i) {
+			*reinterpret_cast<Vector4*>(pOut + i * strideOut) = TransformPoint(Vector4{ *reinterpret_cast<const Vector3*>(pIn + i * stride), 1.f });
+		}
+#endif
+	}
+
+	void Matrix::TransformVectors(const Vector3* pVectors, Vector3* pVectorsOut, size_t amountOfVectors, size_t stride, size_t strideOut) const
+	{
+		const char* pIn = reinterpret_cast<const char*>(pVectors);
+		char* pOut = reinterpret_cast<char*>(pVectorsOut);
+#if defined(DAE_MATRIX_SIMD)
+		const __m128 row0 = LoadRow(data[0]);
+		const __m128 row1 = LoadRow(data[1]);
+		const __m128 row2 = LoadRow(data[2]);
+		for (size_t i{}; i < amountOfVectors; ++i) {
+			const Vector3& v = *reinterpret_cast<const Vector3*>(pIn + i * stride);
+			StoreVector3(*reinterpret_cast<Vector3*>(pOut + i * strideOut), CombineRows(v.x, v.y, v.z, row0, row1, row2));
+		}
+#else
+		for (size_t i{}; i < amountOfVectors; ++i) {
+			*reinterpret_cast<Vector3*>(pOut + i * strideOut) = TransformVector(*reinterpret_cast<const Vector3*>(pIn + i * stride));
+		}
+#endif
+	}
+
 	const Matrix& Matrix::Transpose()
 	{
+#if defined(DAE_MATRIX_SIMD)
+		__m128 row0 = LoadRow(data[0]);
+		__m128 row1 = LoadRow(data[1]);
+		__m128 row2 = LoadRow(data[2]);
+		__m128 row3 = LoadRow(data[3]);
+		_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+		StoreRow(data[0], row0);
+		StoreRow(data[1], row1);
+		StoreRow(data[2], row2);
+		StoreRow(data[3], row3);
+#else
 		Matrix result{};
 		for (int r{ 0 }; r < 4; ++r)
 		{
@@ -87,12 +230,65 @@ namespace dae {
 		data[1] = result[1];
 		data[2] = result[2];
 		data[3] = result[3];
+#endif
 
 		return *this;
 	}
 
 	const Matrix& Matrix::Inverse()
 	{
+#if defined(DAE_MATRIX_SIMD)
+		//Inverse of the matrix split in 2x2 blocks | A B |
+		//                                          | C D |
+		const __m128 row0 = LoadRow(data[0]);
+		const __m128 row1 = LoadRow(data[1]);
+		const __m128 row2 = LoadRow(data[2]);
+		const __m128 row3 = LoadRow(data[3]);
+		const __m128 a = _mm_movelh_ps(row0, row1);
+		const __m128 b = _mm_movehl_ps(row1, row0);
+		const __m128 c = _mm_movelh_ps(row2, row3);
+		const __m128 d = _mm_movehl_ps(row3, row2);
+
+		//Determinants of A, B, C and D
+		const __m128 determinants = _mm_sub_ps(
+			_mm_mul_ps(Shuffle<0, 2, 0, 2>(row0, row2), Shuffle<1, 3, 1, 3>(row1, row3)),
+			_mm_mul_ps(Shuffle<1, 3, 1, 3>(row0, row2), Shuffle<0, 2, 0, 2>(row1, row3)));
+		const __m128 determinantA = Swizzle<0, 0, 0, 0>(determinants);
+		const __m128 determinantB = Swizzle<1, 1, 1, 1>(determinants);
+		const __m128 determinantC = Swizzle<2, 2, 2, 2>(determinants);
+		const __m128 determinantD = Swizzle<3, 3, 3, 3>(determinants);
+
+		const __m128 adjugateDC = Matrix2AdjugateMultiply(d, c);
+		const __m128 adjugateAB = Matrix2AdjugateMultiply(a, b);
+		//The blocks of the inverse, times the determinant and before taking their adjugate
+		__m128 x = _mm_sub_ps(_mm_mul_ps(determinantD, a), Matrix2Multiply(b, adjugateDC));
+		__m128 w = _mm_sub_ps(_mm_mul_ps(determinantA, d), Matrix2Multiply(c, adjugateAB));
+		__m128 y = _mm_sub_ps(_mm_mul_ps(determinantB, c), Matrix2MultiplyAdjugate(d, adjugateAB));
+		__m128 z = _mm_sub_ps(_mm_mul_ps(determinantC, b), Matrix2MultiplyAdjugate(a, adjugateDC));
+
+		//det = det(A) * det(D) + det(B) * det(C) - trace(adjugate(A) * B * adjugate(D) * C)
+		__m128 trace = _mm_mul_ps(adjugateAB, Swizzle<0, 2, 1, 3>(adjugateDC));
+		trace = _mm_add_ps(trace, _mm_movehl_ps(trace, trace));
+		trace = _mm_add_ss(trace, Swizzle<1, 1, 1, 1>(trace));
+		trace = Swizzle<0, 0, 0, 0>(trace);
+		const __m128 determinant = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(determinantA, determinantD), _mm_mul_ps(determinantB, determinantC)), trace);
+		assert((!AreEqual(_mm_cvtss_f32(determinant), 0.f)) && "ERROR: determinant is 0, there is no INVERSE!");
+
+		//The adjugate of a 2x2 block flips the sign of the two off diagonal elements
+		const __m128 inverseDeterminant = _mm_div_ps(_mm_setr_ps(1.f, -1.f, -1.f, 1.f), determinant);
+		x = _mm_mul_ps(x, inverseDeterminant);
+		y = _mm_mul_ps(y, inverseDeterminant);
+		z = _mm_mul_ps(z, inverseDeterminant);
+		w = _mm_mul_ps(w, inverseDeterminant);
+
+		//Takes the adjugates and puts the blocks back in rows at once
+		StoreRow(data[0], Shuffle<3, 1, 3, 1>(x, y));
+		StoreRow(data[1], Shuffle<2, 0, 2, 0>(x, y));
+		StoreRow(data[2], Shuffle<3, 1, 3, 1>(z, w));
+		StoreRow(data[3], Shuffle<2, 0, 2, 0>(z, w));
+
+		return *this;
+#else
 		//Optimized Inverse as explained in FGED1 - used widely in other libraries too.
 		const Vector3& a = data[0];
 		const Vector3& b = data[1];
@@ -126,6 +322,7 @@ namespace dae {
 		data[3] = {-Vector3::Dot(b, t),Vector3::Dot(a, t),-Vector3::Dot(d, s),Vector3::Dot(c, s) };
 
 		return *this;
+#endif
 	}
 
 	Matrix Matrix::Transpose(const Matrix& m)
@@ -144,6 +341,68 @@ namespace dae {
 		return out;
 	}
 
+	Matrix Matrix::InverseAffine(const Matrix& m)
+	{
+#if defined(DAE_MATRIX_SIMD)
+		const __m128 a = LoadRow(m.data[0]);
+		const __m128 b = LoadRow(m.data[1]);
+		const __m128 c = LoadRow(m.data[2]);
+
+		const __m128 bc = Cross(b, c);
+		const __m128 ca = Cross(c, a);
+		const __m128 ab = Cross(a, b);
+		const __m128 det = Dot3(a, bc);
+		assert((!AreEqual(_mm_cvtss_f32(det), 0.f)) && "ERROR: determinant is 0, there is no INVERSE!");
+		const __m128 invDet = _mm_div_ps(_mm_set1_ps(1.f), det);
+
+		//The cross products are the columns of the inverse of the 3x3 part
+		Matrix result{};
+		StoreAffineInverse(result.data, _mm_mul_ps(bc, invDet), _mm_mul_ps(ca, invDet), _mm_mul_ps(ab, invDet), LoadRow(m.data[3]));
+		return result;
+#else
+		const Vector3 a = m.data[0];
+		const Vector3 b = m.data[1];
+		const Vector3 c = m.data[2];
+		const Vector3 t = m.data[3];
+
+		const Vector3 bc = Vector3::Cross(b, c);
+		const Vector3 ca = Vector3::Cross(c, a);
+		const Vector3 ab = Vector3::Cross(a, b);
+		const float det = Vector3::Dot(a, bc);
+		assert((!AreEqual(det, 0.f)) && "ERROR: determinant is 0, there is no INVERSE!");
+		const float invDet = 1.f / det;
+
+		//The cross products are the columns of the inverse of the 3x3 part
+		const Vector3 r0 = Vector3{ bc.x, ca.x, ab.x } * invDet;
+		const Vector3 r1 = Vector3{ bc.y, ca.y, ab.y } * invDet;
+		const Vector3 r2 = Vector3{ bc.z, ca.z, ab.z } * invDet;
+
+		return { r0, r1, r2, -(r0 * t.x + r1 * t.y + r2 * t.z) };
+#endif
+	}
+
+	Matrix Matrix::InverseRigid(const Matrix& m)
+	{
+		//The inverse of a rotation is its transpose
+#if defined(DAE_MATRIX_SIMD)
+		Matrix result{};
+		StoreAffineInverse(result.data, LoadRow(m.data[0]), LoadRow(m.data[1]), LoadRow(m.data[2]), LoadRow(m.data[3]));
+		return result;
+#else
+		const Vector3 a = m.data[0];
+		const Vector3 b = m.data[1];
+		const Vector3 c = m.data[2];
+		const Vector3 t = m.data[3];
+
+		return {
+			Vector3{ a.x, b.x, c.x },
+			Vector3{ a.y, b.y, c.y },
+			Vector3{ a.z, b.z, c.z },
+			Vector3{ -Vector3::Dot(t, a), -Vector3::Dot(t, b), -Vector3::Dot(t, c) }
+		};
+#endif
+	}
+
 	Matrix Matrix::CreateLookAtLH(const Vector3& origin, const Vector3& forward, const Vector3& up)
 	{
 		return {};
@@ -250,6 +509,18 @@ namespace dae {
 	Matrix Matrix::operator*(const Matrix& m) const
 	{
 		Matrix result{};
+#if defined(DAE_MATRIX_SIMD)
+		//Every row of the result is a combination of the rows of m, no transposed copy needed
+		const __m128 row0 = LoadRow(m.data[0]);
+		const __m128 row1 = LoadRow(m.data[1]);
+		const __m128 row2 = LoadRow(m.data[2]);
+		const __m128 row3 = LoadRow(m.data[3]);
+		for (int r{ 0 }; r < 4; ++r)
+		{
+			const Vector4& row = data[r];
+			StoreRow(result.data[r], _mm_add_ps(CombineRows(row.x, row.y, row.z, row0, row1, row2), _mm_mul_ps(_mm_set1_ps(row.w), row3)));
+		}
+#else
 		Matrix m_transposed = Transpose(m);
 
 		for (int r{ 0 }; r < 4; ++r)
@@ -259,12 +530,20 @@ namespace dae {
 				result[r][c] = Vector4::Dot(data[r], m_transposed[c]);
 			}
 		}
+#endif
 
 		return result;
 	}
 
 	const Matrix& Matrix::operator*=(const Matrix& m)
 	{
+#if defined(DAE_MATRIX_SIMD)
+		const Matrix result{ *this * m };
+		data[0] = result.data[0];
+		data[1] = result.data[1];
+		data[2] = result.data[2];
+		data[3] = result.data[3];
+#else
 		Matrix copy{ *this };
 		Matrix m_transposed = Transpose(m);
 
@@ -275,6 +554,7 @@ namespace dae {
 				data[r][c] = Vector4::Dot(copy[r], m_transposed[c]);
 			}
 		}
+#endif
 
 		return *this;
 	}
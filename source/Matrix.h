@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 #include "Vector3.h"
 #include "Vector4.h"
 
@@ -28,6 +29,13 @@ namespace dae {
 		Vector4 TransformPoint(const Vector4& p) const;
 		Vector4 TransformPoint(float x, float y, float z, float w) const;
 
+		//Transforms whole arrays at once, the strides are the distances in bytes between two elements
+		//so the positions, normals or tangents can be read from and written to bigger vertex structs in place
+		void TransformPoints(const Vector3* pPoints, Vector3* pPointsOut, size_t amountOfPoints, size_t stride = sizeof(Vector3), size_t strideOut = sizeof(Vector3)) const;
+		//The points get a w of 1, the results are homogeneous
+		void TransformPoints(const Vector3* pPoints, Vector4* pPointsOut, size_t amountOfPoints, size_t stride = sizeof(Vector3), size_t strideOut = sizeof(Vector4)) const;
+		void TransformVectors(const Vector3* pVectors, Vector3* pVectorsOut, size_t amountOfVectors, size_t stride = sizeof(Vector3), size_t strideOut = sizeof(Vector3)) const;
+
 		const Matrix& Transpose();
 		const Matrix& Inverse();
 
@@ -47,6 +55,10 @@ namespace dae {
 		static Matrix CreateScale(const Vector3& s);
 		static Matrix Transpose(const Matrix& m);
 		static Matrix Inverse(const Matrix& m);
+		//Cheaper inverses for matrices with a last column of 0, 0, 0, 1, like world and view matrices
+		static Matrix InverseAffine(const Matrix& m);
+		//Only for a rotation and a translation, without scale, like the camera ONB
+		static Matrix InverseRigid(const Matrix& m);
 
 		static Matrix CreateLookAtLH(const Vector3& origin, const Vector3& forward, const Vector3& up);
 		static Matrix CreatePerspectiveFovLH(float fovy, float aspect, float zn, float zf);
@@ -0,0 +1,497 @@
+#include "pch.h"
+#include "MeshSimplifier.h"
+#include <cstring> //memcpy, memcmp
+#include <queue>
+#include <unordered_map>
+#include "Parallel.h"
+
+using namespace dae;
+
+namespace
+{
+	//Collapses that turn a triangle more than this are rejected
+	constexpr float MinNormalDot{ 0.2f };
+	//Weight of the planes that keep borders and seams in place
+	constexpr double EdgeWeight{ 10.0 };
+
+	enum class VertexKind
+	{
+		Interior,
+		Border,
+		Seam,
+		Locked
+	};
+
+	//Symmetric 4x4 matrix, the sum of the squared distances to a set of planes
+	struct Quadric
+	{
+		double a2{}, ab{}, ac{}, ad{};
+		double b2{}, bc{}, bd{};
+		double c2{}, cd{};
+		double d2{};
+		//Sum of the plane weights, the error divided by it is a squared distance
+		double weight{};
+
+		void AddPlane(const Vector3& normal, float distance, double weight)
+		{
+			this->weight += weight;
+			const double a{ normal.x }, b{ normal.y }, c{ normal.z }, d{ distance };
+			a2 += weight * a * a; ab += weight * a * b; ac += weight * a * c; ad += weight * a * d;
+			b2 += weight * b * b; bc += weight * b * c; bd += weight * b * d;
+			c2 += weight * c * c; cd += weight * c * d;
+			d2 += weight * d * d;
+		}
+
+		void operator+=(const Quadric& q)
+		{
+			a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+			b2 += q.b2; bc += q.bc; bd += q.bd;
+			c2 += q.c2; cd += q.cd;
+			d2 += q.d2;
+			weight += q.weight;
+		}
+
+		double Evaluate(const Vector3& p) const
+		{
+			const double x{ p.x }, y{ p.y }, z{ p.z };
+			const double error = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+				+ b2 * y * y + 2 * bc * y * z + 2 * bd * y
+				+ c2 * z * z + 2 * cd * z
+				+ d2;
+			return std::max(error, 0.0);
+		}
+	};
+
+	struct Collapse
+	{
+		double cost{};
+		uint32_t from{};
+		uint32_t to{};
+		uint32_t fromVersion{};
+		uint32_t toVersion{};
+
+		bool operator>(const Collapse& other) const
+		{
+			return cost > other.cost;
+		}
+	};
+
+	struct VertexKey
+	{
+		Vector3 position{};
+		Vector2 uv{};
+		Vector3 normal{};
+	};
+
+	struct VertexKeyHash
+	{
+		size_t operator()(const VertexKey& key) const
+		{
+			uint32_t bits[8]{};
+			memcpy(bits, &key, sizeof(bits));
+			size_t hash{};
+			for (const uint32_t value : bits) {
+				hash = hash * 31 + value;
+			}
+			return hash;
+		}
+	};
+
+	struct VertexKeyEqual
+	{
+		bool operator()(const VertexKey& a, const VertexKey& b) const
+		{
+			return memcmp(&a, &b, sizeof(VertexKey)) == 0;
+		}
+	};
+
+	struct PositionHash
+	{
+		size_t operator()(const Vector3& position) const
+		{
+			uint32_t bits[3]{};
+			memcpy(bits, &position, sizeof(bits));
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+	};
+
+	struct PositionEqual
+	{
+		bool operator()(const Vector3& a, const Vector3& b) const
+		{
+			return a.x == b.x && a.y == b.y && a.z == b.z;
+		}
+	};
+
+	uint64_t GetEdgeKey(uint32_t a, uint32_t b)
+	{
+		return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+	}
+
+	Vector3 GetTriangleNormal(const Vector3& p0, const Vector3& p1, const Vector3& p2)
+	{
+		return Vector3::Cross(p1 - p0, p2 - p0);
+	}
+}
+
+float MeshSimplifier::Simplify(const std::vector<Vertex_In>& vertices, const std::vector<uint32_t>& indices, size_t targetAmountOfTriangles,
+	std::vector<Vertex_In>& verticesOut, std::vector<uint32_t>& indicesOut)
+{
+	//Topology is built on unique positions, the attributes of a corner are kept as a wedge (unique position, uv and normal)
+	std::unordered_map<VertexKey, uint32_t, VertexKeyHash, VertexKeyEqual> wedgeIds{};
+	std::unordered_map<Vector3, uint32_t, PositionHash, PositionEqual> positionIds{};
+	std::vector<uint32_t> wedgeToOriginal{};
+	std::vector<Vector3> positions{};
+	std::vector<uint32_t> triangles(indices.size());
+	std::vector<uint32_t> cornerWedges(indices.size());
+	for (size_t corner{}; corner < indices.size(); ++corner) {
+		const Vertex_In& vertex = vertices[indices[corner]];
+		const auto wedge = wedgeIds.emplace(VertexKey{ vertex.position, vertex.uv, vertex.normal }, static_cast<uint32_t>(wedgeToOriginal.size()));
+		if (wedge.second) {
+			wedgeToOriginal.push_back(indices[corner]);
+		}
+		const auto position = positionIds.emplace(vertex.position, static_cast<uint32_t>(positions.size()));
+		if (position.second) {
+			positions.push_back(vertex.position);
+		}
+		triangles[corner] = position.first->second;
+		cornerWedges[corner] = wedge.first->second;
+	}
+
+	const uint32_t amountOfVertices = static_cast<uint32_t>(positions.size());
+	const uint32_t amountOfTriangles = static_cast<uint32_t>(triangles.size() / 3);
+
+	//Triangles around every vertex
+	std::vector<std::vector<uint32_t>> vertexTriangles(amountOfVertices);
+	for (uint32_t corner{}; corner < triangles.size(); ++corner) {
+		vertexTriangles[triangles[corner]].push_back(corner / 3);
+	}
+
+	//Classify the edges, a seam edge has different wedges on its two sides
+	struct EdgeInfo
+	{
+		uint32_t count{};
+		uint32_t triangle{};
+		bool isSeam{};
+	};
+	std::unordered_map<uint64_t, EdgeInfo> edges{};
+	auto getCornerWedge = [&](uint32_t triangle, uint32_t vertex)
+		{
+			for (uint32_t corner{}; corner < 3; ++corner) {
+				if (triangles[triangle * 3 + corner] == vertex) {
+					return cornerWedges[triangle * 3 + corner];
+				}
+			}
+			return UINT32_MAX;
+		};
+	for (uint32_t triangle{}; triangle < amountOfTriangles; ++triangle) {
+		for (uint32_t corner{}; corner < 3; ++corner) {
+			const uint32_t a = triangles[triangle * 3 + corner];
+			const uint32_t b = triangles[triangle * 3 + (corner + 1) % 3];
+			EdgeInfo& edge = edges[GetEdgeKey(a, b)];
+			if (edge.count == 1) {
+				edge.isSeam = getCornerWedge(edge.triangle, a) != getCornerWedge(triangle, a) || getCornerWedge(edge.triangle, b) != getCornerWedge(triangle, b);
+			}
+			edge.triangle = triangle;
+			++edge.count;
+		}
+	}
+
+	//Interior vertices collapse freely, border and seam vertices only along their border or seam, the rest is locked
+	std::vector<VertexKind> kinds(amountOfVertices, VertexKind::Interior);
+	std::vector<uint32_t> borderEdges(amountOfVertices);
+	std::vector<uint32_t> seamEdges(amountOfVertices);
+	std::vector<uint32_t> wedgeCounts(amountOfVertices);
+	for (const auto& edge : edges) {
+		const uint32_t ends[2]{ static_cast<uint32_t>(edge.first >> 32), static_cast<uint32_t>(edge.first & 0xFFFFFFFF) };
+		for (const uint32_t end : ends) {
+			if (edge.second.count > 2) {
+				kinds[end] = VertexKind::Locked;
+			}
+			borderEdges[end] += edge.second.count == 1;
+			seamEdges[end] += edge.second.count == 2 && edge.second.isSeam;
+		}
+	}
+	for (const auto& wedge : wedgeIds) {
+		++wedgeCounts[positionIds[wedge.first.position]];
+	}
+	for (uint32_t vertex{}; vertex < amountOfVertices; ++vertex) {
+		if (kinds[vertex] == VertexKind::Locked) {
+			continue;
+		}
+		if (wedgeCounts[vertex] == 1 && borderEdges[vertex] == 0) {
+			kinds[vertex] = VertexKind::Interior;
+		}
+		else if (wedgeCounts[vertex] == 1 && borderEdges[vertex] == 2) {
+			kinds[vertex] = VertexKind::Border;
+		}
+		else if (wedgeCounts[vertex] == 2 && borderEdges[vertex] == 0 && seamEdges[vertex] == 2) {
+			kinds[vertex] = VertexKind::Seam;
+		}
+		else {
+			kinds[vertex] = VertexKind::Locked;
+		}
+	}
+
+	//Quadric of the planes around every vertex, weighted by area
+	//Border and seam edges add a plane through the edge perpendicular to the triangle, so those outlines keep their shape
+	std::vector<Quadric> quadrics(amountOfVertices);
+	for (uint32_t triangle{}; triangle < amountOfTriangles; ++triangle) {
+		const uint32_t* pCorners = &triangles[triangle * 3];
+		const Vector3 normal = GetTriangleNormal(positions[pCorners[0]], positions[pCorners[1]], positions[pCorners[2]]);
+		const float doubleArea = normal.Magnitude();
+		if (doubleArea <= 0.f) {
+			continue;
+		}
+		const Vector3 unitNormal = normal / doubleArea;
+		Quadric quadric{};
+		quadric.AddPlane(unitNormal, -Vector3::Dot(unitNormal, positions[pCorners[0]]), doubleArea * 0.5);
+		for (uint32_t corner{}; corner < 3; ++corner) {
+			quadrics[pCorners[corner]] += quadric;
+		}
+
+		for (uint32_t corner{}; corner < 3; ++corner) {
+			const uint32_t a = pCorners[corner];
+			const uint32_t b = pCorners[(corner + 1) % 3];
+			const EdgeInfo& edge = edges[GetEdgeKey(a, b)];
+			if (edge.count != 1 && !edge.isSeam) {
+				continue;
+			}
+			const Vector3 edgeVector = positions[b] - positions[a];
+			const float edgeLength = edgeVector.Magnitude();
+			if (edgeLength <= 0.f) {
+				continue;
+			}
+			const Vector3 edgeNormal = Vector3::Cross(edgeVector, unitNormal).Normalized();
+			Quadric edgeQuadric{};
+			edgeQuadric.AddPlane(edgeNormal, -Vector3::Dot(edgeNormal, positions[a]), EdgeWeight * edgeLength * edgeLength);
+			quadrics[a] += edgeQuadric;
+			quadrics[b] += edgeQuadric;
+		}
+	}
+
+	std::vector<bool> isTriangleRemoved(amountOfTriangles);
+	std::vector<bool> isVertexRemoved(amountOfVertices);
+	std::vector<uint32_t> versions(amountOfVertices);
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> collapses{};
+
+	auto pushCollapse = [&](uint32_t from, uint32_t to)
+		{
+			if (kinds[from] == VertexKind::Locked) {
+				return;
+			}
+			Quadric combined = quadrics[from];
+			combined += quadrics[to];
+			collapses.push(Collapse{ combined.Evaluate(positions[to]), from, to, versions[from], versions[to] });
+		};
+	auto pushCollapses = [&](uint32_t vertex)
+		{
+			for (const uint32_t triangle : vertexTriangles[vertex]) {
+				if (isTriangleRemoved[triangle]) {
+					continue;
+				}
+				for (uint32_t corner{}; corner < 3; ++corner) {
+					const uint32_t other = triangles[triangle * 3 + corner];
+					if (other != vertex) {
+						pushCollapse(vertex, other);
+						pushCollapse(other, vertex);
+					}
+				}
+			}
+		};
+
+	for (uint32_t vertex{}; vertex < amountOfVertices; ++vertex) {
+		pushCollapses(vertex);
+	}
+
+	//Checks the kind of the collapsed edge and that no remaining triangle of from flips
+	//Fills wedgeMap with the wedge at to that replaces every wedge at from
+	std::vector<std::pair<uint32_t, uint32_t>> wedgeMap{};
+	auto isValidCollapse = [&](uint32_t from, uint32_t to)
+		{
+			wedgeMap.clear();
+			uint32_t amountOfSharedTriangles{};
+			for (const uint32_t triangle : vertexTriangles[from]) {
+				if (isTriangleRemoved[triangle]) {
+					continue;
+				}
+				const uint32_t toWedge = getCornerWedge(triangle, to);
+				if (toWedge == UINT32_MAX) {
+					continue;
+				}
+				++amountOfSharedTriangles;
+				const uint32_t fromWedge = getCornerWedge(triangle, from);
+				const auto it = std::find_if(wedgeMap.begin(), wedgeMap.end(), [fromWedge](const auto& pair) { return pair.first == fromWedge; });
+				if (it == wedgeMap.end()) {
+					wedgeMap.emplace_back(fromWedge, toWedge);
+				}
+				else if (it->second != toWedge) {
+					return false;
+				}
+			}
+
+			switch (kinds[from]) {
+			case VertexKind::Interior:
+				if (amountOfSharedTriangles != 2 || wedgeMap.size() != 1) {
+					return false;
+				}
+				break;
+			case VertexKind::Border:
+				//Only along the border
+				if (amountOfSharedTriangles != 1) {
+					return false;
+				}
+				break;
+			case VertexKind::Seam:
+				//Only along the seam, one triangle on each side
+				if (amountOfSharedTriangles != 2 || wedgeMap.size() != 2) {
+					return false;
+				}
+				break;
+			default:
+				return false;
+			}
+
+			for (const uint32_t triangle : vertexTriangles[from]) {
+				const uint32_t* pCorners = &triangles[triangle * 3];
+				if (isTriangleRemoved[triangle] || pCorners[0] == to || pCorners[1] == to || pCorners[2] == to) {
+					continue;
+				}
+				Vector3 corners[3]{ positions[pCorners[0]], positions[pCorners[1]], positions[pCorners[2]] };
+				const Vector3 oldNormal = GetTriangleNormal(corners[0], corners[1], corners[2]);
+				for (uint32_t corner{}; corner < 3; ++corner) {
+					if (pCorners[corner] == from) {
+						corners[corner] = positions[to];
+					}
+				}
+				const Vector3 newNormal = GetTriangleNormal(corners[0], corners[1], corners[2]);
+				const float newLength = newNormal.Magnitude();
+				if (newLength <= 0.f || Vector3::Dot(oldNormal, newNormal) < MinNormalDot * oldNormal.Magnitude() * newLength) {
+					return false;
+				}
+
+				//Every remaining corner at from needs a wedge at to
+				const uint32_t fromWedge = getCornerWedge(triangle, from);
+				if (std::none_of(wedgeMap.begin(), wedgeMap.end(), [fromWedge](const auto& pair) { return pair.first == fromWedge; })) {
+					return false;
+				}
+			}
+			return true;
+		};
+
+	size_t amountOfLiveTriangles{ amountOfTriangles };
+	double maxSqrError{};
+	std::vector<uint32_t> ring{};
+	while (amountOfLiveTriangles > targetAmountOfTriangles && !collapses.empty()) {
+		const Collapse collapse = collapses.top();
+		collapses.pop();
+		if (isVertexRemoved[collapse.from] || isVertexRemoved[collapse.to] ||
+			versions[collapse.from] != collapse.fromVersion || versions[collapse.to] != collapse.toVersion) {
+			continue;
+		}
+		if (!isValidCollapse(collapse.from, collapse.to)) {
+			continue;
+		}
+
+		//Move the triangles of from onto to, the ones that share the edge disappear
+		ring.clear();
+		for (const uint32_t triangle : vertexTriangles[collapse.from]) {
+			if (isTriangleRemoved[triangle]) {
+				continue;
+			}
+			uint32_t* pCorners = &triangles[triangle * 3];
+			if (pCorners[0] == collapse.to || pCorners[1] == collapse.to || pCorners[2] == collapse.to) {
+				isTriangleRemoved[triangle] = true;
+				--amountOfLiveTriangles;
+			}
+			else {
+				for (uint32_t corner{}; corner < 3; ++corner) {
+					if (pCorners[corner] == collapse.from) {
+						pCorners[corner] = collapse.to;
+						uint32_t& wedge = cornerWedges[triangle * 3 + corner];
+						wedge = std::find_if(wedgeMap.begin(), wedgeMap.end(), [wedge](const auto& pair) { return pair.first == wedge; })->second;
+					}
+				}
+				vertexTriangles[collapse.to].push_back(triangle);
+			}
+			for (uint32_t corner{}; corner < 3; ++corner) {
+				ring.push_back(pCorners[corner]);
+			}
+		}
+		isVertexRemoved[collapse.from] = true;
+		quadrics[collapse.to] += quadrics[collapse.from];
+		const Quadric& combined = quadrics[collapse.to];
+		if (combined.weight > 0.0) {
+			maxSqrError = std::max(maxSqrError, combined.Evaluate(positions[collapse.to]) / combined.weight);
+		}
+
+		//The costs around the collapsed edge changed
+		for (const uint32_t vertex : ring) {
+			++versions[vertex];
+		}
+		std::sort(ring.begin(), ring.end());
+		ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+		for (const uint32_t vertex : ring) {
+			if (!isVertexRemoved[vertex]) {
+				pushCollapses(vertex);
+			}
+		}
+	}
+
+	//Only keep the wedges that are still used
+	verticesOut.clear();
+	indicesOut.clear();
+	std::vector<uint32_t> remap(wedgeToOriginal.size(), UINT32_MAX);
+	for (uint32_t triangle{}; triangle < amountOfTriangles; ++triangle) {
+		if (isTriangleRemoved[triangle]) {
+			continue;
+		}
+		for (uint32_t corner{}; corner < 3; ++corner) {
+			const uint32_t wedge = cornerWedges[triangle * 3 + corner];
+			if (remap[wedge] == UINT32_MAX) {
+				remap[wedge] = static_cast<uint32_t>(verticesOut.size());
+				verticesOut.push_back(vertices[wedgeToOriginal[wedge]]);
+			}
+			indicesOut.push_back(remap[wedge]);
+		}
+	}
+	return static_cast<float>(sqrt(maxSqrError));
+}
+
+void MeshSimplifier::BuildLODs(Mesh& mesh)
+{
+	mesh.lods.clear();
+
+	//Every level simplifies the original, so the error of a level is measured against full detail
+	//That also makes the levels independent of each other, so they are built at the same time
+	//The simplifier works on 32 bit indices, every level picks its own width again afterwards
+	const std::vector<uint32_t> indices = mesh.indices.ToVector();
+	std::vector<MeshLOD> lods(MaxAmountOfLODs - 1);
+	ParallelFor(size_t{ 1 }, MaxAmountOfLODs, [&](size_t level)
+		{
+			MeshLOD& lod = lods[level - 1];
+			const size_t targetAmountOfTriangles = (indices.size() / 3) >> level;
+			std::vector<uint32_t> lodIndices{};
+			lod.error = Simplify(mesh.vertices, indices, targetAmountOfTriangles, lod.vertices, lodIndices);
+
+			std::vector<Vector3> positions{};
+			positions.reserve(lod.vertices.size());
+			for (const auto& vertex : lod.vertices) {
+				positions.push_back(vertex.position);
+			}
+			lod.meshlets = MeshletUtils::BuildMeshlets(positions, lodIndices);
+			lod.indices = IndexBuffer{ lodIndices, lod.vertices.size() };
+		}
+	);
+
+	//Keep levels as long as they remove enough triangles
+	size_t previousAmountOfTriangles = indices.size() / 3;
+	for (MeshLOD& lod : lods) {
+		const size_t amountOfTriangles = lod.indices.GetAmountOfIndices() / 3;
+		if (amountOfTriangles > previousAmountOfTriangles * (1.f - MinReduction)) {
+			break;
+		}
+		previousAmountOfTriangles = amountOfTriangles;
+		mesh.lods.push_back(std::move(lod));
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+#include "DataTypes.h"
+
+//Quadric error metric simplification (Garland & Heckbert) with half edge collapses
+//Vertices only move onto existing vertices, so uvs, normals and tangents are never interpolated
+//Vertices on uv seams, hard normal edges and open borders only slide along them, that keeps those edges intact
+namespace MeshSimplifier
+{
+	//Every level has about half the triangles of the previous one
+	constexpr size_t MaxAmountOfLODs{ 4 };
+	//Stop adding levels once a level can't remove at least this fraction of the triangles of the previous one
+	constexpr float MinReduction{ 0.25f };
+
+	//Returns the largest quadric error of the applied collapses, indicesOut refers to verticesOut
+	//The quadric error is the area weighted root mean square distance to the merged planes, not the largest distance to the original surface
+	float Simplify(const std::vector<Vertex_In>& vertices, const std::vector<uint32_t>& indices, size_t targetAmountOfTriangles,
+		std::vector<Vertex_In>& verticesOut, std::vector<uint32_t>& indicesOut);
+
+	//Fills the LOD chain of the mesh, the mesh itself stays LOD 0
+	void BuildLODs(Mesh& mesh);
+}
@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "Mesh_Hardware.h"
+#include "VertexQuantization.h"
 
 Mesh_Hardware::Mesh_Hardware(Mesh* pMesh, ID3D11Device* pDevice, Effect* pEffect)
 {
@@ -9,17 +10,24 @@ Mesh_Hardware::Mesh_Hardware(Mesh* pMesh, ID3D11Device* pDevice, Effect* pEffect
 
 	m_pInternalMesh = pMesh;
 
+	// The input layout of the effect expects full vertices, quantized meshes are decoded for the upload
+	std::vector<Vertex_In> decodedVertices{};
+	if (pMesh->isQuantized) {
+		decodedVertices = VertexQuantization::Decode(pMesh->quantizedVertices, pMesh->localBox);
+	}
+	const std::vector<Vertex_In>& vertices = pMesh->isQuantized ? decodedVertices : pMesh->vertices;
+
 	// Create vertex buffer
 	D3D11_BUFFER_DESC bd = {};
 	bd.Usage = D3D11_USAGE_IMMUTABLE;
 	// Use the template here, the sizes are different
-	bd.ByteWidth = sizeof(Vertex_In) * static_cast<uint32_t>(pMesh->vertices.size());
+	bd.ByteWidth = sizeof(Vertex_In) * static_cast<uint32_t>(vertices.size());
 	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 	bd.CPUAccessFlags = 0;
 	bd.MiscFlags = 0;
 
 	D3D11_SUBRESOURCE_DATA initData = {};
-	initData.pSysMem = pMesh->vertices.data();
+	initData.pSysMem = vertices.data();
 
 	HRESULT result = pDevice->CreateBuffer(&bd, &initData, &m_pVertexBuffer);
 
@@ -28,13 +36,15 @@ Mesh_Hardware::Mesh_Hardware(Mesh* pMesh, ID3D11Device* pDevice, Effect* pEffect
 	}
 
 	// Create index buffer
-	m_NumIndices = static_cast<uint32_t>(pMesh->indices.size());
+	// 16 bit indices when the mesh has few enough vertices, that halves the index fetches
+	m_NumIndices = static_cast<uint32_t>(pMesh->indices.GetAmountOfIndices());
+	m_IndexFormat = pMesh->indices.Is16Bit() ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
 	bd.Usage = D3D11_USAGE_IMMUTABLE;
-	bd.ByteWidth = sizeof(uint32_t) * m_NumIndices;
+	bd.ByteWidth = static_cast<uint32_t>(pMesh->indices.GetSizeInBytes());
 	bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
 	bd.CPUAccessFlags = 0;
 	bd.MiscFlags = 0;
-	initData.pSysMem = pMesh->indices.data();
+	initData.pSysMem = pMesh->indices.GetData();
 
 	result = pDevice->CreateBuffer(&bd, &initData, &m_pIndexBuffer);
 
@@ -58,7 +68,7 @@ void Mesh_Hardware::Render(ID3D11DeviceContext* pDeviceContext) const
 	pDeviceContext->IASetVertexBuffers(0, 1, &m_pVertexBuffer, &stride, &offset);
 
 	// Set index buffer
-	pDeviceContext->IASetIndexBuffer(m_pIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	pDeviceContext->IASetIndexBuffer(m_pIndexBuffer, m_IndexFormat, 0);
 	// Update the matrices
 	// Now done in Renderer
 
@@ -33,4 +33,5 @@ private:
 	ID3D11InputLayout* m_pInputLayout{};
 
 	uint32_t m_NumIndices{};
+	DXGI_FORMAT m_IndexFormat{ DXGI_FORMAT_R32_UINT };
 };
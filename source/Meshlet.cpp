@@ -0,0 +1,255 @@
+#include "pch.h"
+#include "Meshlet.h"
+#include <cstring> //memcpy
+#include <unordered_map>
+
+using namespace dae;
+
+namespace
+{
+	//Triangles only join a meshlet if their normal is close to the normal of the meshlet, that keeps the cones narrow
+	constexpr float MinNormalDot{ 0.75f };
+	//How far ahead in the spatial order a meshlet looks for a triangle when it has no connected ones left
+	constexpr size_t SpatialLookAhead{ 512 };
+
+	struct PositionHash
+	{
+		size_t operator()(const Vector3& position) const
+		{
+			uint32_t bits[3]{};
+			memcpy(bits, &position, sizeof(bits));
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+	};
+
+	struct PositionEqual
+	{
+		bool operator()(const Vector3& a, const Vector3& b) const
+		{
+			return a.x == b.x && a.y == b.y && a.z == b.z;
+		}
+	};
+
+	//Spreads the bits of a 10 bit value so three of them can be interleaved
+	uint32_t SpreadBits(uint32_t value)
+	{
+		value = (value | (value << 16)) & 0x030000FF;
+		value = (value | (value << 8)) & 0x0300F00F;
+		value = (value | (value << 4)) & 0x030C30C3;
+		value = (value | (value << 2)) & 0x09249249;
+		return value;
+	}
+
+	//Triangle indices sorted on the Morton code of their centroid
+	std::vector<uint32_t> SortTrianglesSpatially(const std::vector<Vector3>& positions, const std::vector<uint32_t>& indices)
+	{
+		const uint32_t amountOfTriangles = static_cast<uint32_t>(indices.size() / 3);
+		std::vector<Vector3> centroids(amountOfTriangles);
+		for (uint32_t triangle{}; triangle < amountOfTriangles; ++triangle) {
+			centroids[triangle] = (positions[indices[triangle * 3]] + positions[indices[triangle * 3 + 1]] + positions[indices[triangle * 3 + 2]]) / 3.f;
+		}
+
+		const AABB box = AABB::FromPoints(centroids);
+		const Vector3 size = box.max - box.min;
+		const float maxSize = std::max(size.x, std::max(size.y, size.z));
+		const float scale = maxSize > 0.f ? 1023.f / maxSize : 0.f;
+
+		std::vector<std::pair<uint32_t, uint32_t>> codes(amountOfTriangles);
+		for (uint32_t triangle{}; triangle < amountOfTriangles; ++triangle) {
+			const Vector3 local = (centroids[triangle] - box.min) * scale;
+			const uint32_t code = SpreadBits(static_cast<uint32_t>(local.x)) | (SpreadBits(static_cast<uint32_t>(local.y)) << 1) | (SpreadBits(static_cast<uint32_t>(local.z)) << 2);
+			codes[triangle] = { code, triangle };
+		}
+		std::sort(codes.begin(), codes.end());
+
+		std::vector<uint32_t> order(amountOfTriangles);
+		for (uint32_t i{}; i < amountOfTriangles; ++i) {
+			order[i] = codes[i].second;
+		}
+		return order;
+	}
+
+	void CalculateMeshletBounds(Meshlet& meshlet, const std::vector<Vector3>& positions, const std::vector<uint32_t>& indices)
+	{
+		std::vector<Vector3> meshletPositions{};
+		meshletPositions.reserve(meshlet.amountOfTriangles * 3);
+		for (uint32_t i{}; i < meshlet.amountOfTriangles * 3; ++i) {
+			meshletPositions.push_back(positions[indices[meshlet.firstIndex + i]]);
+		}
+		meshlet.sphere = CreateBoundingSphere(meshletPositions, AABB::FromPoints(meshletPositions));
+
+		//Average normal is the cone axis
+		std::vector<Vector3> normals(meshlet.amountOfTriangles);
+		Vector3 axis{};
+		for (uint32_t triangle{}; triangle < meshlet.amountOfTriangles; ++triangle) {
+			const Vector3& p0 = meshletPositions[triangle * 3];
+			const Vector3 normal = Vector3::Cross(meshletPositions[triangle * 3 + 1] - p0, meshletPositions[triangle * 3 + 2] - p0);
+			const float length = normal.Magnitude();
+			normals[triangle] = length > 0.f ? normal / length : Vector3{};
+			axis += normals[triangle];
+		}
+		const float axisLength = axis.Magnitude();
+		if (axisLength <= 0.f) {
+			return;
+		}
+		axis /= axisLength;
+
+		//Widest angle between the axis and a triangle normal
+		float minDot{ 1.f };
+		for (const Vector3& normal : normals) {
+			minDot = std::min(minDot, Vector3::Dot(normal, axis));
+		}
+		//Cone of 90 degrees or more, can't be backface culled
+		if (minDot <= 0.1f) {
+			return;
+		}
+
+		//Move the apex back along the axis until all triangle planes are in front of it
+		float maxT{};
+		for (uint32_t triangle{}; triangle < meshlet.amountOfTriangles; ++triangle) {
+			const float normalDotAxis = Vector3::Dot(normals[triangle], axis);
+			if (normalDotAxis <= 0.f) {
+				continue;
+			}
+			const float t = Vector3::Dot(meshlet.sphere.center - meshletPositions[triangle * 3], normals[triangle]) / normalDotAxis;
+			maxT = std::max(maxT, t);
+		}
+
+		meshlet.coneApex = meshlet.sphere.center - axis * maxT;
+		meshlet.coneAxis = axis;
+		//The normal cone widened by 90 degrees on both sides, inverted: cos(angle + 90) = -sin(angle)
+		meshlet.coneCutoff = sqrtf(1.f - minDot * minDot);
+	}
+}
+
+std::vector<Meshlet> MeshletUtils::BuildMeshlets(const std::vector<Vector3>& positions, std::vector<uint32_t>& indices)
+{
+	const uint32_t amountOfTriangles = static_cast<uint32_t>(indices.size() / 3);
+
+	//The OBJ parser duplicates vertices per face, so triangles are connected through equal positions
+	std::unordered_map<Vector3, uint32_t, PositionHash, PositionEqual> positionIds{};
+	std::vector<uint32_t> cornerIds(amountOfTriangles * 3);
+	for (uint32_t corner{}; corner < amountOfTriangles * 3; ++corner) {
+		const auto result = positionIds.emplace(positions[indices[corner]], static_cast<uint32_t>(positionIds.size()));
+		cornerIds[corner] = result.first->second;
+	}
+
+	//Triangles around every unique position, as a compact list
+	std::vector<uint32_t> positionTriangleOffsets(positionIds.size() + 1);
+	for (const uint32_t id : cornerIds) {
+		++positionTriangleOffsets[id + 1];
+	}
+	for (size_t id{ 1 }; id < positionTriangleOffsets.size(); ++id) {
+		positionTriangleOffsets[id] += positionTriangleOffsets[id - 1];
+	}
+	std::vector<uint32_t> positionTriangles(cornerIds.size());
+	std::vector<uint32_t> fillOffsets(positionTriangleOffsets.begin(), positionTriangleOffsets.end() - 1);
+	for (uint32_t corner{}; corner < cornerIds.size(); ++corner) {
+		positionTriangles[fillOffsets[cornerIds[corner]]++] = corner / 3;
+	}
+
+	std::vector<Vector3> triangleNormals(amountOfTriangles);
+	for (uint32_t triangle{}; triangle < amountOfTriangles; ++triangle) {
+		const Vector3& p0 = positions[indices[triangle * 3]];
+		const Vector3 normal = Vector3::Cross(positions[indices[triangle * 3 + 1]] - p0, positions[indices[triangle * 3 + 2]] - p0);
+		const float length = normal.Magnitude();
+		triangleNormals[triangle] = length > 0.f ? normal / length : Vector3{};
+	}
+
+	//Seeds are taken in spatial order, so a meshlet can continue with a close triangle when it runs out of connected ones
+	const std::vector<uint32_t> spatialOrder = SortTrianglesSpatially(positions, indices);
+
+	std::vector<Meshlet> meshlets{};
+	std::vector<uint32_t> newIndices{};
+	newIndices.reserve(indices.size());
+	std::vector<bool> isAssigned(amountOfTriangles);
+	std::vector<uint32_t> visitedInMeshlet(amountOfTriangles, UINT32_MAX);
+	std::vector<uint32_t> frontier{};
+	size_t cursor{};
+
+	while (true) {
+		while (cursor < spatialOrder.size() && isAssigned[spatialOrder[cursor]]) {
+			++cursor;
+		}
+		if (cursor == spatialOrder.size()) {
+			break;
+		}
+
+		Meshlet meshlet{};
+		meshlet.firstIndex = static_cast<uint32_t>(newIndices.size());
+		const uint32_t meshletIndex = static_cast<uint32_t>(meshlets.size());
+		Vector3 normalSum{};
+
+		frontier.clear();
+		frontier.push_back(spatialOrder[cursor]);
+		visitedInMeshlet[spatialOrder[cursor]] = meshletIndex;
+		while (meshlet.amountOfTriangles < MaxTrianglesPerMeshlet) {
+			//Grow with the connected triangle that fits the normal of the meshlet best
+			int bestCandidate{ -1 };
+			float bestDot{ -FLT_MAX };
+			for (size_t candidate{}; candidate < frontier.size(); ++candidate) {
+				const float dot = Vector3::Dot(triangleNormals[frontier[candidate]], normalSum);
+				if (dot > bestDot) {
+					bestDot = dot;
+					bestCandidate = static_cast<int>(candidate);
+				}
+			}
+
+			uint32_t triangle{ UINT32_MAX };
+			const float minDot = MinNormalDot * normalSum.Magnitude();
+			if (bestCandidate >= 0 && bestDot >= minDot) {
+				triangle = frontier[bestCandidate];
+				frontier[bestCandidate] = frontier.back();
+				frontier.pop_back();
+			}
+			else {
+				//Nothing connected fits anymore, try the triangles that are close in the spatial order
+				const size_t end = std::min(cursor + SpatialLookAhead, spatialOrder.size());
+				for (size_t i{ cursor }; i < end; ++i) {
+					const uint32_t closeTriangle = spatialOrder[i];
+					if (!isAssigned[closeTriangle] && Vector3::Dot(triangleNormals[closeTriangle], normalSum) >= minDot) {
+						triangle = closeTriangle;
+						break;
+					}
+				}
+				if (triangle == UINT32_MAX) {
+					break;
+				}
+			}
+
+			isAssigned[triangle] = true;
+			normalSum += triangleNormals[triangle];
+			++meshlet.amountOfTriangles;
+			for (uint32_t corner{}; corner < 3; ++corner) {
+				newIndices.push_back(indices[triangle * 3 + corner]);
+			}
+
+			//Queue the neighbours that share a position
+			for (uint32_t corner{}; corner < 3; ++corner) {
+				const uint32_t id = cornerIds[triangle * 3 + corner];
+				for (uint32_t i{ positionTriangleOffsets[id] }; i < positionTriangleOffsets[id + 1]; ++i) {
+					const uint32_t neighbour = positionTriangles[i];
+					if (!isAssigned[neighbour] && visitedInMeshlet[neighbour] != meshletIndex) {
+						visitedInMeshlet[neighbour] = meshletIndex;
+						frontier.push_back(neighbour);
+					}
+				}
+			}
+			//Neighbours that were queued before can be taken by the spatial fallback
+			frontier.erase(std::remove_if(frontier.begin(), frontier.end(), [&isAssigned](uint32_t candidate) { return isAssigned[candidate]; }), frontier.end());
+		}
+		meshlets.push_back(meshlet);
+	}
+
+	indices = std::move(newIndices);
+	for (Meshlet& meshlet : meshlets) {
+		CalculateMeshletBounds(meshlet, positions, indices);
+	}
+	return meshlets;
+}
+
+bool MeshletUtils::IsBackFacing(const Meshlet& meshlet, const Vector3& cameraPosition)
+{
+	const Vector3 apexDirection = (meshlet.coneApex - cameraPosition).Normalized();
+	return Vector3::Dot(apexDirection, meshlet.coneAxis) >= meshlet.coneCutoff;
+}
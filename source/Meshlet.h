@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include "BoundingVolumes.h"
+
+//Cluster of neighbouring triangles that is culled as a whole
+//The triangles of a meshlet are stored contiguously in the index buffer of its mesh
+struct Meshlet
+{
+	uint32_t firstIndex{};
+	uint32_t amountOfTriangles{};
+	//The same triangles as a strip in the strip indices of the level, only filled for meshes that are drawn as strips
+	uint32_t firstStripIndex{};
+	uint32_t amountOfStripIndices{};
+
+	dae::BoundingSphere sphere{};
+
+	//Normal cone, all triangles face away from a camera inside the cone behind the apex
+	dae::Vector3 coneApex{};
+	dae::Vector3 coneAxis{};
+	//1 means the cone is too wide to ever reject the meshlet
+	float coneCutoff{ 1.f };
+};
+
+namespace MeshletUtils
+{
+	constexpr uint32_t MaxTrianglesPerMeshlet{ 128 };
+
+	//Groups the triangles in meshlets and reorders the indices so every meshlet is one contiguous range
+	std::vector<Meshlet> BuildMeshlets(const std::vector<dae::Vector3>& positions, std::vector<uint32_t>& indices);
+
+	//Camera position in the object space of the meshlet
+	bool IsBackFacing(const Meshlet& meshlet, const dae::Vector3& cameraPosition);
+}
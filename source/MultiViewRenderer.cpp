@@ -0,0 +1,69 @@
+#include "pch.h"
+#include "MultiViewRenderer.h"
+#include "Parallel.h"
+#include <thread>
+
+namespace dae
+{
+	MultiViewRenderer::MultiViewRenderer(std::vector<Mesh*>& pMeshes) :
+		m_pMeshes{ pMeshes },
+		m_pWorldSpaceCache{ std::make_shared<WorldSpaceCache>() },
+		m_pShadowMap{ std::make_shared<ShadowMap>(Renderer_Software::ShadowMapResolution) }
+	{
+	}
+
+	MultiViewRenderer::~MultiViewRenderer()
+	{
+		for (auto pView : m_pViews) {
+			delete pView;
+			pView = nullptr;
+		}
+	}
+
+	size_t MultiViewRenderer::AddView(int width, int height, Camera* pCamera)
+	{
+		pCamera->aspectRatio = static_cast<float>(width) / static_cast<float>(height);
+		pCamera->CalculateViewMatrix();
+		pCamera->CalculateProjectionMatrix();
+
+		Renderer_Software* pView = new Renderer_Software(width, height, pCamera, m_pMeshes);
+		pView->SetWorldSpaceCache(m_pWorldSpaceCache);
+		pView->SetShadowMap(m_pShadowMap);
+		m_pViews.push_back(pView);
+		return m_pViews.size() - 1;
+	}
+
+	size_t MultiViewRenderer::GetAmountOfViews() const
+	{
+		return m_pViews.size();
+	}
+
+	Renderer_Software* MultiViewRenderer::GetView(size_t viewIndex) const
+	{
+		return m_pViews.at(viewIndex);
+	}
+
+	void MultiViewRenderer::Render()
+	{
+		//A view that runs on a thread of its own runs its loops on that thread
+		//So the views only get a thread each when there are enough of them to keep every thread busy,
+		//with fewer views they are rendered one after the other and each one uses every thread
+		const size_t amountOfThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		if (m_pViews.size() >= amountOfThreads) {
+			ParallelFor(size_t{}, m_pViews.size(), [this](size_t viewIndex)
+				{
+					m_pViews[viewIndex]->Render();
+				});
+			return;
+		}
+
+		for (auto pView : m_pViews) {
+			pView->Render();
+		}
+	}
+
+	const WorldSpaceCache& MultiViewRenderer::GetWorldSpaceCache() const
+	{
+		return *m_pWorldSpaceCache;
+	}
+}
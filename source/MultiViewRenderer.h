@@ -0,0 +1,43 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "Renderer_Software.h"
+#include "WorldSpaceCache.h"
+
+namespace dae
+{
+	//Renders the same meshes from several cameras in one pass, like the angles of a turntable or a batch of thumbnails
+	//Every view is a software renderer with its own size and image, the world space vertices are transformed once for all of them
+	//The views share one shadow map as well, so it is drawn once for all of them
+	//Only the projection, rasterization and shading are done per view
+	class MultiViewRenderer final
+	{
+	public:
+		//The meshes and the cameras have to outlive the renderer
+		explicit MultiViewRenderer(std::vector<Mesh*>& pMeshes);
+		~MultiViewRenderer();
+
+		//Rule of 5
+		MultiViewRenderer(const MultiViewRenderer&) = delete;
+		MultiViewRenderer(MultiViewRenderer&&) noexcept = delete;
+		MultiViewRenderer& operator=(const MultiViewRenderer&) = delete;
+		MultiViewRenderer& operator=(MultiViewRenderer&&) noexcept = delete;
+
+		//Returns the index of the new view, the aspect ratio of the camera is set to the size of the view
+		size_t AddView(int width, int height, Camera* pCamera);
+		size_t GetAmountOfViews() const;
+		//For the render states, the lights and the image of the view
+		Renderer_Software* GetView(size_t viewIndex) const;
+
+		//Renders every view, instances may not move during the call
+		void Render();
+
+		const WorldSpaceCache& GetWorldSpaceCache() const;
+
+	private:
+		std::vector<Mesh*> m_pMeshes{};
+		std::vector<Renderer_Software*> m_pViews{};
+		std::shared_ptr<WorldSpaceCache> m_pWorldSpaceCache{};
+		std::shared_ptr<ShadowMap> m_pShadowMap{};
+	};
+}
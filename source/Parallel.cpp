@@ -0,0 +1,135 @@
+#include "pch.h"
+#include "Parallel.h"
+#include <chrono>
+
+#if !defined(_MSC_VER)
+namespace dae
+{
+	namespace
+	{
+		//Set on the worker threads, a loop started from a worker runs on that worker
+		thread_local bool g_IsWorkerThread{ false };
+		//Set while the thread runs iterations, the loops started from them are already part of its busy time
+		thread_local bool g_IsInIterations{ false };
+
+		uint64_t GetNanosecondsSince(std::chrono::steady_clock::time_point start)
+		{
+			return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+		}
+	}
+
+	ThreadPool& ThreadPool::GetInstance()
+	{
+		static ThreadPool threadPool{};
+		return threadPool;
+	}
+
+	ThreadPool::ThreadPool()
+	{
+		//The thread that starts a loop also works on it
+		const unsigned int amountOfThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		m_Threads.reserve(amountOfThreads - 1);
+		for (unsigned int i{ 1 }; i < amountOfThreads; ++i) {
+			m_Threads.emplace_back(&ThreadPool::RunWorker, this);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			m_ShouldStop = true;
+		}
+		m_WorkCondition.notify_all();
+		for (std::thread& thread : m_Threads) {
+			thread.join();
+		}
+	}
+
+	void ThreadPool::Run(size_t amountOfIterations, const std::function<void(size_t)>& function)
+	{
+		//A loop started from inside the iterations runs inline, the thread that started the outer loop already owns the run mutex
+		std::unique_lock<std::mutex> runLock{ m_RunMutex, std::defer_lock };
+		if (m_Threads.empty() || g_IsWorkerThread || g_IsInIterations || !runLock.try_lock()) {
+			const bool isNested = g_IsInIterations;
+			const auto start = std::chrono::steady_clock::now();
+			g_IsInIterations = true;
+			for (size_t i{}; i < amountOfIterations; ++i) {
+				function(i);
+			}
+			if (!isNested) {
+				g_IsInIterations = false;
+				m_BusyTime += GetNanosecondsSince(start);
+			}
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			m_pFunction = &function;
+			m_AmountOfIterations = amountOfIterations;
+			m_NextIteration = 0;
+			m_AmountOfBusyWorkers = m_Threads.size();
+			++m_LoopIndex;
+		}
+		m_WorkCondition.notify_all();
+
+		RunIterations();
+
+		//The function lives on the stack of the caller, so wait until no worker can still call it
+		std::unique_lock<std::mutex> lock{ m_Mutex };
+		m_DoneCondition.wait(lock, [this]() { return m_AmountOfBusyWorkers == 0; });
+		m_pFunction = nullptr;
+	}
+
+	uint64_t ThreadPool::GetBusyTime() const
+	{
+		return m_BusyTime.load(std::memory_order_relaxed);
+	}
+
+	uint32_t ThreadPool::GetAmountOfThreads() const
+	{
+		return static_cast<uint32_t>(m_Threads.size() + 1);
+	}
+
+	void ThreadPool::RunWorker()
+	{
+		g_IsWorkerThread = true;
+		uint64_t lastLoopIndex{};
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock{ m_Mutex };
+				m_WorkCondition.wait(lock, [&]() { return m_ShouldStop || m_LoopIndex != lastLoopIndex; });
+				if (m_ShouldStop) {
+					return;
+				}
+				lastLoopIndex = m_LoopIndex;
+			}
+
+			RunIterations();
+
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			--m_AmountOfBusyWorkers;
+			if (m_AmountOfBusyWorkers == 0) {
+				m_DoneCondition.notify_one();
+			}
+		}
+	}
+
+	void ThreadPool::RunIterations()
+	{
+		const auto start = std::chrono::steady_clock::now();
+		g_IsInIterations = true;
+		//Iterations are handed out one at a time, the loops of the renderer have few and large iterations
+		while (true) {
+			const size_t iteration = m_NextIteration.fetch_add(1);
+			if (iteration >= m_AmountOfIterations) {
+				break;
+			}
+			(*m_pFunction)(iteration);
+		}
+		g_IsInIterations = false;
+		m_BusyTime += GetNanosecondsSince(start);
+	}
+}
+#endif
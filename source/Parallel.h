@@ -0,0 +1,103 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+//The Windows build uses the Parallel Patterns Library, other compilers don't have it and use a small thread pool instead
+#if defined(_MSC_VER)
+#include <ppl.h>
+#else
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif
+
+namespace dae
+{
+#if !defined(_MSC_VER)
+	//Runs the iterations of a loop on worker threads that stay alive for the whole program
+	//The calling thread works along and returns when all iterations are done
+	class ThreadPool final
+	{
+	public:
+		static ThreadPool& GetInstance();
+
+		//Rule of 5
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) noexcept = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+		//Calls function for every index below amountOfIterations
+		//Loops started from inside a loop or while another thread runs one are run on the calling thread
+		void Run(size_t amountOfIterations, const std::function<void(size_t)>& function);
+
+		//Nanoseconds all threads together spent in iterations since the start, loops inside an iteration aren't counted twice
+		uint64_t GetBusyTime() const;
+		//Workers and the thread that starts the loops
+		uint32_t GetAmountOfThreads() const;
+
+	private:
+		ThreadPool();
+		~ThreadPool();
+
+		void RunWorker();
+		void RunIterations();
+
+		std::vector<std::thread> m_Threads{};
+		//Only one loop runs on the pool at a time
+		std::mutex m_RunMutex{};
+
+		std::mutex m_Mutex{};
+		std::condition_variable m_WorkCondition{};
+		std::condition_variable m_DoneCondition{};
+		const std::function<void(size_t)>* m_pFunction{};
+		size_t m_AmountOfIterations{};
+		std::atomic<size_t> m_NextIteration{};
+		size_t m_AmountOfBusyWorkers{};
+		//Goes up for every loop, so a worker knows there is new work
+		uint64_t m_LoopIndex{};
+		bool m_ShouldStop{};
+		std::atomic<uint64_t> m_BusyTime{};
+	};
+#endif
+
+	//Parallel loop over [first, last)
+	template<typename Index, typename Function>
+	void ParallelFor(Index first, Index last, const Function& function)
+	{
+#if defined(_MSC_VER)
+		concurrency::parallel_for(first, last, function);
+#else
+		if (last <= first) {
+			return;
+		}
+		ThreadPool::GetInstance().Run(static_cast<size_t>(last - first), [&](size_t iteration)
+			{
+				function(static_cast<Index>(first + static_cast<Index>(iteration)));
+			});
+#endif
+	}
+
+	//Nanoseconds all threads together spent in the iterations of parallel loops since the start
+	//The Parallel Patterns Library doesn't report this, it gives 0 for both
+	inline uint64_t GetParallelBusyTime()
+	{
+#if defined(_MSC_VER)
+		return 0;
+#else
+		return ThreadPool::GetInstance().GetBusyTime();
+#endif
+	}
+
+	inline uint32_t GetAmountOfParallelThreads()
+	{
+#if defined(_MSC_VER)
+		return 0;
+#else
+		return ThreadPool::GetInstance().GetAmountOfThreads();
+#endif
+	}
+}
@@ -2,10 +2,16 @@
 #include "RenderManager.h"
 #include "Utils.h"
 #include "DataTypes.h"
+#include "MeshSimplifier.h"
+#include "VertexQuantization.h"
+#include "Stripifier.h"
+#include <future>
 
 namespace dae {
 
-	RenderManager::RenderManager(SDL_Window* pWindow) :
+	RenderManager::RenderManager(SDL_Window* pWindow, bool quantizeVertices, bool useTriangleStrips) :
+		m_QuantizeVertices(quantizeVertices),
+		m_UseTriangleStrips(useTriangleStrips),
 		m_pWindow(pWindow)
 	{
 		//Initialize Camera
@@ -18,7 +24,9 @@ namespace dae {
 		m_pCamera->Initialize(45.f, { .0f, 0.f, 0.f }, aspectRatio);
 		
 		//Initialize meshes
+		m_pTextureManager = new TextureManager();
 		LoadMeshes();
+		m_pTextureManager->PrintStatistics();
 
 		//Create the different renderers
 		m_pRendererSoftware = new Renderer_Software(pWindow, m_pCamera, m_pMeshes);
@@ -38,6 +46,10 @@ namespace dae {
 		delete m_pCamera;
 		m_pCamera = nullptr;
 
+		//The meshes own their textures, the manager only keeps track of them
+		delete m_pTextureManager;
+		m_pTextureManager = nullptr;
+
 		delete m_pRendererSoftware;
 		m_pRendererSoftware = nullptr;
 
@@ -73,6 +85,8 @@ namespace dae {
 		case RenderType::Hardware:
 			m_pCurrentRenderer = m_pRendererSoftware;
 			m_CurrentRenderType = RenderType::Software;
+			//The window shows the last hardware frame
+			m_pRendererSoftware->InvalidateFrame();
 			std::cout << "Switched to software renderer" << std::endl;
 			break;
 		}
@@ -93,16 +107,15 @@ namespace dae {
 
 	void RenderManager::ToggleFire()
 	{
-		//Only if you are currently in hardware
-		if (m_pCurrentRenderer == m_pRendererHardware) {
-			if (m_pRendererHardware->CanRenderFire()) {
-				std::cout << "Fire turned off" << std::endl;
-			}
-			else {
-				std::cout << "Fire turned on" << std::endl;
-			}
-			m_pRendererHardware->ToggleFire();
+		//Turn it off for both
+		if (m_pRendererHardware->CanRenderFire()) {
+			std::cout << "Fire turned off" << std::endl;
 		}
+		else {
+			std::cout << "Fire turned on" << std::endl;
+		}
+		m_pRendererSoftware->ToggleFire();
+		m_pRendererHardware->ToggleFire();
 	}
 
 	void RenderManager::CycleSamplerState()
@@ -145,6 +158,36 @@ namespace dae {
 		}
 	}
 
+	void RenderManager::ToggleTemporalCache()
+	{
+		//Only if you are in software
+		if (m_pCurrentRenderer == m_pRendererSoftware) {
+			m_pRendererSoftware->ToggleTemporalCache();
+			if (m_pRendererSoftware->IsTemporalCacheEnabled()) {
+				std::cout << "Temporal cache turned on" << std::endl;
+			}
+			else {
+				std::cout << "Temporal cache turned off" << std::endl;
+			}
+		}
+	}
+
+	void RenderManager::ToggleShadows()
+	{
+		//Only if you are in software
+		if (m_pCurrentRenderer == m_pRendererSoftware) {
+			m_pRendererSoftware->ToggleShadows();
+		}
+	}
+
+	void RenderManager::CycleShadowFilterSize()
+	{
+		//Only if you are in software
+		if (m_pCurrentRenderer == m_pRendererSoftware) {
+			m_pRendererSoftware->CycleShadowFilterSize();
+		}
+	}
+
 	void RenderManager::TogglePrintFPW()
 	{
 		m_CanPrintFPW = !m_CanPrintFPW;
@@ -175,43 +218,95 @@ namespace dae {
 		return m_CanPrintFPW;
 	}
 
+	bool RenderManager::WasFrameSkipped() const
+	{
+		//Only the software renderer skips frames
+		return m_pCurrentRenderer == m_pRendererSoftware && m_pRendererSoftware->WasFrameSkipped();
+	}
+
+	void RenderManager::InvalidateFrame()
+	{
+		m_pRendererSoftware->InvalidateFrame();
+	}
+
+	void RenderManager::PrintFrameStatistics() const
+	{
+		if (m_pCurrentRenderer == m_pRendererSoftware) {
+			m_pRendererSoftware->PrintFrameMemory();
+			m_pRendererSoftware->PrintTemporalCacheStatistics();
+		}
+	}
+
+	Renderer_Software* RenderManager::GetSoftwareRenderer() const
+	{
+		return m_pRendererSoftware;
+	}
+
+	RenderManager::RenderType RenderManager::GetRenderType() const
+	{
+		return m_CurrentRenderType;
+	}
+
 	void RenderManager::LoadMeshes()
 	{
 		//Initial transform
 		Vector3 translation{ 0, 0, 50.f };
 		Vector3 scale{ 1, 1, 1 };
 		float yawRotation = 90.f * TO_RADIANS;
-		
+
+		//Every OBJ parse and PNG decode runs on its own thread, a mesh is put together as soon as its own assets are ready
+		//The textures are attached last, so the vehicle can build its levels of detail while they decode
+		auto loadTexture = [this](const std::string& path)
+			{
+				return std::async(std::launch::async, &TextureManager::Load, m_pTextureManager, path);
+			};
+		const bool quantizeVertices = m_QuantizeVertices;
+		const bool useTriangleStrips = m_UseTriangleStrips;
+		auto loadMesh = [=](const std::string& path, bool isTransparent, bool buildLODs)
+			{
+				return std::async(std::launch::async, [=]() mutable
+					{
+						//vertices, indices, translation, scale, rotation, textures
+						std::vector<Vertex_In> vertices{};
+						std::vector<uint32_t> indices{};
+						Utils::ParseOBJ(path, vertices, indices);
+						Mesh* pMesh = new Mesh(vertices, indices, translation, scale, yawRotation, {}, isTransparent);
+						if (buildLODs) {
+							MeshSimplifier::BuildLODs(*pMesh);
+						}
+						//Transparent meshes are always drawn as lists
+						if (useTriangleStrips && !isTransparent) {
+							Stripifier::StripifyMesh(*pMesh);
+						}
+						if (quantizeVertices) {
+							VertexQuantization::QuantizeMesh(*pMesh);
+						}
+						return pMesh;
+					}
+				);
+			};
+
 		//Vehicle
-		//vertices, indices, translation, scale, rotation, textures
-		std::vector<Vertex_In> vertices{};
-		std::vector<uint32_t> indices{};
-		Utils::ParseOBJ("Resources/vehicle.obj", vertices, indices);
-		//load needed textures
-		std::vector<Texture*> pTextures{};
-		Texture* pDiffuse = Texture::LoadFromFile("Resources/vehicle_diffuse.png");
-		Texture* pNormal = Texture::LoadFromFile("Resources/vehicle_normal.png");
-		Texture* pSpecular = Texture::LoadFromFile("Resources/vehicle_specular.png");
-		Texture* pGloss = Texture::LoadFromFile("Resources/vehicle_gloss.png");
-		pTextures.push_back(pDiffuse);
-		pTextures.push_back(pNormal);
-		pTextures.push_back(pSpecular);
-		pTextures.push_back(pGloss);
-
-		m_pMeshes.push_back(new Mesh(vertices, indices, translation, scale, yawRotation, pTextures));
+		//Coarser versions for the software renderer, used when the vehicle is far away
+		std::future<Mesh*> vehicleMesh = loadMesh("Resources/vehicle.obj", false, true);
+		std::future<TextureHandle> vehicleDiffuse = loadTexture("Resources/vehicle_diffuse.png");
+		std::future<TextureHandle> vehicleNormal = loadTexture("Resources/vehicle_normal.png");
+		std::future<TextureHandle> vehicleSpecular = loadTexture("Resources/vehicle_specular.png");
+		std::future<TextureHandle> vehicleGloss = loadTexture("Resources/vehicle_gloss.png");
 
 		//Fire
-		//vertices, indices, translation, scale, rotation, textures
-		std::vector<Vertex_In> fireVertices{};
-		std::vector<uint32_t> fireIndices{};
-		Utils::ParseOBJ("Resources/fireFX.obj", fireVertices, fireIndices);
+		//The fire is transparent, this decides which effect the hardware renderer uses for it
+		std::future<Mesh*> fireMesh = loadMesh("Resources/fireFX.obj", true, false);
+		std::future<TextureHandle> fireDiffuse = loadTexture("Resources/fireFX_diffuse.png");
 
-		//load needed textures
-		std::vector<Texture*> pFireTextures{};
-		Texture* pFireDiffuse = Texture::LoadFromFile("Resources/fireFX_diffuse.png");
-		pFireTextures.push_back(pFireDiffuse);
+		//Both renderers use every mesh, so wait for all of them, each one only on its own assets
+		Mesh* pVehicleMesh = vehicleMesh.get();
+		pVehicleMesh->pTextures = { vehicleDiffuse.get(), vehicleNormal.get(), vehicleSpecular.get(), vehicleGloss.get() };
+		m_pMeshes.push_back(pVehicleMesh);
 
-		m_pMeshes.push_back(new Mesh(fireVertices, fireIndices, translation, scale, yawRotation, pFireTextures));
+		Mesh* pFireMesh = fireMesh.get();
+		pFireMesh->pTextures = { fireDiffuse.get() };
+		m_pMeshes.push_back(pFireMesh);
 	}
 	void RenderManager::PrintInfo()
 	{
@@ -219,13 +314,13 @@ namespace dae {
 		std::cout << "[Key Bindings - SHARED]" << std::endl;
 		std::cout << "\t[F1] Toggle Rasterizer Mode (HARDWARE/SOFTWARE)" << std::endl;
 		std::cout << "\t[F2] Toggle Vehicle Rotation (ON/OFF)" << std::endl;
+		std::cout << "\t[F3] Toggle FireFX (ON / OFF)" << std::endl;
 		std::cout << "\t[F9] Cycle CullMode (BACK/FRONT/NONE)" << std::endl;
 		std::cout << "\t[F10] Toggle Uniform ClearColor (ON/OFF)" << std::endl;
 		std::cout << "\t[F11] Toggle Print FPS (ON/OFF)" << std::endl;
 		std::cout << std::endl;
 		std::cout << "\033[32m";
 		std::cout << "[Key Bindings - HARDWARE]" << std::endl;
-		std::cout << "\t[F3] Toggle FireFX (ON / OFF)" << std::endl;
 		std::cout << "\t[F4] Cycle Sampler State (POINT / LINEAR / ANISOTROPIC)" << std::endl;
 		std::cout << std::endl;
 		std::cout << "\033[35m";
@@ -234,10 +329,25 @@ namespace dae {
 		std::cout << "\t[F6] Toggle NormalMap (ON / OFF" << std::endl;
 		std::cout << "\t[F7] Toggle DepthBuffer Visualization (ON / OFF)" << std::endl;
 		std::cout << "\t[F8] Toggle BoundingBox Visualization (ON / OFF)" << std::endl;
+		std::cout << "\t[T] Toggle Temporal Shading Cache (ON / OFF)" << std::endl;
+		std::cout << "\t[Y] Toggle Shadows (ON / OFF)" << std::endl;
+		std::cout << "\t[U] Cycle Shadow Filter Size (1x1 / 3x3 / 5x5 / 7x7)" << std::endl;
 		std::cout << std::endl;
 		std::cout << "\033[36m";
 		std::cout << "[Extra Features]" << std::endl;
 		std::cout << "\tCPU multi-threaded (parallel_for)" << std::endl;
+		std::cout << "\tTiled light culling for point lights (software)" << std::endl;
+		std::cout << "\tMesh instancing, instances share vertices and textures" << std::endl;
+		std::cout << "\tQuadric simplified levels of detail, picked per instance (software)" << std::endl;
+		std::cout << "\tFireFX with weighted blended order independent transparency (software)" << std::endl;
+		std::cout << "\tTemporal reprojection of last frame's shading while the camera moves (software)" << std::endl;
+		std::cout << "\tCached shadow map with percentage closer filtering for the directional light (software)" << std::endl;
+		if (m_QuantizeVertices) {
+			std::cout << "\tQuantized vertices, 18 instead of 44 bytes, decoded in the vertex stage" << std::endl;
+		}
+		if (m_UseTriangleStrips) {
+			std::cout << "\tOpaque meshes drawn from a triangle strip per meshlet, built at load time (software)" << std::endl;
+		}
 		std::cout << "\033[0m"; // reset text color
 		std::cout << std::endl;
 	}
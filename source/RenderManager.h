@@ -3,6 +3,7 @@
 #include "Renderer_Software.h"
 #include "Renderer_Hardware.h"
 #include "Texture.h"
+#include "TextureManager.h"
 
 struct SDL_Window;
 struct SDL_Surface;
@@ -12,7 +13,9 @@ namespace dae
 	class RenderManager final
 	{
 	public:
-		RenderManager(SDL_Window* pWindow);
+		//Quantized vertices take less memory but lose some precision, see VertexQuantization
+		//Triangle strips make the software renderer read fewer indices, the tangents of welded corners are averaged, see Stripifier
+		RenderManager(SDL_Window* pWindow, bool quantizeVertices = false, bool useTriangleStrips = false);
 		~RenderManager();
 
 		RenderManager(const RenderManager&) = delete;
@@ -31,19 +34,34 @@ namespace dae
 		void ToggleNormalMap();
 		void ToggleDepthBuffer();
 		void ToggleBoundingBox();
+		void ToggleTemporalCache();
+		void ToggleShadows();
+		void CycleShadowFilterSize();
 		void TogglePrintFPW();
 		void ToggleClearColor();
 		void CycleCullMode();
 
 		bool CanPrintFPW();
+		//True when the current renderer had nothing new to draw, the loop can then wait for input
+		bool WasFrameSkipped() const;
+		//The window lost its contents, the next frame has to be drawn completely
+		void InvalidateFrame();
+		//Only the software renderer uses frame arenas and the temporal cache
+		void PrintFrameStatistics() const;
+
+		//For the frame stream and the telemetry, they read the image and the statistics of the software renderer
+		Renderer_Software* GetSoftwareRenderer() const;
 
 		enum class RenderType {
 			Software,
 			Hardware
 		};
+		RenderType GetRenderType() const;
 
 	private:
 		bool m_CanPrintFPW{ false };
+		bool m_QuantizeVertices{};
+		bool m_UseTriangleStrips{};
 
 		SDL_Window* m_pWindow{};
 		Renderer_Software* m_pRendererSoftware{};
@@ -51,6 +69,7 @@ namespace dae
 
 		Renderer* m_pCurrentRenderer{};
 		Camera* m_pCamera{};
+		TextureManager* m_pTextureManager{};
 
 		std::vector<Mesh*> m_pMeshes{};
 
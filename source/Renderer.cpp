@@ -2,6 +2,7 @@
 #include "Renderer.h"
 #include "DataTypes.h"
 
+#if !defined(DAE_SOFTWARE_ONLY)
 Renderer::Renderer(SDL_Window* pWindow, dae::Camera* pCamera, std::vector<Mesh*> pMeshes) :
 	m_pWindow{ pWindow },
 	m_pCamera{ pCamera },
@@ -12,6 +13,16 @@ Renderer::Renderer(SDL_Window* pWindow, dae::Camera* pCamera, std::vector<Mesh*>
 	m_AspectRatio = static_cast<float>(m_Width) / static_cast<float>(m_Height);
 	//Initialize Camera
 }
+#endif
+
+Renderer::Renderer(int width, int height, dae::Camera* pCamera, std::vector<Mesh*> pMeshes) :
+	m_Width{ width },
+	m_Height{ height },
+	m_pCamera{ pCamera },
+	m_pMeshes{ pMeshes }
+{
+	m_AspectRatio = static_cast<float>(m_Width) / static_cast<float>(m_Height);
+}
 
 void Renderer::ToggleRotation()
 {
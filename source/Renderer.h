@@ -13,7 +13,11 @@ class Camera;
 class Renderer
 {
 public:
+#if !defined(DAE_SOFTWARE_ONLY)
 	Renderer(SDL_Window* pWindow, dae::Camera* pCamera, std::vector<Mesh*> pMeshes);
+#endif
+	//Without a window, the image is only kept in memory
+	Renderer(int width, int height, dae::Camera* pCamera, std::vector<Mesh*> pMeshes);
 	virtual ~Renderer() = default;
 
 	//Rule of 5
@@ -37,6 +41,7 @@ public:
 	virtual void Render() = 0;
 
 protected:
+	//Null when rendering without a window
 	SDL_Window* m_pWindow{};
 		
 	int m_Width{};
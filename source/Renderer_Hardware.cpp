@@ -22,32 +22,34 @@ Renderer_Hardware::Renderer_Hardware(SDL_Window* pWindow, dae::Camera* pCamera,
 	{
 		std::cout << "DirectX initialization failed!\n";
 	}
-	//pMeshes should contain 2 meshes
-	// 1 is vehicle, 2 is the fire
 	//Initialize all the DirectX resources for the textures
 	for (auto mesh : m_pMeshes) {
-		for (auto texture : mesh->pTextures) {
+		for (const auto& texture : mesh->pTextures) {
 			texture->CreateDirectXResources(m_pDevice);
 		}
 	}
 
-	//Initialize Vehicle Effect
-	m_pEffectPosTex = new EffectPosTex(m_pDevice);
-	m_pEffectPosTex->Initialize();
-	m_pEffectPosTex->SetDiffuseMap(pMeshes[0]->pTextures[0]);
-	m_pEffectPosTex->SetNormalMap(pMeshes[0]->pTextures[1]);
-	m_pEffectPosTex->SetSpecularMap(pMeshes[0]->pTextures[2]);
-	m_pEffectPosTex->SetGlossinessMap(pMeshes[0]->pTextures[3]);
-	//Initialize Fire Effect
-	m_pEffectFire = new EffectPosTransp(m_pDevice);
-	m_pEffectFire->Initialize();
-	m_pEffectFire->SetDiffuseMap(pMeshes[1]->pTextures[0]);
-	
-	//Initialize meshes
-	Mesh_Hardware* pVehicle = new Mesh_Hardware(pMeshes[0], m_pDevice, m_pEffectPosTex);
-	Mesh_Hardware* pFire = new Mesh_Hardware(pMeshes[1], m_pDevice, m_pEffectFire);
-	m_pHardwareMeshes.push_back(pVehicle);
-	m_pHardwareMeshes.push_back(pFire);
+	//Initialize an effect and the buffers for every mesh, shared by all its instances
+	for (auto pMesh : m_pMeshes) {
+		Effect* pEffect{};
+		if (pMesh->isTransparent) {
+			//Fire Effect
+			pEffect = new EffectPosTransp(m_pDevice);
+			pEffect->Initialize();
+			pEffect->SetDiffuseMap(pMesh->pTextures[0].get());
+		}
+		else {
+			//Vehicle Effect
+			pEffect = new EffectPosTex(m_pDevice);
+			pEffect->Initialize();
+			pEffect->SetDiffuseMap(pMesh->pTextures[0].get());
+			pEffect->SetNormalMap(pMesh->pTextures[1].get());
+			pEffect->SetSpecularMap(pMesh->pTextures[2].get());
+			pEffect->SetGlossinessMap(pMesh->pTextures[3].get());
+		}
+		m_pEffects.push_back(pEffect);
+		m_pHardwareMeshes.push_back(new Mesh_Hardware(pMesh, m_pDevice, pEffect));
+	}
 }
 
 Renderer_Hardware::~Renderer_Hardware()
@@ -77,13 +79,9 @@ Renderer_Hardware::~Renderer_Hardware()
 	if (m_pDevice) {
 		m_pDevice->Release();
 	}
-	if (m_pEffectPosTex) {
-		delete m_pEffectPosTex;
-		m_pEffectPosTex = nullptr;
-	}
-	if (m_pEffectFire) {
-		delete m_pEffectFire;
-		m_pEffectFire = nullptr;
+	for (auto pEffect : m_pEffects) {
+		delete pEffect;
+		pEffect = nullptr;
 	}
 	for (auto pMesh : m_pHardwareMeshes) {
 		delete pMesh;
@@ -116,22 +114,28 @@ void Renderer_Hardware::Render()
 	m_pDeviceContext->ClearRenderTargetView(m_pRenderTargetView, &clearColor.r);
 	m_pDeviceContext->ClearDepthStencilView(m_pDepthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.f, 0);
 
+	//Instances outside the view frustum are not drawn
+	const dae::Frustum frustum = dae::Frustum::FromViewProjection(m_pCamera->viewMatrix * m_pCamera->projectionMatrix);
+
 	// Set Pipeline and Invoke DrawCalls (= RENDER)
-	for (int i{}; i < m_pHardwareMeshes.size(); ++i) {
-		Mesh_Hardware* pHardwareMesh = m_pHardwareMeshes[i];
+	for (const auto pHardwareMesh : m_pHardwareMeshes) {
 		Mesh* pMesh = pHardwareMesh->GetInternalMesh();
-		dae::Matrix worldMatrix = pMesh->worldMatrix;
-		dae::Matrix worldViewProjectionMatrix = worldMatrix * m_pCamera->viewMatrix * m_pCamera->projectionMatrix;
+		//Transparent meshes are the fire
+		if (pMesh->isTransparent && !m_CanRenderFire) {
+			continue;
+		}
 		pHardwareMesh->SetInvViewMatrix(m_pCamera->invViewMatrix);
-		pHardwareMesh->SetWorldMatrix(worldMatrix);
-		pHardwareMesh->SetWorldViewProjectionMatrix(worldViewProjectionMatrix);
-		//1 will always be the fire mesh
-		if (i == 1) {
-			if (!m_CanRenderFire) {
+		//The buffers are shared, only the matrices change per instance
+		for (const auto& instance : pMesh->instances) {
+			if (!frustum.IsVisible(instance.worldSphere) || !frustum.IsVisible(instance.worldBox)) {
 				continue;
 			}
+			dae::Matrix worldMatrix = instance.worldMatrix;
+			dae::Matrix worldViewProjectionMatrix = worldMatrix * m_pCamera->viewMatrix * m_pCamera->projectionMatrix;
+			pHardwareMesh->SetWorldMatrix(worldMatrix);
+			pHardwareMesh->SetWorldViewProjectionMatrix(worldViewProjectionMatrix);
+			pHardwareMesh->Render(m_pDeviceContext);
 		}
-		pHardwareMesh->Render(m_pDeviceContext);
 	}
 	// Update all the matrices
 
@@ -140,21 +144,15 @@ void Renderer_Hardware::Render()
 }
 
 void Renderer_Hardware::CycleSamplerState() {
-	if (m_pEffectPosTex) {
-		m_pEffectPosTex->CycleSamplerState();
-	}
-	if (m_pEffectFire) {
-		m_pEffectFire->CycleSamplerState();
+	for (auto pEffect : m_pEffects) {
+		pEffect->CycleSamplerState();
 	}
 }
 
 void Renderer_Hardware::CycleCullmode()
 {
-	if (m_pEffectPosTex) {
-		m_pEffectPosTex->CycleRasterizerState();
-	}
-	if (m_pEffectFire) {
-		m_pEffectFire->CycleRasterizerState();
+	for (auto pEffect : m_pEffects) {
+		pEffect->CycleRasterizerState();
 	}
 }
 
@@ -48,8 +48,8 @@ private:
 
 	//Camera and base meshes in base class
 
+	//One effect per mesh, m_pEffects[i] belongs to m_pHardwareMeshes[i]
 	std::vector<Mesh_Hardware*> m_pHardwareMeshes{};
-	EffectPosTex* m_pEffectPosTex{};
-	EffectPosTransp* m_pEffectFire{};
+	std::vector<Effect*> m_pEffects{};
 };
 #pragma once
@@ -7,40 +7,102 @@
 #include "Utils.h"
 #include "Timer.h"
 #include <iostream>
-#include <ppl.h> //parallel_for
+#include "Parallel.h"
+#include "VertexQuantization.h"
+#include <chrono>
 
 using namespace dae;
 
+#if !defined(DAE_SOFTWARE_ONLY)
 Renderer_Software::Renderer_Software(SDL_Window* pWindow, dae::Camera* pCamera, std::vector<Mesh*>& pMeshes) :
 	Renderer(pWindow, pCamera, pMeshes)
+{
+	m_pFrontBuffer = SDL_GetWindowSurface(pWindow);
+	Initialize(pMeshes);
+}
+#endif
+
+Renderer_Software::Renderer_Software(int width, int height, dae::Camera* pCamera, std::vector<Mesh*>& pMeshes) :
+	Renderer(width, height, pCamera, pMeshes)
+{
+	Initialize(pMeshes);
+}
+
+void Renderer_Software::Initialize(const std::vector<Mesh*>& pMeshes)
 {
 	m_RendererColor = ColorRGB{ 0.39f, 0.39f, 0.39f}*255.f;
 	m_UniformColor = ColorRGB{ 0.1f, 0.1f, 0.1f} * 255.f;
 	
-	//Create Buffers
-	m_pFrontBuffer = SDL_GetWindowSurface(pWindow);
-	m_pBackBuffer = SDL_CreateRGBSurface(0, m_Width, m_Height, 32, 0, 0, 0, 0);
-	m_pBackBufferPixels = (uint32_t*)m_pBackBuffer->pixels;
+	//Create Buffers, the back buffer is plain memory so it can be rendered without SDL
+	m_pBackBufferPixels = new uint32_t[m_Width * m_Height]{};
+#if !defined(DAE_SOFTWARE_ONLY)
+	m_pBackBuffer = SDL_CreateRGBSurfaceFrom(m_pBackBufferPixels, m_Width, m_Height, 32, m_Width * static_cast<int>(sizeof(uint32_t)),
+		0x00FF0000, 0x0000FF00, 0x000000FF, 0);
+#endif
 
 	m_pDepthBufferPixels = new float[m_Width * m_Height];
+	m_pGBufferPixels = new GBufferPixel[m_Width * m_Height];
+
+	m_pLightCuller = new LightCuller(m_Width, m_Height);
+	//Grows to the high water mark in the first frames, after that rendering doesn't allocate
+	m_pFrameAllocator = new FrameAllocator(4 * 1024 * 1024, 64 * 1024);
+	m_pWorldSpaceCache = std::make_shared<WorldSpaceCache>();
 
 	//Initialize Lights
 	m_pLights.push_back(new Light({0, 0, 0}, { 0.577f, -0.577f, 0.557f }, colors::White, 7.0f, LightType::Directional));
 
 	//Initialize Meshes
-	//Only vehicle is needed, this is the first mesh
-	Mesh_Software* pVehicleMesh = new Mesh_Software(pMeshes[0], PrimitiveTopology::TriangleList);
-	m_pSoftwareMeshes.push_back(pVehicleMesh);
+	for (const auto pMesh : pMeshes) {
+		if (pMesh->isTransparent) {
+			m_pTransparentMeshes.push_back(new Mesh_Software(pMesh, PrimitiveTopology::TriangleList));
+			continue;
+		}
+		//Meshes with strip indices are drawn from those, see Stripifier
+		const PrimitiveTopology topology = pMesh->stripIndices.IsEmpty() ? PrimitiveTopology::TriangleList : PrimitiveTopology::TriangleStrip;
+		m_pSoftwareMeshes.push_back(new Mesh_Software(pMesh, topology));
+	}
+
+	const int amountOfTiles = m_pLightCuller->GetAmountOfTilesX() * m_pLightCuller->GetAmountOfTilesY();
+	m_TileTriangleOffsets.resize(amountOfTiles);
+	m_TileTriangleCounts.resize(amountOfTiles);
 }
 
 Renderer_Software::~Renderer_Software()
 {
+#if !defined(DAE_SOFTWARE_ONLY)
+	SDL_FreeSurface(m_pBackBuffer);
+	m_pBackBuffer = nullptr;
+#endif
+	delete[] m_pBackBufferPixels;
+	m_pBackBufferPixels = nullptr;
+
 	delete[] m_pDepthBufferPixels;
 	m_pDepthBufferPixels = nullptr;
 
+	delete[] m_pGBufferPixels;
+	m_pGBufferPixels = nullptr;
+
+	delete m_pLightCuller;
+	m_pLightCuller = nullptr;
+
+	delete m_pFrameAllocator;
+	m_pFrameAllocator = nullptr;
+
+	delete[] m_pHistoryGBufferPixels;
+	m_pHistoryGBufferPixels = nullptr;
+
+	for (auto& pHistoryPixels : m_pHistoryPixels) {
+		delete[] pHistoryPixels;
+		pHistoryPixels = nullptr;
+	}
+
 	//delete meshes and lights
 	for (auto pMesh : m_pSoftwareMeshes) {
-		//Mesh textures are deleted in the mesh itself
+		//Mesh textures are owned by the meshes that use them
+		delete pMesh;
+		pMesh = nullptr;
+	}
+	for (auto pMesh : m_pTransparentMeshes) {
 		delete pMesh;
 		pMesh = nullptr;
 	}
@@ -62,17 +124,83 @@ void Renderer_Software::Update(const dae::Timer* pTimer)
 
 void Renderer_Software::Render()
 {
-	//@START
-	//Lock BackBuffer
-	SDL_LockSurface(m_pBackBuffer);
+	const auto frameStart = std::chrono::steady_clock::now();
+	const uint64_t busyTimeStart = GetParallelBusyTime();
+	m_FrameStatistics = FrameStatistics{ m_FrameStatistics.frameIndex + 1 };
+
+	//The window still shows the last frame when nothing changed
+	const FrameChange frameChange = DetectChanges();
+	m_WasFrameSkipped = frameChange == FrameChange::None;
+	if (m_WasFrameSkipped) {
+		m_FrameStatistics.wasFrameSkipped = 1;
+		EndFrameStatistics(frameStart, busyTimeStart);
+		return;
+	}
+
+	PrepareHistory(frameChange);
 
+	//@START
 	Render_Meshes();
 
+	//The history written this frame is read in the next one
+	if (m_ShouldWriteHistory) {
+		std::swap(m_pGBufferPixels, m_pHistoryGBufferPixels);
+		m_HistoryWriteIndex ^= 1;
+		m_HistoryViewProjectionMatrix = m_pCamera->viewMatrix * m_pCamera->projectionMatrix;
+	}
+
 	//@END
-	//Update SDL Surface
-	SDL_UnlockSurface(m_pBackBuffer);
-	SDL_BlitSurface(m_pBackBuffer, 0, m_pFrontBuffer, 0);
-	SDL_UpdateWindowSurface(m_pWindow);
+#if !defined(DAE_SOFTWARE_ONLY)
+	//Update SDL Surface, only the part that was redrawn
+	if (m_pWindow) {
+		SDL_Rect dirtyRect{ m_DirtyMin.x, m_DirtyMin.y, m_DirtyMax.x - m_DirtyMin.x, m_DirtyMax.y - m_DirtyMin.y };
+		SDL_BlitSurface(m_pBackBuffer, &dirtyRect, m_pFrontBuffer, &dirtyRect);
+		SDL_UpdateWindowSurfaceRects(m_pWindow, &dirtyRect, 1);
+	}
+#endif
+	m_FrameStatistics.amountOfShadedPixels = m_ShadedPixels.load();
+	m_FrameStatistics.amountOfReusedPixels = m_ReusedPixels.load();
+	EndFrameStatistics(frameStart, busyTimeStart);
+}
+
+const FrameStatistics& Renderer_Software::GetFrameStatistics() const
+{
+	return m_FrameStatistics;
+}
+
+void Renderer_Software::EndFrameStatistics(std::chrono::steady_clock::time_point frameStart, uint64_t busyTimeStart)
+{
+	const std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - frameStart;
+	m_FrameStatistics.frameTimeMs = elapsed.count();
+	m_FrameStatistics.amountOfThreads = GetAmountOfParallelThreads();
+	if (m_FrameStatistics.amountOfThreads > 0 && m_FrameStatistics.frameTimeMs > 0.f) {
+		const float busyTimeMs = static_cast<float>(GetParallelBusyTime() - busyTimeStart) / 1'000'000.f;
+		m_FrameStatistics.threadUtilization = busyTimeMs / (m_FrameStatistics.frameTimeMs * static_cast<float>(m_FrameStatistics.amountOfThreads));
+	}
+}
+
+bool Renderer_Software::WasFrameSkipped() const
+{
+	return m_WasFrameSkipped;
+}
+
+void Renderer_Software::InvalidateFrame()
+{
+	m_IsFrameValid = false;
+}
+
+void Renderer_Software::SetRenderStates(const RenderStates& states)
+{
+	m_CurrentShadingMode = states.shadingMode;
+	m_CurrentCullmode = states.cullmode;
+	m_RenderDepthBuffer = states.renderDepthBuffer;
+	m_CanUseNormalMap = states.useNormalMap;
+	m_CanRenderBoundingBox = states.renderBoundingBox;
+	m_CanRenderFire = states.renderFire;
+	m_ShouldUseUniformColor = states.useUniformClearColor;
+	m_RenderShadows = states.renderShadows;
+	//Filters are centered on the texel, so only odd sizes work
+	m_ShadowFilterSize = Clamp(states.shadowFilterSize | 1, 1, MaxShadowFilterSize);
 }
 
 void Renderer_Software::ToggleDepthBuffer()
@@ -90,175 +218,610 @@ void Renderer_Software::ToggleNormalMap()
 	m_CanUseNormalMap = !m_CanUseNormalMap;
 }
 
-bool Renderer_Software::SaveBufferToImage() const
+void Renderer_Software::ToggleShadows()
 {
-	return SDL_SaveBMP(m_pBackBuffer, "Rasterizer_ColorBuffer.bmp");
+	m_RenderShadows = !m_RenderShadows;
+}
+
+void Renderer_Software::CycleShadowFilterSize()
+{
+	m_ShadowFilterSize += 2;
+	if (m_ShadowFilterSize > MaxShadowFilterSize) {
+		m_ShadowFilterSize = 1;
+	}
+}
+
+void Renderer_Software::PrintFrameMemory() const
+{
+	std::cout << "Frame memory high water mark: shared " << m_pFrameAllocator->GetSharedHighWaterMark() / 1024 << " KB, "
+		<< m_pFrameAllocator->GetAmountOfThreadArenas() << " worker threads " << m_pFrameAllocator->GetThreadHighWaterMark() / 1024 << " KB" << std::endl;
+}
+
+void Renderer_Software::ToggleTemporalCache()
+{
+	m_UseTemporalCache = !m_UseTemporalCache;
+	m_IsHistoryValid = false;
+	if (m_UseTemporalCache && !m_pHistoryGBufferPixels) {
+		m_pHistoryGBufferPixels = new GBufferPixel[m_Width * m_Height];
+		m_pHistoryPixels[0] = new HistoryPixel[m_Width * m_Height];
+		m_pHistoryPixels[1] = new HistoryPixel[m_Width * m_Height];
+	}
+}
+
+bool Renderer_Software::IsTemporalCacheEnabled() const
+{
+	return m_UseTemporalCache;
+}
+
+void Renderer_Software::PrintTemporalCacheStatistics() const
+{
+	if (!m_UseTemporalCache) {
+		return;
+	}
+	const uint32_t reusedPixels = m_ReusedPixels.load();
+	const uint32_t amountOfPixels = reusedPixels + m_ShadedPixels.load();
+	std::cout << "Temporal cache: reused " << reusedPixels << " of " << amountOfPixels << " shaded pixels" << std::endl;
+}
+
+void Renderer_Software::ToggleFire()
+{
+	m_CanRenderFire = !m_CanRenderFire;
+}
+
+bool Renderer_Software::CanRenderFire()
+{
+	return m_CanRenderFire;
+}
+
+void Renderer_Software::SetWorldSpaceCache(const std::shared_ptr<WorldSpaceCache>& pWorldSpaceCache)
+{
+	m_pWorldSpaceCache = pWorldSpaceCache;
+}
+
+void Renderer_Software::SetShadowMap(const std::shared_ptr<ShadowMap>& pShadowMap)
+{
+	m_pShadowMap = pShadowMap;
+}
+
+void Renderer_Software::AddPointLight(const Vector3& origin, const ColorRGB& color, float intensity, float range)
+{
+	m_pLights.push_back(new Light(origin, Vector3::Zero, color, intensity, LightType::Point, range));
+}
+
+#if !defined(DAE_SOFTWARE_ONLY)
+bool Renderer_Software::SaveBufferToImage(const std::string& path) const
+{
+	return SDL_SaveBMP(m_pBackBuffer, path.c_str());
+}
+
+const SDL_Surface* Renderer_Software::GetBackBuffer() const
+{
+	return m_pBackBuffer;
+}
+#endif
+
+const uint32_t* Renderer_Software::GetPixels() const
+{
+	return m_pBackBufferPixels;
+}
+
+int Renderer_Software::GetWidth() const
+{
+	return m_Width;
+}
+
+int Renderer_Software::GetHeight() const
+{
+	return m_Height;
+}
+
+uint32_t Renderer_Software::PackColor(uint8_t r, uint8_t g, uint8_t b)
+{
+	return 0xFF000000 | static_cast<uint32_t>(r) << 16 | static_cast<uint32_t>(g) << 8 | static_cast<uint32_t>(b);
+}
+
+void Renderer_Software::UnpackColor(uint32_t color, uint8_t& r, uint8_t& g, uint8_t& b)
+{
+	r = static_cast<uint8_t>(color >> 16);
+	g = static_cast<uint8_t>(color >> 8);
+	b = static_cast<uint8_t>(color);
 }
 
 void Renderer_Software::Render_Meshes() {
-	//Clear depth buffer and back buffer
-	std::fill_n(m_pDepthBufferPixels, m_Width * m_Height, FLT_MAX);
+	//Every stage ends where the next one starts
+	auto stageStart = std::chrono::steady_clock::now();
+	auto endStage = [&stageStart](float& stageMs)
+		{
+			const auto now = std::chrono::steady_clock::now();
+			stageMs = std::chrono::duration<float, std::milli>(now - stageStart).count();
+			stageStart = now;
+		};
+
+	//Clear depth buffer, GBuffer and back buffer, outside the dirty region they still hold the last frame
+	const int dirtyWidth = m_DirtyMax.x - m_DirtyMin.x;
+	for (int py{ m_DirtyMin.y }; py < m_DirtyMax.y; ++py) {
+		std::fill_n(m_pDepthBufferPixels + m_DirtyMin.x + (py * m_Width), dirtyWidth, FLT_MAX);
+		std::fill_n(m_pGBufferPixels + m_DirtyMin.x + (py * m_Width), dirtyWidth, GBufferPixel{});
+	}
 
 	ColorRGB clearColor = m_RendererColor;
 	if (m_ShouldUseUniformColor) {
 		clearColor = m_UniformColor;
 	}
-	//SDL_MapRGB
-	Uint32 clearColorUint = 0xFF000000 | (Uint32)clearColor.r | (Uint32)clearColor.g << 8 | (Uint32)clearColor.b << 16;
-	SDL_FillRect(m_pBackBuffer, NULL, clearColorUint);
+	const uint32_t clearColorUint = PackColor(static_cast<uint8_t>(clearColor.r), static_cast<uint8_t>(clearColor.g), static_cast<uint8_t>(clearColor.b));
+	for (int py{ m_DirtyMin.y }; py < m_DirtyMax.y; ++py) {
+		std::fill_n(m_pBackBufferPixels + m_DirtyMin.x + (py * m_Width), dirtyWidth, clearColorUint);
+	}
 
+	//Pick the specialized kernels for the current render states once for the whole frame
+	SelectKernels();
+	m_ScreenTarget = RasterTarget{ m_pDepthBufferPixels, m_Width, m_DirtyMin, m_DirtyMax };
+	endStage(m_FrameStatistics.clearMs);
+
+	//Instances outside the view frustum skip the vertex transform and rasterization
+	CullInstances(m_pSoftwareMeshes);
 	//Vertices in NDC space
 	MeshVertexTransformationFunction(m_pSoftwareMeshes);
+	//Off screen and back facing clusters of triangles are skipped as a whole
+	CullMeshlets(m_pSoftwareMeshes);
+	endStage(m_FrameStatistics.geometryMs);
 	//go over all the meshes
 	for (const auto pSoftwareMesh : m_pSoftwareMeshes) {
 		Mesh* pMesh = pSoftwareMesh->internalMesh;
-		if (pSoftwareMesh->primitiveTopology == PrimitiveTopology::TriangleList) {
-			int size = static_cast<int>(pMesh->indices.size());
-			uint32_t amountOfTriangles = size / 3;
+		//Every visible instance has its own range in vertices_out
+		const uint32_t amountOfInstances = static_cast<uint32_t>(pSoftwareMesh->visibleInstances.size());
+		m_FrameStatistics.amountOfVisibleInstances += amountOfInstances;
+		//Every meshlet that survived the cluster culling is one work unit
+		const uint32_t amountOfMeshlets = static_cast<uint32_t>(pSoftwareMesh->visibleMeshlets.size());
+		m_FrameStatistics.amountOfVisibleMeshlets += amountOfMeshlets;
+		for (const VisibleMeshlet& visibleMeshlet : pSoftwareMesh->visibleMeshlets) {
+			const uint32_t lod = pSoftwareMesh->visibleInstances[visibleMeshlet.instanceSlot].lod;
+			m_FrameStatistics.amountOfTriangles += pMesh->GetMeshlets(lod)[visibleMeshlet.meshletIndex].amountOfTriangles;
+		}
+		const bool isStrip = pSoftwareMesh->primitiveTopology == PrimitiveTopology::TriangleStrip;
+		ParallelFor(0u, amountOfMeshlets, [=, this](uint32_t visibleMeshletIndex)
+			{
+				const VisibleMeshlet& visibleMeshlet = pSoftwareMesh->visibleMeshlets[visibleMeshletIndex];
+				const VisibleInstance& visibleInstance = pSoftwareMesh->visibleInstances[visibleMeshlet.instanceSlot];
+				const Meshlet& meshlet = pMesh->GetMeshlets(visibleInstance.lod)[visibleMeshlet.meshletIndex];
+				const Vertex_Out* pInstanceVertices = pSoftwareMesh->vertices_out.data() + visibleInstance.firstVertex;
+				if (isStrip) {
+					//Compiled for 16 and 32 bit indices
+					pMesh->GetStripIndices(visibleInstance.lod).Visit([&](const auto* pMeshIndices)
+						{
+							const auto* pIndices = pMeshIndices + meshlet.firstStripIndex;
+
+							//Triangle i of the strip uses the indices i, i + 1 and i + 2
+							for (uint32_t i{}; i + 2 < meshlet.amountOfStripIndices; ++i) {
+								const uint32_t index1 = pIndices[i];
+								uint32_t index2 = pIndices[i + 1];
+								uint32_t index3 = pIndices[i + 2];
+								//Repeated indices join two strips, those triangles have no area
+								if (index1 == index2 || index1 == index3 || index2 == index3) {
+									continue;
+								}
+								//if uneven, switch the last two vertices so every triangle has the same winding
+								if (i % 2 == 1) {
+									std::swap(index2, index3);
+								}
+								RenderNDCTriangle(pInstanceVertices[index1], pInstanceVertices[index2], pInstanceVertices[index3], pSoftwareMesh);
+							}
+						}
+					);
+					return;
+				}
 
-			//go over all triangles
-			concurrency::parallel_for(0u, amountOfTriangles, [=, this](int i) 
-				{
-			Vertex_Out vertex1{ pSoftwareMesh->vertices_out[pMesh->indices[3 * i]] };
-			Vertex_Out vertex2{ pSoftwareMesh->vertices_out[pMesh->indices[3 * i + 1]] };
-			Vertex_Out vertex3{ pSoftwareMesh->vertices_out[pMesh->indices[3 * i + 2]] };
-
-			//Frustrum culling for x and y
-			if (vertex1.position.x < -1 || vertex1.position.x > 1 ||
-				vertex1.position.y < -1 || vertex1.position.y > 1) {
-				return;
-			}
-			if (vertex2.position.x < -1 || vertex2.position.x > 1 ||
-				vertex2.position.y < -1 || vertex2.position.y > 1) {
-				return;
-			}
-			if (vertex3.position.x < -1 || vertex3.position.x > 1 ||
-				vertex3.position.y < -1 || vertex3.position.y > 1) {
-				return;
+				//Compiled for 16 and 32 bit indices
+				pMesh->GetIndices(visibleInstance.lod).Visit([&](const auto* pMeshIndices)
+					{
+						const auto* pIndices = pMeshIndices + meshlet.firstIndex;
+
+						//go over all triangles of the meshlet
+						for (uint32_t i{}; i < meshlet.amountOfTriangles; ++i) {
+							RenderNDCTriangle(pInstanceVertices[pIndices[3 * i]], pInstanceVertices[pIndices[3 * i + 1]], pInstanceVertices[pIndices[3 * i + 2]], pSoftwareMesh);
+						}
+					}
+				);
 			}
+		);
+	}
 
-			//Vertices from NDC space to raster space
-			vertex1.position.x = (vertex1.position.x + 1) / 2.f * static_cast<float>(m_Width);
-			vertex1.position.y = (1 - vertex1.position.y) / 2.f * static_cast<float>(m_Height);
+	endStage(m_FrameStatistics.rasterMs);
 
-			vertex2.position.x = (vertex2.position.x + 1) / 2.f * static_cast<float>(m_Width);
-			vertex2.position.y = (1 - vertex2.position.y) / 2.f * static_cast<float>(m_Height);
+	//Casters that aren't on screen still cast shadows on screen, so every instance is drawn in the shadow map
+	UpdateShadowMap();
+	endStage(m_FrameStatistics.shadowMs);
 
-			vertex3.position.x = (vertex3.position.x + 1) / 2.f * static_cast<float>(m_Width);
-			vertex3.position.y = (1 - vertex3.position.y) / 2.f * static_cast<float>(m_Height);
+	//Only the visible pixels get shaded, with the lights that reach their tile
+	m_pLightCuller->Cull(m_pLights, m_pCamera, m_pGBufferPixels, m_pFrameAllocator->GetSharedArena());
+	endStage(m_FrameStatistics.lightCullMs);
+	ShadePixels();
+	endStage(m_FrameStatistics.shadeMs);
 
-			RenderTriangle(vertex1, vertex2, vertex3, pSoftwareMesh);
-				}
-			);
+	//The depth and bounding box visualizations only show the opaque meshes
+	if (m_CanRenderFire && !m_RenderDepthBuffer && !m_CanRenderBoundingBox) {
+		RenderTransparentMeshes();
+	}
+	endStage(m_FrameStatistics.transparentMs);
+
+	//Everything that was allocated for this frame is released at once
+	m_pFrameAllocator->Reset();
+}
+
+void Renderer_Software::RenderNDCTriangle(Vertex_Out vertex1, Vertex_Out vertex2, Vertex_Out vertex3, Mesh_Software* pSoftwareMesh)
+{
+	//Frustrum culling for x and y
+	if (vertex1.position.x < -1 || vertex1.position.x > 1 ||
+		vertex1.position.y < -1 || vertex1.position.y > 1) {
+		return;
+	}
+	if (vertex2.position.x < -1 || vertex2.position.x > 1 ||
+		vertex2.position.y < -1 || vertex2.position.y > 1) {
+		return;
+	}
+	if (vertex3.position.x < -1 || vertex3.position.x > 1 ||
+		vertex3.position.y < -1 || vertex3.position.y > 1) {
+		return;
+	}
+
+	//Vertices from NDC space to raster space
+	vertex1.position.x = (vertex1.position.x + 1) / 2.f * static_cast<float>(m_Width);
+	vertex1.position.y = (1 - vertex1.position.y) / 2.f * static_cast<float>(m_Height);
+
+	vertex2.position.x = (vertex2.position.x + 1) / 2.f * static_cast<float>(m_Width);
+	vertex2.position.y = (1 - vertex2.position.y) / 2.f * static_cast<float>(m_Height);
+
+	vertex3.position.x = (vertex3.position.x + 1) / 2.f * static_cast<float>(m_Width);
+	vertex3.position.y = (1 - vertex3.position.y) / 2.f * static_cast<float>(m_Height);
+
+	(this->*m_pRenderTriangle)(m_ScreenTarget, vertex1, vertex2, vertex3, pSoftwareMesh);
+}
+
+void Renderer_Software::UpdateShadowMap()
+{
+	m_pShadowLight = nullptr;
+	if (!m_RenderShadows || m_RenderDepthBuffer || m_CanRenderBoundingBox) {
+		return;
+	}
+
+	const auto shadowLightIt = std::find_if(m_pLights.begin(), m_pLights.end(), [](const Light* pLight)
+		{
+			return pLight->type == LightType::Directional;
+		});
+	if (shadowLightIt == m_pLights.end()) {
+		return;
+	}
+
+	if (!m_pShadowMap) {
+		m_pShadowMap = std::make_shared<ShadowMap>(ShadowMapResolution);
+	}
+	//Both windings are drawn, the light sees the back faces of the casters as well
+	m_pShadowMap->Update(*shadowLightIt, m_pSoftwareMeshes, *m_pWorldSpaceCache, [this](const RasterTarget& target, const Vertex_Out* pVertices, const uint32_t* pTriangles, size_t amountOfTriangles)
+		{
+			for (size_t i{}; i < amountOfTriangles; ++i) {
+				const uint32_t* pTriangle = pTriangles + 3 * i;
+				RenderTriangle<false, Cullmode::none, true>(target, pVertices[pTriangle[0]], pVertices[pTriangle[1]], pVertices[pTriangle[2]], nullptr);
+			}
 		}
-		if (pSoftwareMesh->primitiveTopology == PrimitiveTopology::TriangleStrip) {
-			//go over all the indices one by one, every pair of 3 will be a triangle
-			for (int i{}; i <= pMesh->indices.size() - 3; ++i) {
-				Vertex_Out vertex1{ pSoftwareMesh->vertices_out[pMesh->indices[i]] };
-				Vertex_Out vertex2{ pSoftwareMesh->vertices_out[pMesh->indices[i + 1]] };
-				Vertex_Out vertex3{ pSoftwareMesh->vertices_out[pMesh->indices[i + 2]] };
-				//if uneven, switch the last two vertices
-				if (i % 2 == 1) {
-					Vertex_Out tempVertex{ vertex2 };
-					vertex2 = vertex3;
-					vertex3 = tempVertex;
-				}
-				//if two of the vertices are the same continue, because those are not Triangles (no area)
-				if (vertex1 == vertex2 || vertex1 == vertex3 || vertex2 == vertex3) {
-					continue;
-				}
+	);
+	m_pShadowLight = *shadowLightIt;
+}
 
-				//Frustrum culling for x and y
-				if (vertex1.position.x < -1 || vertex1.position.x > 1 ||
-					vertex1.position.y < -1 || vertex1.position.y > 1) {
-					continue;
-				}
-				if (vertex2.position.x < -1 || vertex2.position.x > 1 ||
-					vertex2.position.y < -1 || vertex2.position.y > 1) {
+Renderer_Software::FrameChange Renderer_Software::DetectChanges()
+{
+	const uint64_t stateHash = CalculateStateHash();
+	bool isFullRedraw = !m_IsFrameValid || stateHash != m_RenderedStateHash;
+	m_RenderedStateHash = stateHash;
+	m_IsFrameValid = true;
+
+	//Both the place an instance was drawn at and its new place need a redraw
+	Int2 dirtyMin{ m_Width, m_Height };
+	Int2 dirtyMax{ 0, 0 };
+	bool hasMovedInstances{};
+	bool hasMovedCasters{};
+	for (const auto& pSoftwareMeshes : { &m_pSoftwareMeshes, &m_pTransparentMeshes }) {
+		//Only the opaque meshes cast shadows
+		const bool areCasters = pSoftwareMeshes == &m_pSoftwareMeshes;
+		for (const auto pSoftwareMesh : *pSoftwareMeshes) {
+			const Mesh* pMesh = pSoftwareMesh->internalMesh;
+			std::vector<RenderedInstanceState>& renderedInstances = pSoftwareMesh->renderedInstances;
+			//Instances were added, the hash already asks for a full redraw
+			renderedInstances.resize(pMesh->instances.size());
+
+			for (size_t instanceIndex{}; instanceIndex < pMesh->instances.size(); ++instanceIndex) {
+				const MeshInstance& instance = pMesh->instances[instanceIndex];
+				RenderedInstanceState& renderedInstance = renderedInstances[instanceIndex];
+				if (renderedInstance.worldVersion == instance.worldVersion) {
 					continue;
 				}
-				if (vertex3.position.x < -1 || vertex3.position.x > 1 ||
-					vertex3.position.y < -1 || vertex3.position.y > 1) {
-					continue;
+
+				hasMovedInstances = true;
+				hasMovedCasters |= areCasters;
+				if (!isFullRedraw) {
+					isFullRedraw = !AddScreenRect(renderedInstance.worldBox, dirtyMin, dirtyMax) ||
+						!AddScreenRect(instance.worldBox, dirtyMin, dirtyMax);
 				}
+				renderedInstance.worldVersion = instance.worldVersion;
+				renderedInstance.worldBox = instance.worldBox;
+			}
+		}
+	}
 
-				//Vertices from NDC space to raster space
-				vertex1.position.x = (vertex1.position.x + 1) / 2.f * static_cast<float>(m_Width);
-				vertex1.position.y = (1 - vertex1.position.y) / 2.f * static_cast<float>(m_Height);
+	m_HaveInstancesMoved = hasMovedInstances;
+	//The shadow of a caster can fall anywhere on screen, far outside of the area of the caster itself
+	if (m_RenderShadows && hasMovedCasters) {
+		isFullRedraw = true;
+	}
+	if (isFullRedraw) {
+		SetDirtyRegion({ 0, 0 }, { m_Width, m_Height });
+		return FrameChange::Full;
+	}
+	//Instances that moved outside of the screen don't need a redraw either
+	if (!hasMovedInstances || !SetDirtyRegion(dirtyMin, dirtyMax)) {
+		return FrameChange::None;
+	}
+	return FrameChange::Partial;
+}
 
-				vertex2.position.x = (vertex2.position.x + 1) / 2.f * static_cast<float>(m_Width);
-				vertex2.position.y = (1 - vertex2.position.y) / 2.f * static_cast<float>(m_Height);
+uint64_t Renderer_Software::CalculateStateHash(bool includeCamera) const
+{
+	//FNV-1a
+	uint64_t hash{ 14695981039346656037ull };
+	auto addBytes = [&hash](const void* pData, size_t size)
+		{
+			const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+			for (size_t i{}; i < size; ++i) {
+				hash ^= pBytes[i];
+				hash *= 1099511628211ull;
+			}
+		};
+	auto add = [&addBytes](const auto& value)
+		{
+			addBytes(&value, sizeof(value));
+		};
+
+	if (includeCamera) {
+		add(m_pCamera->viewMatrix);
+		add(m_pCamera->projectionMatrix);
+		add(m_pCamera->origin);
+	}
+
+	for (const Light* pLight : m_pLights) {
+		add(pLight->origin);
+		add(pLight->direction);
+		add(pLight->color);
+		add(pLight->intensity);
+		add(pLight->range);
+		add(pLight->type);
+	}
+	add(m_pLights.size());
+
+	for (const auto& pSoftwareMeshes : { &m_pSoftwareMeshes, &m_pTransparentMeshes }) {
+		for (const auto pSoftwareMesh : *pSoftwareMeshes) {
+			add(pSoftwareMesh->internalMesh->instances.size());
+		}
+	}
+
+	add(m_RendererColor);
+	add(m_UniformColor);
+	add(m_ShouldUseUniformColor);
+	add(m_CurrentCullmode);
+	add(m_RenderDepthBuffer);
+	add(m_CanUseNormalMap);
+	add(m_CanRenderBoundingBox);
+	add(m_CanRenderFire);
+	add(m_CurrentShadingMode);
+	add(m_ShadingPrecision);
+	add(m_RenderShadows);
+	add(m_ShadowFilterSize);
+	return hash;
+}
+
+void Renderer_Software::PrepareHistory(FrameChange frameChange)
+{
+	m_ReusedPixels = 0;
+	m_ShadedPixels = 0;
+
+	//Partial redraws only shade the dirty tiles, the rest of the history would be missing
+	m_ShouldWriteHistory = m_UseTemporalCache && frameChange == FrameChange::Full;
+	if (!m_ShouldWriteHistory) {
+		m_CanReuseHistory = false;
+		m_IsHistoryValid = false;
+		return;
+	}
 
-				vertex3.position.x = (vertex3.position.x + 1) / 2.f * static_cast<float>(m_Width);
-				vertex3.position.y = (1 - vertex3.position.y) / 2.f * static_cast<float>(m_Height);
+	//Reprojection assumes the surfaces stayed in place, only the camera may have moved
+	const uint64_t stateHash = CalculateStateHash(false);
+	m_CanReuseHistory = m_IsHistoryValid && !m_HaveInstancesMoved && stateHash == m_HistoryStateHash;
+	m_HistoryStateHash = stateHash;
+	m_IsHistoryValid = true;
+	++m_TemporalFrameIndex;
+}
+
+bool Renderer_Software::AddScreenRect(const AABB& box, Int2& min, Int2& max) const
+{
+	const Matrix viewProjectionMatrix = m_pCamera->viewMatrix * m_pCamera->projectionMatrix;
+	for (int corner{}; corner < 8; ++corner) {
+		const Vector4 worldCorner{
+			(corner & 1) ? box.max.x : box.min.x,
+			(corner & 2) ? box.max.y : box.min.y,
+			(corner & 4) ? box.max.z : box.min.z,
+			1.f };
+		const Vector4 projectedCorner = viewProjectionMatrix.TransformPoint(worldCorner);
+		//Corners behind the near plane can't be projected
+		if (projectedCorner.w < m_pCamera->nearPlane) {
+			return false;
+		}
+
+		//NDC to raster space, one pixel of margin for the rounding of the rasterizer
+		const float rasterX = (projectedCorner.x / projectedCorner.w + 1) / 2.f * static_cast<float>(m_Width);
+		const float rasterY = (1 - projectedCorner.y / projectedCorner.w) / 2.f * static_cast<float>(m_Height);
+		min.x = std::min(min.x, static_cast<int>(std::floor(rasterX)) - 1);
+		min.y = std::min(min.y, static_cast<int>(std::floor(rasterY)) - 1);
+		max.x = std::max(max.x, static_cast<int>(std::ceil(rasterX)) + 1);
+		max.y = std::max(max.y, static_cast<int>(std::ceil(rasterY)) + 1);
+	}
+	return true;
+}
 
-				RenderTriangle(vertex1, vertex2, vertex3, pSoftwareMesh);
+bool Renderer_Software::SetDirtyRegion(const Int2& min, const Int2& max)
+{
+	constexpr int TileSize{ LightCuller::TileSize };
+	const int amountOfTilesX = m_pLightCuller->GetAmountOfTilesX();
+	const int amountOfTilesY = m_pLightCuller->GetAmountOfTilesY();
+
+	m_DirtyTileMin.x = Clamp(min.x / TileSize, 0, amountOfTilesX);
+	m_DirtyTileMin.y = Clamp(min.y / TileSize, 0, amountOfTilesY);
+	m_DirtyTileMax.x = Clamp((max.x + TileSize - 1) / TileSize, 0, amountOfTilesX);
+	m_DirtyTileMax.y = Clamp((max.y + TileSize - 1) / TileSize, 0, amountOfTilesY);
+
+	m_DirtyMin = { m_DirtyTileMin.x * TileSize, m_DirtyTileMin.y * TileSize };
+	m_DirtyMax = { std::min(m_DirtyTileMax.x * TileSize, m_Width), std::min(m_DirtyTileMax.y * TileSize, m_Height) };
+	return m_DirtyMin.x < m_DirtyMax.x && m_DirtyMin.y < m_DirtyMax.y;
+}
+
+template<typename Function>
+void Renderer_Software::ForEachDirtyTile(const Function& function) const
+{
+	const int amountOfTilesX = m_pLightCuller->GetAmountOfTilesX();
+	const int dirtyTilesX = m_DirtyTileMax.x - m_DirtyTileMin.x;
+	const uint32_t amountOfDirtyTiles = static_cast<uint32_t>(dirtyTilesX * (m_DirtyTileMax.y - m_DirtyTileMin.y));
+
+	ParallelFor(0u, amountOfDirtyTiles, [=, this](uint32_t dirtyTileIndex)
+		{
+			const int tileX = m_DirtyTileMin.x + static_cast<int>(dirtyTileIndex) % dirtyTilesX;
+			const int tileY = m_DirtyTileMin.y + static_cast<int>(dirtyTileIndex) / dirtyTilesX;
+			function(static_cast<uint32_t>(tileX + (tileY * amountOfTilesX)));
+		}
+	);
+}
+
+void Renderer_Software::SelectKernels()
+{
+	//Every combination of render states has its own kernel, so the per pixel loops carry no state checks
+	static constexpr RenderTriangleFunction renderTriangleFunctions[2][3]{
+		{
+			&Renderer_Software::RenderTriangle<false, Cullmode::backFace, false>,
+			&Renderer_Software::RenderTriangle<false, Cullmode::frontFace, false>,
+			&Renderer_Software::RenderTriangle<false, Cullmode::none, false>
+		},
+		{
+			&Renderer_Software::RenderTriangle<true, Cullmode::backFace, false>,
+			&Renderer_Software::RenderTriangle<true, Cullmode::frontFace, false>,
+			&Renderer_Software::RenderTriangle<true, Cullmode::none, false>
+		}
+	};
+
+	//Depth visualization ignores the normal map, shading mode and precision
+	static constexpr ShadeTileFunction depthShadeTileFunction{ &Renderer_Software::ShadeTile<true, false, ShadingMode::Combined, MathPrecision::Exact> };
+	static constexpr ShadeTileFunction shadeTileFunctions[2][2][4]{
+		{
+			{
+				&Renderer_Software::ShadeTile<false, false, ShadingMode::ObservedArea, MathPrecision::Exact>,
+				&Renderer_Software::ShadeTile<false, false, ShadingMode::Diffuse, MathPrecision::Exact>,
+				&Renderer_Software::ShadeTile<false, false, ShadingMode::Specular, MathPrecision::Exact>,
+				&Renderer_Software::ShadeTile<false, false, ShadingMode::Combined, MathPrecision::Exact>
+			},
+			{
+				&Renderer_Software::ShadeTile<false, true, ShadingMode::ObservedArea, MathPrecision::Exact>,
+				&Renderer_Software::ShadeTile<false, true, ShadingMode::Diffuse, MathPrecision::Exact>,
+				&Renderer_Software::ShadeTile<false, true, ShadingMode::Specular, MathPrecision::Exact>,
+				&Renderer_Software::ShadeTile<false, true, ShadingMode::Combined, MathPrecision::Exact>
+			}
+		},
+		{
+			{
+				&Renderer_Software::ShadeTile<false, false, ShadingMode::ObservedArea, MathPrecision::Fast>,
+				&Renderer_Software::ShadeTile<false, false, ShadingMode::Diffuse, MathPrecision::Fast>,
+				&Renderer_Software::ShadeTile<false, false, ShadingMode::Specular, MathPrecision::Fast>,
+				&Renderer_Software::ShadeTile<false, false, ShadingMode::Combined, MathPrecision::Fast>
+			},
+			{
+				&Renderer_Software::ShadeTile<false, true, ShadingMode::ObservedArea, MathPrecision::Fast>,
+				&Renderer_Software::ShadeTile<false, true, ShadingMode::Diffuse, MathPrecision::Fast>,
+				&Renderer_Software::ShadeTile<false, true, ShadingMode::Specular, MathPrecision::Fast>,
+				&Renderer_Software::ShadeTile<false, true, ShadingMode::Combined, MathPrecision::Fast>
 			}
 		}
+	};
+
+	static constexpr ShadeTileFunction blendTransparentTileFunctions[3]{
+		&Renderer_Software::BlendTransparentTile<Cullmode::backFace>,
+		&Renderer_Software::BlendTransparentTile<Cullmode::frontFace>,
+		&Renderer_Software::BlendTransparentTile<Cullmode::none>
+	};
+
+	m_pRenderTriangle = renderTriangleFunctions[m_CanRenderBoundingBox][static_cast<int>(m_CurrentCullmode)];
+	m_pBlendTransparentTile = blendTransparentTileFunctions[static_cast<int>(m_CurrentCullmode)];
+	if (m_RenderDepthBuffer) {
+		m_pShadeTile = depthShadeTileFunction;
+	}
+	else {
+		m_pShadeTile = shadeTileFunctions[static_cast<int>(m_ShadingPrecision)][m_CanUseNormalMap][static_cast<int>(m_CurrentShadingMode)];
 	}
 }
 
-void Renderer_Software::RenderTriangle(const Vertex_Out& vertex1, const Vertex_Out& vertex2, const Vertex_Out& vertex3, Mesh_Software* pMesh) {
+template<bool RenderBoundingBox, Renderer::Cullmode CullMode, bool DepthOnly>
+void Renderer_Software::RenderTriangle(const RasterTarget& target, const Vertex_Out& vertex1, const Vertex_Out& vertex2, const Vertex_Out& vertex3, Mesh_Software* pMesh) {
 	Vector2 v0{ vertex1.position.x, vertex1.position.y };
 	Vector2 v1{ vertex2.position.x, vertex2.position.y };
 	Vector2 v2{ vertex3.position.x, vertex3.position.y };
 
-	//Bounding box
+	//Bounding box, limited to the region of the target that is drawn
 	Int2 min{}, max{};
 
-	min.x = Clamp(int(std::min(vertex1.position.x, std::min(vertex2.position.x, vertex3.position.x))), 0, m_Width);
-	min.y = Clamp(int(std::min(vertex1.position.y, std::min(vertex2.position.y, vertex3.position.y))), 0, m_Height);
+	min.x = int(std::min(vertex1.position.x, std::min(vertex2.position.x, vertex3.position.x)));
+	min.y = int(std::min(vertex1.position.y, std::min(vertex2.position.y, vertex3.position.y)));
 
-	max.x = Clamp(int(std::max(vertex1.position.x, std::max(vertex2.position.x, vertex3.position.x))), 0, m_Width);
-	max.y = Clamp(int(std::max(vertex1.position.y, std::max(vertex2.position.y, vertex3.position.y))), 0, m_Height);
+	max.x = int(std::max(vertex1.position.x, std::max(vertex2.position.x, vertex3.position.x)));
+	max.y = int(std::max(vertex1.position.y, std::max(vertex2.position.y, vertex3.position.y)));
 
-	//RENDER LOGIC
-	for (int px{ min.x }; px <= max.x; ++px)
-	{
-		for (int py{ min.y }; py <= max.y; ++py)
+	if (max.x < target.min.x || max.y < target.min.y || min.x >= target.max.x || min.y >= target.max.y) {
+		return;
+	}
+	min.x = std::max(min.x, target.min.x);
+	min.y = std::max(min.y, target.min.y);
+	max.x = std::min(max.x, target.max.x - 1);
+	max.y = std::min(max.y, target.max.y - 1);
+
+	if constexpr (RenderBoundingBox) {
+		//White bounding box
+		const uint32_t white = PackColor(255, 255, 255);
+		for (int px{ min.x }; px <= max.x; ++px)
 		{
-			if (m_CanRenderBoundingBox)
+			for (int py{ min.y }; py <= max.y; ++py)
 			{
-				//White bounding box
-				ColorRGB finalColor{ 1,1,1 };
-
-				//Update Color in Buffer
-				finalColor.MaxToOne();
-
-				m_pBackBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBackBuffer->format,
-					static_cast<uint8_t>(finalColor.r * 255),
-					static_cast<uint8_t>(finalColor.g * 255),
-					static_cast<uint8_t>(finalColor.b * 255));
-
-				continue;
+				m_pBackBufferPixels[px + (py * m_Width)] = white;
 			}
-			
-			const Vector2 pixelPoint{ static_cast<float>(px), static_cast<float>(py) };
-
-			Vector2 pointToSide = pixelPoint - v0;
-			Vector2 a = v1 - v0;
-			float w2 = Vector2::Cross(a, pointToSide);
-
-			pointToSide = pixelPoint - v1;
-			Vector2 b = v2 - v1;
-			float w0 = Vector2::Cross(b, pointToSide);
+		}
+		return;
+	}
 
-			pointToSide = pixelPoint - v2;
-			Vector2 c = v0 - v2;
-			float w1 = Vector2::Cross(c, pointToSide);
+	//RENDER LOGIC
+	//The sides are the same for every pixel, the crosses with them are written out so the pixel loop makes no calls
+	const Vector2 a = v1 - v0;
+	const Vector2 b = v2 - v1;
+	const Vector2 c = v0 - v2;
+	for (int py{ min.y }; py <= max.y; ++py)
+	{
+		const float pixelY = static_cast<float>(py);
+		for (int px{ min.x }; px <= max.x; ++px)
+		{
+			const float pixelX = static_cast<float>(px);
+			float w2 = a.x * (pixelY - v0.y) - a.y * (pixelX - v0.x);
+			float w0 = b.x * (pixelY - v1.y) - b.y * (pixelX - v1.x);
+			float w1 = c.x * (pixelY - v2.y) - c.y * (pixelX - v2.x);
 
 			bool pointInTriangle{};
 
-			switch (m_CurrentCullmode) {
-			case Cullmode::backFace:
+			if constexpr (CullMode == Cullmode::backFace) {
 				pointInTriangle = (w0 >= 0) && (w1 >= 0) && (w2 >= 0); //backface
-				break;
-			case Cullmode::frontFace:
+			}
+			else if constexpr (CullMode == Cullmode::frontFace) {
 				pointInTriangle = (w0 <= 0) && (w1 <= 0) && (w2 <= 0); //frontface
-				break;
-			case Cullmode::none:
-				pointInTriangle = ((w0 >= 0) && (w1 >= 0) && (w2 >= 0) || (w0 <= 0) && (w1 <= 0) && (w2 <= 0)); //none
-				break;
+			}
+			else {
+				pointInTriangle = ((w0 >= 0 && w1 >= 0 && w2 >= 0) || (w0 <= 0 && w1 <= 0 && w2 <= 0)); //none
 			}
 
 			if (pointInTriangle) {
@@ -269,14 +832,25 @@ void Renderer_Software::RenderTriangle(const Vertex_Out& vertex1, const Vertex_O
 				w2 /= totalArea;
 				//Check depth buffer
 				//	Interpolate depth
-				float interpolatedDepth{ 1.f / ((w0 / vertex1.position.z) + (w1 / vertex2.position.z) + (w2 / vertex3.position.z)) };
+				float interpolatedDepth{};
+				if constexpr (DepthOnly) {
+					//The shadow map is orthographic, the depth is linear in raster space
+					interpolatedDepth = w0 * vertex1.position.z + w1 * vertex2.position.z + w2 * vertex3.position.z;
+				}
+				else {
+					interpolatedDepth = 1.f / ((w0 / vertex1.position.z) + (w1 / vertex2.position.z) + (w2 / vertex3.position.z));
+				}
 				//	Frustrum culling on z
 				if (interpolatedDepth < 0 || interpolatedDepth > 1) {
 					continue;
 				}
 
-				if (interpolatedDepth < m_pDepthBufferPixels[px + (py * m_Width)]) {
-					m_pDepthBufferPixels[px + (py * m_Width)] = interpolatedDepth;
+				float& depthPixel = target.pDepthPixels[px + (py * target.width)];
+				if (interpolatedDepth < depthPixel) {
+					depthPixel = interpolatedDepth;
+					if constexpr (DepthOnly) {
+						continue;
+					}
 
 					//Need the interpolated depth with the actual depth, stored in w
 					const float interpolatedDepthW{ 1.f / ((w0 / vertex1.position.w) + (w1 / vertex2.position.w) + (w2 / vertex3.position.w)) };
@@ -290,178 +864,871 @@ void Renderer_Software::RenderTriangle(const Vertex_Out& vertex1, const Vertex_O
 					//	Interpolate Normal
 					Vector3 interpolatedNormal = (vertex1.normal * w0 / vertex1.position.w + vertex2.normal * w1 / vertex2.position.w + vertex3.normal * w2 / vertex3.position.w);
 					interpolatedNormal *= interpolatedDepthW;
-					interpolatedNormal.Normalize();
 					//	Interpolate Tangent
 					Vector3 interpolatedTangent = (vertex1.tangent * w0 / vertex1.position.w + vertex2.tangent * w1 / vertex2.position.w + vertex3.tangent * w2 / vertex3.position.w);
 					interpolatedTangent *= interpolatedDepthW;
-					interpolatedTangent.Normalize();
 					//	Interpolate ViewDirection
 					Vector3 interpolatedView = (vertex1.viewDirection * w0 / vertex1.position.w + vertex2.viewDirection * w1 / vertex2.position.w + vertex3.viewDirection * w2 / vertex3.position.w);
 					interpolatedView *= interpolatedDepthW;
-					interpolatedView.Normalize();
+					//	Interpolate World Position
+					Vector3 interpolatedWorldPos = (vertex1.worldPosition * w0 / vertex1.position.w + vertex2.worldPosition * w1 / vertex2.position.w + vertex3.worldPosition * w2 / vertex3.position.w);
+					interpolatedWorldPos *= interpolatedDepthW;
+
+					//Shading happens after all triangles are rasterized, it also normalizes the interpolated directions
+					GBufferPixel& gBufferPixel = m_pGBufferPixels[px + (py * m_Width)];
+					gBufferPixel.vertex = Vertex_Out{ interpolatedPos, interpolatedUV, interpolatedNormal, interpolatedTangent, interpolatedView, interpolatedWorldPos };
+					gBufferPixel.pMesh = pMesh;
+				}
+			}
+		}
+	}
+}
+
+void Renderer_Software::ShadePixels()
+{
+	ForEachDirtyTile([this](uint32_t tileIndex)
+		{
+			(this->*m_pShadeTile)(tileIndex);
+		}
+	);
+}
+
+template<bool RenderDepth, bool UseNormalMap, Renderer_Software::ShadingMode Mode, MathPrecision Precision>
+void Renderer_Software::ShadeTile(uint32_t tileIndex)
+{
+	constexpr int Width{ FloatN::Width };
+	const int amountOfTilesX = m_pLightCuller->GetAmountOfTilesX();
+
+	uint32_t amountOfLights{};
+	const uint32_t* pLightIndices = m_pLightCuller->GetTileLights(tileIndex, amountOfLights);
+
+	const int startX = (tileIndex % amountOfTilesX) * LightCuller::TileSize;
+	const int startY = (tileIndex / amountOfTilesX) * LightCuller::TileSize;
+	const int endX = std::min(startX + LightCuller::TileSize, m_Width);
+	const int endY = std::min(startY + LightCuller::TileSize, m_Height);
+
+	HistoryPixel* pHistoryPixels = m_pHistoryPixels[m_HistoryWriteIndex];
+
+	//Covered pixels that don't reuse last frame, they are shaded Width at a time so no lanes are spent on empty pixels
+	int pixelsToShade[LightCuller::TileSize * LightCuller::TileSize];
+	int amountToShade{};
+	uint32_t amountReused{};
+
+	for (int py{ startY }; py < endY; ++py) {
+		for (int batchX{ startX }; batchX < endX; batchX += Width) {
+			int coveredBits{};
+			for (int lane{}; lane < Width && batchX + lane < endX; ++lane) {
+				if (m_pGBufferPixels[batchX + lane + (py * m_Width)].pMesh) {
+					coveredBits |= 1 << lane;
+				}
+			}
+			if (!coveredBits) {
+				continue;
+			}
 
-					Vertex_Out currentVertex{ interpolatedPos, interpolatedUV, interpolatedNormal, interpolatedTangent, interpolatedView };
-					ColorRGB finalColor{ PixelShading(currentVertex, pMesh) };
+			int reusedBits{};
+			if (m_CanReuseHistory) {
+				//Every frame another one in TemporalRefreshInterval pixels is shaded again, so view dependent shading can't go stale for long
+				int candidateBits{};
+				for (int lane{}; lane < Width; ++lane) {
+					if ((batchX + lane + py * 3 + static_cast<int>(m_TemporalFrameIndex)) % TemporalRefreshInterval != 0) {
+						candidateBits |= 1 << lane;
+					}
+				}
 
-					//Update Color in Buffer
-					finalColor.MaxToOne();
+				uint32_t colors[Width];
+				Vector2 offsets[Width];
+				reusedBits = ReuseHistory(batchX, py, coveredBits & candidateBits, colors, offsets);
+				for (int lane{}; lane < Width; ++lane) {
+					if (!(reusedBits & (1 << lane))) {
+						continue;
+					}
+					const int pixelIndex = batchX + lane + (py * m_Width);
+					m_pBackBufferPixels[pixelIndex] = colors[lane];
+					pHistoryPixels[pixelIndex] = { colors[lane], offsets[lane] };
+					++amountReused;
+				}
+			}
 
-					m_pBackBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBackBuffer->format,
-						static_cast<uint8_t>(finalColor.r * 255),
-						static_cast<uint8_t>(finalColor.g * 255),
-						static_cast<uint8_t>(finalColor.b * 255));
+			for (int lane{}; lane < Width; ++lane) {
+				if ((coveredBits & ~reusedBits) & (1 << lane)) {
+					pixelsToShade[amountToShade] = batchX + lane + (py * m_Width);
+					++amountToShade;
 				}
 			}
 		}
 	}
+
+	for (int firstPixel{}; firstPixel < amountToShade; firstPixel += Width) {
+		const int amountOfPixels = std::min(Width, amountToShade - firstPixel);
+		const int* pPixelIndices = pixelsToShade + firstPixel;
+		ShadingInputN input{};
+		GatherShadingInput(pPixelIndices, amountOfPixels, input);
+
+		ColorRGBN finalColor{};
+		if constexpr (RenderDepth) {
+			const FloatN interpolatedDepth = (input.depth - Broadcast(0.985f)) / Broadcast(1.f - 0.985f);
+			finalColor = { interpolatedDepth, interpolatedDepth, interpolatedDepth };
+		}
+		else {
+			finalColor = PixelShading<UseNormalMap, Mode, Precision>(input, pLightIndices, amountOfLights);
+		}
+
+		//Update Color in Buffer
+		finalColor.MaxToOne();
+
+		float red[Width], green[Width], blue[Width];
+		Store(red, finalColor.r);
+		Store(green, finalColor.g);
+		Store(blue, finalColor.b);
+		for (int lane{}; lane < amountOfPixels; ++lane) {
+			const uint32_t color = PackColor(
+				static_cast<uint8_t>(red[lane] * 255),
+				static_cast<uint8_t>(green[lane] * 255),
+				static_cast<uint8_t>(blue[lane] * 255));
+			m_pBackBufferPixels[pPixelIndices[lane]] = color;
+			if (m_ShouldWriteHistory) {
+				pHistoryPixels[pPixelIndices[lane]] = { color, Vector2{} };
+			}
+		}
+	}
+
+	m_ReusedPixels += amountReused;
+	m_ShadedPixels += static_cast<uint32_t>(amountToShade);
 }
 
-ColorRGB Renderer_Software::PixelShading(const Vertex_Out& vertex, Mesh_Software* pSoftwareMesh)
+int Renderer_Software::ReuseHistory(int batchX, int py, int candidateBits, uint32_t* pColors, Vector2* pOffsets) const
 {
-	if (m_RenderDepthBuffer) {
-		float interpolatedDepth = Utils::Remap(vertex.position.z, 0.985f, 1.f);
-		return ColorRGB{ interpolatedDepth, interpolatedDepth, interpolatedDepth };
+	constexpr int Width{ FloatN::Width };
+	if (!candidateBits) {
+		return 0;
 	}
-	Texture* pDiffuse{};
-	Texture* pNormal{};
-	Texture* pSpecular{};
-	Texture* pGloss{};
 
-	ColorRGB ambientColor{ 0.025f, 0.025f, 0.025f };
-	ColorRGB finalColor{};
-	float specularShininess{ 25.f };
+	//Only reads what the checks need from the GBuffer, the full gather is only done for pixels that are shaded
+	float worldX[Width]{}, worldY[Width]{}, worldZ[Width]{};
+	float normalX[Width]{}, normalY[Width]{}, normalZ[Width]{};
+	const GBufferPixel* pGBufferPixels[Width]{};
+	for (int lane{}; lane < Width; ++lane) {
+		//Inactive lanes keep unit vectors so they never produce NaNs
+		normalZ[lane] = 1.f;
+		if (!(candidateBits & (1 << lane))) {
+			continue;
+		}
+		const GBufferPixel& gBufferPixel = m_pGBufferPixels[batchX + lane + (py * m_Width)];
+		pGBufferPixels[lane] = &gBufferPixel;
+		worldX[lane] = gBufferPixel.vertex.worldPosition.x;
+		worldY[lane] = gBufferPixel.vertex.worldPosition.y;
+		worldZ[lane] = gBufferPixel.vertex.worldPosition.z;
+		normalX[lane] = gBufferPixel.vertex.normal.x;
+		normalY[lane] = gBufferPixel.vertex.normal.y;
+		normalZ[lane] = gBufferPixel.vertex.normal.z;
+	}
 
-	//Get the textures
+	//Where the surface of every lane was on screen last frame
+	const Vector4 xAxis = m_HistoryViewProjectionMatrix[0];
+	const Vector4 yAxis = m_HistoryViewProjectionMatrix[1];
+	const Vector4 zAxis = m_HistoryViewProjectionMatrix[2];
+	const Vector4 translation = m_HistoryViewProjectionMatrix[3];
+	const FloatN positionX = Load(worldX);
+	const FloatN positionY = Load(worldY);
+	const FloatN positionZ = Load(worldZ);
+	const FloatN projectedX = Broadcast(xAxis.x) * positionX + Broadcast(yAxis.x) * positionY + Broadcast(zAxis.x) * positionZ + Broadcast(translation.x);
+	const FloatN projectedY = Broadcast(xAxis.y) * positionX + Broadcast(yAxis.y) * positionY + Broadcast(zAxis.y) * positionZ + Broadcast(translation.y);
+	const FloatN projectedW = Broadcast(xAxis.w) * positionX + Broadcast(yAxis.w) * positionY + Broadcast(zAxis.w) * positionZ + Broadcast(translation.w);
+
+	const FloatN width{ Broadcast(static_cast<float>(m_Width)) };
+	const FloatN height{ Broadcast(static_cast<float>(m_Height)) };
+	const FloatN inverseW = Broadcast(1.f) / projectedW;
+	const FloatN rasterX = (projectedX * inverseW + Broadcast(1.f)) * Broadcast(0.5f) * width;
+	const FloatN rasterY = (Broadcast(1.f) - projectedY * inverseW) * Broadcast(0.5f) * height;
+	//Pixels are sampled at their integer coordinates
+	const FloatN historyX = RoundToNearest(rasterX);
+	const FloatN historyY = RoundToNearest(rasterY);
+	int reusedBits = candidateBits & ToBits((projectedW >= Broadcast(m_pCamera->nearPlane)) &
+		(historyX >= Broadcast(0.f)) & (historyX < width) & (historyY >= Broadcast(0.f)) & (historyY < height));
+	if (!reusedBits) {
+		return 0;
+	}
 
-	Mesh* pMesh = pSoftwareMesh->internalMesh;
-	if (pMesh->pTextures.size() == 4) {
-		pDiffuse = pMesh->pTextures[0];
-		pNormal = pMesh->pTextures[1];
-		pSpecular = pMesh->pTextures[2];
-		pGloss = pMesh->pTextures[3];
+	//History is an array of structures, transpose it into lanes
+	const HistoryPixel* pHistoryPixels = m_pHistoryPixels[m_HistoryWriteIndex ^ 1];
+	float x[Width], y[Width];
+	Store(x, historyX);
+	Store(y, historyY);
+	float depth[Width]{};
+	float historyNormalX[Width]{}, historyNormalY[Width]{}, historyNormalZ[Width]{};
+	float offsetX[Width]{}, offsetY[Width]{};
+	const HistoryPixel* pLanePixels[Width]{};
+	for (int lane{}; lane < Width; ++lane) {
+		historyNormalZ[lane] = 1.f;
+		if (!(reusedBits & (1 << lane))) {
+			continue;
+		}
+		const int historyIndex = static_cast<int>(x[lane]) + (static_cast<int>(y[lane]) * m_Width);
+		const GBufferPixel& historyGBufferPixel = m_pHistoryGBufferPixels[historyIndex];
+		//Another mesh or nothing was there, the surface was hidden last frame
+		if (historyGBufferPixel.pMesh != pGBufferPixels[lane]->pMesh) {
+			reusedBits &= ~(1 << lane);
+			continue;
+		}
+		pLanePixels[lane] = &pHistoryPixels[historyIndex];
+		depth[lane] = historyGBufferPixel.vertex.position.w;
+		historyNormalX[lane] = historyGBufferPixel.vertex.normal.x;
+		historyNormalY[lane] = historyGBufferPixel.vertex.normal.y;
+		historyNormalZ[lane] = historyGBufferPixel.vertex.normal.z;
+		offsetX[lane] = pLanePixels[lane]->offset.x;
+		offsetY[lane] = pLanePixels[lane]->offset.y;
 	}
-	else {
-		//You did not get all the needed textures!
+
+	//The history pixel has to show the same surface, close enough to where it is now
+	const Vector3N normal{ Load(normalX), Load(normalY), Load(normalZ) };
+	const Vector3N historyNormal{ Load(historyNormalX), Load(historyNormalY), Load(historyNormalZ) };
+	const FloatN normalLengths = Sqrt(historyNormal.SqrMagnitude() * normal.SqrMagnitude());
+	const FloatN depthDifference = Max(Load(depth) - projectedW, projectedW - Load(depth));
+	const Vector2N offset{ Load(offsetX) + historyX - rasterX, Load(offsetY) + historyY - rasterY };
+	reusedBits &= ToBits((depthDifference <= Broadcast(HistoryDepthTolerance) * projectedW) &
+		(Vector3N::Dot(historyNormal, normal) >= Broadcast(HistoryNormalTolerance) * normalLengths) &
+		(offset.x * offset.x + offset.y * offset.y <= Broadcast(MaxHistoryOffset * MaxHistoryOffset)));
+
+	Store(offsetX, offset.x);
+	Store(offsetY, offset.y);
+	for (int lane{}; lane < Width; ++lane) {
+		if (!(reusedBits & (1 << lane))) {
+			continue;
+		}
+		pColors[lane] = pLanePixels[lane]->color;
+		pOffsets[lane] = { offsetX[lane], offsetY[lane] };
+	}
+	return reusedBits;
+}
+
+void Renderer_Software::GatherShadingInput(const int* pPixelIndices, int amountOfPixels, ShadingInputN& input) const
+{
+	constexpr int Width{ FloatN::Width };
+
+	//GBuffer is an array of structures, transpose it into lanes
+	float depth[Width]{};
+	float u[Width]{}, v[Width]{};
+	float normalX[Width]{}, normalY[Width]{}, normalZ[Width]{};
+	float tangentX[Width]{}, tangentY[Width]{}, tangentZ[Width]{};
+	float viewX[Width]{}, viewY[Width]{}, viewZ[Width]{};
+	float worldX[Width]{}, worldY[Width]{}, worldZ[Width]{};
+	float canBeShaded[Width]{};
+
+	input.coveredBits = 0;
+	for (int lane{}; lane < Width; ++lane) {
+		//Inactive lanes keep unit vectors so they never produce NaNs
+		normalZ[lane] = 1.f;
+		tangentX[lane] = 1.f;
+		viewZ[lane] = 1.f;
+		input.pMeshes[lane] = nullptr;
+
+		if (lane >= amountOfPixels) {
+			continue;
+		}
+		const GBufferPixel& gBufferPixel = m_pGBufferPixels[pPixelIndices[lane]];
+
+		const Vertex_Out& vertex = gBufferPixel.vertex;
+		input.coveredBits |= 1 << lane;
+		input.pMeshes[lane] = gBufferPixel.pMesh;
+		canBeShaded[lane] = gBufferPixel.pMesh->canBeShaded ? 1.f : 0.f;
+
+		depth[lane] = vertex.position.z;
+		u[lane] = vertex.uv.x;
+		v[lane] = vertex.uv.y;
+		normalX[lane] = vertex.normal.x;
+		normalY[lane] = vertex.normal.y;
+		normalZ[lane] = vertex.normal.z;
+		tangentX[lane] = vertex.tangent.x;
+		tangentY[lane] = vertex.tangent.y;
+		tangentZ[lane] = vertex.tangent.z;
+		viewX[lane] = vertex.viewDirection.x;
+		viewY[lane] = vertex.viewDirection.y;
+		viewZ[lane] = vertex.viewDirection.z;
+		worldX[lane] = vertex.worldPosition.x;
+		worldY[lane] = vertex.worldPosition.y;
+		worldZ[lane] = vertex.worldPosition.z;
+	}
+
+	input.depth = Load(depth);
+	input.uv = { Load(u), Load(v) };
+	input.normal = { Load(normalX), Load(normalY), Load(normalZ) };
+	input.tangent = { Load(tangentX), Load(tangentY), Load(tangentZ) };
+	input.viewDirection = { Load(viewX), Load(viewY), Load(viewZ) };
+	input.worldPosition = { Load(worldX), Load(worldY), Load(worldZ) };
+	input.canBeShaded = Load(canBeShaded) > Broadcast(0.f);
+}
+
+FloatN Renderer_Software::SampleShadowLanes(const ShadingInputN& input, const Vector3N& normal, int activeBits) const
+{
+	constexpr int Width{ FloatN::Width };
+
+	float worldX[Width], worldY[Width], worldZ[Width];
+	float normalX[Width], normalY[Width], normalZ[Width];
+	Store(worldX, input.worldPosition.x);
+	Store(worldY, input.worldPosition.y);
+	Store(worldZ, input.worldPosition.z);
+	Store(normalX, normal.x);
+	Store(normalY, normal.y);
+	Store(normalZ, normal.z);
+
+	float visibility[Width]{};
+	for (int lane{}; lane < Width; ++lane) {
+		if (!(activeBits & (1 << lane))) {
+			continue;
+		}
+		visibility[lane] = m_pShadowMap->SampleVisibility({ worldX[lane], worldY[lane], worldZ[lane] },
+			{ normalX[lane], normalY[lane], normalZ[lane] }, m_ShadowFilterSize);
+	}
+	return Load(visibility);
+}
+
+ColorRGBN Renderer_Software::SampleLanes(const ShadingInputN& input, dae::Texture* Mesh_Software::* pTexture, int activeBits)
+{
+	constexpr int Width{ FloatN::Width };
+
+	float u[Width], v[Width];
+	Store(u, input.uv.x);
+	Store(v, input.uv.y);
+
+	float red[Width]{}, green[Width]{}, blue[Width]{};
+	for (int lane{}; lane < Width; ++lane) {
+		if (!(activeBits & (1 << lane))) {
+			continue;
+		}
+		const ColorRGB sample = (input.pMeshes[lane]->*pTexture)->Sample({ u[lane], v[lane] });
+		red[lane] = sample.r;
+		green[lane] = sample.g;
+		blue[lane] = sample.b;
+	}
+	return { Load(red), Load(green), Load(blue) };
+}
+
+template<bool UseNormalMap, Renderer_Software::ShadingMode Mode, MathPrecision Precision>
+ColorRGBN Renderer_Software::PixelShading(const ShadingInputN& input, const uint32_t* pLightIndices, uint32_t amountOfLights) const
+{
+	constexpr bool needsDiffuse{ Mode == ShadingMode::Diffuse || Mode == ShadingMode::Combined };
+	constexpr bool needsSpecular{ Mode == ShadingMode::Specular || Mode == ShadingMode::Combined };
+
+	const ColorRGBN ambientColor{ ColorRGBN::Broadcast({ 0.025f, 0.025f, 0.025f }) };
+	const FloatN specularShininess{ Broadcast(25.f) };
+	const FloatN zero{ Broadcast(0.f) };
+	const FloatN one{ Broadcast(1.f) };
+
+	ColorRGBN finalColor{ zero, zero, zero };
+
+	//Lanes without all the needed textures or with UVs outside of the texture stay black
+	MaskN isShaded = input.canBeShaded &
+		(input.uv.x >= zero) & (input.uv.x <= one) &
+		(input.uv.y >= zero) & (input.uv.y <= one);
+
+	Vector3N normal = input.normal.Normalized<Precision>();
+	//Shadow lookups are offset along the surface itself, the normal map only adds detail to the shading
+	const Vector3N geometricNormal = normal;
+
+	if constexpr (UseNormalMap) {
+		//normal map is not set for some meshes
+		float hasNormalMap[FloatN::Width]{};
+		for (int lane{}; lane < FloatN::Width; ++lane) {
+			hasNormalMap[lane] = (input.pMeshes[lane] && input.pMeshes[lane]->pNormal) ? 1.f : 0.f;
+		}
+		isShaded = isShaded & (Load(hasNormalMap) > zero);
+	}
+
+	const int shadedBits = ToBits(isShaded);
+	if (!shadedBits) {
 		return finalColor;
 	}
-	
-	Vector3 binormal = Vector3::Cross(vertex.normal, vertex.tangent);
-	binormal.Normalize();
-	Matrix tangentSpaceAxis = Matrix{ vertex.tangent, binormal, vertex.normal, Vector3::Zero };
 
-	for (auto pLight : m_pLights) {
-		Vector3 lightDirection{ (pLight->direction) * -1 };
-		//Clamp UV values
-		if (vertex.uv.x < 0 || vertex.uv.x > 1
-			|| vertex.uv.y < 0 || vertex.uv.y > 1) {
+	if constexpr (UseNormalMap) {
+		const Vector3N tangent = input.tangent.Normalized<Precision>();
+		const Vector3N binormal = Vector3N::Cross(normal, tangent).Normalized<Precision>();
+
+		//Sample normal from the normal map and bring it in a correct range
+		const ColorRGBN normalColor = SampleLanes(input, &Mesh_Software::pNormal, shadedBits);
+		const Vector3N sampledNormal{
+			Broadcast(2.f) * normalColor.r - one,
+			Broadcast(2.f) * normalColor.g - one,
+			Broadcast(2.f) * normalColor.b - one };
+
+		//Tangent space to world space
+		normal = (tangent * sampledNormal.x + binormal * sampledNormal.y + normal * sampledNormal.z).Normalized<Precision>();
+	}
+
+	//The samples are the same for every light, only fetch the ones this mode uses
+	ColorRGBN lambertDiffuse{};
+	if constexpr (needsDiffuse) {
+		//Sample diffuse color from the texture
+		const float kd{ 1.f };
+		lambertDiffuse = SampleLanes(input, &Mesh_Software::pDiffuse, shadedBits) * Broadcast(kd / float(M_PI));
+	}
+
+	ColorRGBN specularColor{};
+	FloatN glossExponent{};
+	Vector3N viewDirection{};
+	if constexpr (needsSpecular) {
+		//Sample specular color and glossiness
+		specularColor = SampleLanes(input, &Mesh_Software::pSpecular, shadedBits);
+		glossExponent = SampleLanes(input, &Mesh_Software::pGloss, shadedBits).r * specularShininess;
+		viewDirection = input.viewDirection.Normalized<Precision>();
+	}
+
+	for (uint32_t i{}; i < amountOfLights; ++i) {
+		const Light* pLight = m_pLights[pLightIndices[i]];
+
+		Vector3N lightDirection{};
+		if (pLight->type == LightType::Directional) {
+			lightDirection = Vector3N::Broadcast(pLight->direction * -1);
+		}
+		else {
+			lightDirection = (Vector3N::Broadcast(pLight->origin) - input.worldPosition).Normalized<Precision>();
+		}
+
+		const FloatN observedArea = Vector3N::Dot(normal, lightDirection);
+		const MaskN isLit = isShaded & (observedArea > zero);
+		if (!Any(isLit)) {
 			continue;
 		}
 
-		Vector3 normal = vertex.normal;
+		FloatN visibility = one;
+		if (pLight == m_pShadowLight) {
+			visibility = SampleShadowLanes(input, geometricNormal, ToBits(isLit));
+		}
+
+		ColorRGBN lightContribution{};
+		if constexpr (Mode == ShadingMode::ObservedArea) {
+			const FloatN litArea = observedArea * visibility;
+			lightContribution = { litArea, litArea, litArea };
+		}
+		else {
+			ColorRGBN phongSpecular{};
+			if constexpr (needsSpecular) {
+				//light direction reflected over the normal
+				const Vector3N r = -lightDirection - normal * (Broadcast(2.f) * Vector3N::Dot(normal, -lightDirection));
+				const FloatN cosA = Max(Vector3N::Dot(r, viewDirection), zero);
+				phongSpecular = specularColor * Pow<Precision>(cosA, glossExponent);
+			}
 
-		if (m_CanUseNormalMap) {
-			//Sample normal from the normal map
-			if (!pNormal) {
-				//normal map is not set
-				return finalColor;
+			if constexpr (Mode == ShadingMode::Diffuse) {
+				lightContribution = LightUtils::GetRadiance(pLight, input.worldPosition) * lambertDiffuse * (observedArea * visibility);
+			}
+			else if constexpr (Mode == ShadingMode::Specular) {
+				lightContribution = phongSpecular * (observedArea * visibility);
+			}
+			else if constexpr (Mode == ShadingMode::Combined) {
+				if (pLight == m_pShadowLight) {
+					//Lanes the light doesn't reach keep their ambient light
+					lightContribution = (ambientColor + ((LightUtils::GetRadiance(pLight, input.worldPosition) * lambertDiffuse) + phongSpecular) * visibility) * observedArea;
+				}
+				else {
+					lightContribution = (ambientColor + (LightUtils::GetRadiance(pLight, input.worldPosition) * lambertDiffuse) + phongSpecular) * observedArea;
+				}
 			}
-			ColorRGB normalColor = pNormal->Sample(vertex.uv);
+		}
+		finalColor = finalColor + Select(isLit, lightContribution, ColorRGBN{ zero, zero, zero });
+	}
+	return finalColor;
+}
 
-			//Make it into a vector and bring it in a correct range
-			Vector3 sampledNormal = { normalColor.r, normalColor.g, normalColor.b };
-			sampledNormal = 2.f * sampledNormal - Vector3{ 1.f, 1.f, 1.f };
-			sampledNormal = tangentSpaceAxis.TransformVector(sampledNormal);
-			sampledNormal.Normalize();
 
-			normal = sampledNormal;
+void Renderer_Software::RenderTransparentMeshes()
+{
+	//Same front end as the opaque meshes
+	CullInstances(m_pTransparentMeshes);
+	MeshVertexTransformationFunction(m_pTransparentMeshes);
+	CullMeshlets(m_pTransparentMeshes);
+
+	BinTransparentTriangles();
+	if (m_TransparentTriangles.empty()) {
+		return;
+	}
+
+	//Every tile blends its own triangles into its own pixels, so the tiles need no synchronization
+	//Tiles outside the dirty region already hold the blended result of an earlier frame
+	ForEachDirtyTile([this](uint32_t tileIndex)
+		{
+			(this->*m_pBlendTransparentTile)(tileIndex);
 		}
+	);
+}
 
-		const float observedArea = Vector3::Dot(normal, lightDirection);
+void Renderer_Software::BinTransparentTriangles()
+{
+	FrameArena& frameArena = m_pFrameAllocator->GetSharedArena();
+
+	//Every visible meshlet can at most add all its triangles
+	size_t maxAmountOfTriangles{};
+	for (const auto pSoftwareMesh : m_pTransparentMeshes) {
+		const Mesh* pMesh = pSoftwareMesh->internalMesh;
+		for (const VisibleMeshlet& visibleMeshlet : pSoftwareMesh->visibleMeshlets) {
+			const uint32_t lod = pSoftwareMesh->visibleInstances[visibleMeshlet.instanceSlot].lod;
+			maxAmountOfTriangles += pMesh->GetMeshlets(lod)[visibleMeshlet.meshletIndex].amountOfTriangles;
+		}
+	}
+	m_TransparentTriangles.Reserve(frameArena, maxAmountOfTriangles);
 
-		if (observedArea <= 0) {
+	for (const auto pSoftwareMesh : m_pTransparentMeshes) {
+		if (!pSoftwareMesh->pDiffuse) {
 			continue;
 		}
-
-		if (!pDiffuse || !pSpecular || !pGloss) {
-			//textures not correctly set!
-			return finalColor;
+		const Mesh* pMesh = pSoftwareMesh->internalMesh;
+		for (const VisibleMeshlet& visibleMeshlet : pSoftwareMesh->visibleMeshlets) {
+			const VisibleInstance& visibleInstance = pSoftwareMesh->visibleInstances[visibleMeshlet.instanceSlot];
+			const Meshlet& meshlet = pMesh->GetMeshlets(visibleInstance.lod)[visibleMeshlet.meshletIndex];
+			const Vertex_Out* pInstanceVertices = pSoftwareMesh->vertices_out.data() + visibleInstance.firstVertex;
+			//Compiled for 16 and 32 bit indices
+			pMesh->GetIndices(visibleInstance.lod).Visit([&](const auto* pMeshIndices)
+				{
+					const auto* pIndices = pMeshIndices + meshlet.firstIndex;
+
+					for (uint32_t i{}; i < meshlet.amountOfTriangles; ++i) {
+						TransparentTriangle triangle{ { pInstanceVertices[pIndices[3 * i]], pInstanceVertices[pIndices[3 * i + 1]], pInstanceVertices[pIndices[3 * i + 2]] }, pSoftwareMesh };
+
+						//Frustrum culling for x and y, then NDC space to raster space
+						bool isInside{ true };
+						for (Vertex_Out& vertex : triangle.vertices) {
+							if (vertex.position.x < -1 || vertex.position.x > 1 ||
+								vertex.position.y < -1 || vertex.position.y > 1) {
+								isInside = false;
+								break;
+							}
+							vertex.position.x = (vertex.position.x + 1) / 2.f * static_cast<float>(m_Width);
+							vertex.position.y = (1 - vertex.position.y) / 2.f * static_cast<float>(m_Height);
+						}
+						if (isInside) {
+							m_TransparentTriangles.push_back(triangle);
+						}
+					}
+				}
+			);
 		}
+	}
 
-		//Sample diffuse color from the texture
-		ColorRGB diffuseColor = pDiffuse->Sample(vertex.uv);
-		float kd{ 1.f };
-		ColorRGB lambertDiffuse = diffuseColor * (kd / float(M_PI));
-
-		//Sample specular color from the specular texture
-		ColorRGB specularColor = pSpecular->Sample(vertex.uv);
-		//Sample glossiness from the glossiness map
-		ColorRGB glossColor = pGloss->Sample(vertex.uv);
-		float glossExponent = glossColor.r;
-		glossExponent *= specularShininess;
-
-		//light direction towards the point
-		const Vector3 r = -lightDirection - (2 * Vector3::Dot(normal, -lightDirection) * normal);
-		float cosA = Vector3::Dot(r, vertex.viewDirection);
-		cosA = std::max(cosA, 0.f);
-		ColorRGB phongSpecular{ specularColor * powf(cosA, glossExponent) };
-
-		ColorRGB radiance = LightUtils::GetRadiance(pLight, pLight->origin);
-
-		switch (m_CurrentShadingMode)
+	//Tiles covered by the bounding box of a triangle
+	const int amountOfTilesX = m_pLightCuller->GetAmountOfTilesX();
+	const int amountOfTilesY = m_pLightCuller->GetAmountOfTilesY();
+	auto getTileRange = [=](const TransparentTriangle& triangle, Int2& minTile, Int2& maxTile)
 		{
-		case Renderer_Software::ShadingMode::ObservedArea:
-			finalColor += {observedArea, observedArea, observedArea};
-			break;
-		case Renderer_Software::ShadingMode::Diffuse:
-			finalColor += radiance * lambertDiffuse * observedArea;
-			break;
-		case Renderer_Software::ShadingMode::Specular:
-			finalColor += phongSpecular * observedArea;
-			break;
-		case Renderer_Software::ShadingMode::Combined:
-			finalColor += ColorRGB{
-				(ambientColor + (radiance * lambertDiffuse) + phongSpecular) *
-				observedArea };
-			break;
+			const Vector4& p0 = triangle.vertices[0].position;
+			const Vector4& p1 = triangle.vertices[1].position;
+			const Vector4& p2 = triangle.vertices[2].position;
+			minTile.x = Clamp(int(std::min(p0.x, std::min(p1.x, p2.x))) / LightCuller::TileSize, 0, amountOfTilesX - 1);
+			minTile.y = Clamp(int(std::min(p0.y, std::min(p1.y, p2.y))) / LightCuller::TileSize, 0, amountOfTilesY - 1);
+			maxTile.x = Clamp(int(std::max(p0.x, std::max(p1.x, p2.x))) / LightCuller::TileSize, 0, amountOfTilesX - 1);
+			maxTile.y = Clamp(int(std::max(p0.y, std::max(p1.y, p2.y))) / LightCuller::TileSize, 0, amountOfTilesY - 1);
+		};
+
+	//Count the triangles per tile, then fill in the compact lists
+	std::fill(m_TileTriangleCounts.begin(), m_TileTriangleCounts.end(), 0u);
+	for (const TransparentTriangle& triangle : m_TransparentTriangles) {
+		Int2 minTile{}, maxTile{};
+		getTileRange(triangle, minTile, maxTile);
+		for (int tileY{ minTile.y }; tileY <= maxTile.y; ++tileY) {
+			for (int tileX{ minTile.x }; tileX <= maxTile.x; ++tileX) {
+				++m_TileTriangleCounts[tileX + (tileY * amountOfTilesX)];
+			}
+		}
+	}
+
+	uint32_t totalCount{};
+	for (size_t tileIndex{}; tileIndex < m_TileTriangleCounts.size(); ++tileIndex) {
+		m_TileTriangleOffsets[tileIndex] = totalCount;
+		totalCount += m_TileTriangleCounts[tileIndex];
+		//Used as the fill position below, it is back to the count afterwards
+		m_TileTriangleCounts[tileIndex] = 0;
+	}
+	m_TileTriangleIndices.Resize(frameArena, totalCount);
+
+	for (uint32_t triangleIndex{}; triangleIndex < m_TransparentTriangles.size(); ++triangleIndex) {
+		Int2 minTile{}, maxTile{};
+		getTileRange(m_TransparentTriangles[triangleIndex], minTile, maxTile);
+		for (int tileY{ minTile.y }; tileY <= maxTile.y; ++tileY) {
+			for (int tileX{ minTile.x }; tileX <= maxTile.x; ++tileX) {
+				const int tileIndex = tileX + (tileY * amountOfTilesX);
+				m_TileTriangleIndices[m_TileTriangleOffsets[tileIndex] + m_TileTriangleCounts[tileIndex]] = triangleIndex;
+				++m_TileTriangleCounts[tileIndex];
+			}
 		}
 	}
-	return finalColor;
 }
 
+template<Renderer::Cullmode CullMode>
+void Renderer_Software::BlendTransparentTile(uint32_t tileIndex)
+{
+	constexpr int TileSize{ LightCuller::TileSize };
 
-void Renderer_Software::MeshVertexTransformationFunction(std::vector<Mesh_Software*>& pMeshes_in) const {
+	const uint32_t amountOfTriangles = m_TileTriangleCounts[tileIndex];
+	if (amountOfTriangles == 0) {
+		return;
+	}
+	const uint32_t* pTriangleIndices = m_TileTriangleIndices.data() + m_TileTriangleOffsets[tileIndex];
+
+	const int amountOfTilesX = m_pLightCuller->GetAmountOfTilesX();
+	const int startX = (tileIndex % amountOfTilesX) * TileSize;
+	const int startY = (tileIndex / amountOfTilesX) * TileSize;
+	const int endX = std::min(startX + TileSize, m_Width);
+	const int endY = std::min(startY + TileSize, m_Height);
+
+	//Scratch memory of this worker thread, released again when the tile is done
+	FrameArena& threadArena = m_pFrameAllocator->GetThreadArena();
+	const FrameArena::Marker threadArenaMarker = threadArena.GetMarker();
+
+	//Weighted sums of the transparent surfaces over every pixel of the tile, the sums are order independent
+	constexpr int AmountOfTilePixels{ TileSize * TileSize };
+	ColorRGB* accumulatedColor = threadArena.Allocate<ColorRGB>(AmountOfTilePixels);
+	float* accumulatedAlpha = threadArena.Allocate<float>(AmountOfTilePixels);
+	//Fraction of the background that is still visible
+	float* revealage = threadArena.Allocate<float>(AmountOfTilePixels);
+	std::fill_n(accumulatedColor, AmountOfTilePixels, ColorRGB{});
+	std::fill_n(accumulatedAlpha, AmountOfTilePixels, 0.f);
+	std::fill_n(revealage, AmountOfTilePixels, 1.f);
+
+	for (uint32_t i{}; i < amountOfTriangles; ++i) {
+		const TransparentTriangle& triangle = m_TransparentTriangles[pTriangleIndices[i]];
+		const Vertex_Out& vertex1 = triangle.vertices[0];
+		const Vertex_Out& vertex2 = triangle.vertices[1];
+		const Vertex_Out& vertex3 = triangle.vertices[2];
+		const Vector2 v0{ vertex1.position.x, vertex1.position.y };
+		const Vector2 v1{ vertex2.position.x, vertex2.position.y };
+		const Vector2 v2{ vertex3.position.x, vertex3.position.y };
+
+		//Bounding box, limited to the tile
+		const int minX = std::max(int(std::min(v0.x, std::min(v1.x, v2.x))), startX);
+		const int minY = std::max(int(std::min(v0.y, std::min(v1.y, v2.y))), startY);
+		const int maxX = std::min(int(std::max(v0.x, std::max(v1.x, v2.x))), endX - 1);
+		const int maxY = std::min(int(std::max(v0.y, std::max(v1.y, v2.y))), endY - 1);
+
+		for (int py{ minY }; py <= maxY; ++py) {
+			for (int px{ minX }; px <= maxX; ++px) {
+				const Vector2 pixelPoint{ static_cast<float>(px), static_cast<float>(py) };
+
+				float w2 = Vector2::Cross(v1 - v0, pixelPoint - v0);
+				float w0 = Vector2::Cross(v2 - v1, pixelPoint - v1);
+				float w1 = Vector2::Cross(v0 - v2, pixelPoint - v2);
+
+				bool pointInTriangle{};
+				if constexpr (CullMode == Cullmode::backFace) {
+					pointInTriangle = (w0 >= 0) && (w1 >= 0) && (w2 >= 0);
+				}
+				else if constexpr (CullMode == Cullmode::frontFace) {
+					pointInTriangle = (w0 <= 0) && (w1 <= 0) && (w2 <= 0);
+				}
+				else {
+					pointInTriangle = ((w0 >= 0 && w1 >= 0 && w2 >= 0) || (w0 <= 0 && w1 <= 0 && w2 <= 0));
+				}
+				if (!pointInTriangle) {
+					continue;
+				}
+
+				//Barycentric coordinates
+				const float totalArea = w0 + w1 + w2;
+				w0 /= totalArea;
+				w1 /= totalArea;
+				w2 /= totalArea;
+
+				//Depth test against the opaque meshes, without writing
+				const float interpolatedDepth{ 1.f / ((w0 / vertex1.position.z) + (w1 / vertex2.position.z) + (w2 / vertex3.position.z)) };
+				if (interpolatedDepth < 0 || interpolatedDepth > 1 || interpolatedDepth >= m_pDepthBufferPixels[px + (py * m_Width)]) {
+					continue;
+				}
+
+				const float interpolatedDepthW{ 1.f / ((w0 / vertex1.position.w) + (w1 / vertex2.position.w) + (w2 / vertex3.position.w)) };
+				Vector2 interpolatedUV = (vertex1.uv * w0 / vertex1.position.w + vertex2.uv * w1 / vertex2.position.w + vertex3.uv * w2 / vertex3.position.w);
+				interpolatedUV *= interpolatedDepthW;
+				if (interpolatedUV.x < 0 || interpolatedUV.x > 1 || interpolatedUV.y < 0 || interpolatedUV.y > 1) {
+					continue;
+				}
+
+				float alpha{};
+				const ColorRGB color = triangle.pMesh->pDiffuse->Sample(interpolatedUV, alpha);
+				if (alpha <= 0.f) {
+					continue;
+				}
+
+				//Depth weight from McGuire and Bavoil, closer surfaces weigh more so they dominate the average color
+				const float scaledDepth = interpolatedDepthW / 5.f;
+				const float farDepth = interpolatedDepthW / 200.f;
+				const float farDepthCubed = farDepth * farDepth * farDepth;
+				const float weight = alpha * Clamp(10.f / (1e-5f + scaledDepth * scaledDepth + farDepthCubed * farDepthCubed), 1e-2f, 3e3f);
+
+				const int tilePixelIndex = (px - startX) + ((py - startY) * TileSize);
+				accumulatedColor[tilePixelIndex] += color * (alpha * weight);
+				accumulatedAlpha[tilePixelIndex] += alpha * weight;
+				revealage[tilePixelIndex] *= 1.f - alpha;
+			}
+		}
+	}
+
+	//Composite the weighted average over the opaque color
+	for (int py{ startY }; py < endY; ++py) {
+		for (int px{ startX }; px < endX; ++px) {
+			const int tilePixelIndex = (px - startX) + ((py - startY) * TileSize);
+			if (revealage[tilePixelIndex] >= 1.f) {
+				continue;
+			}
+
+			uint32_t& backBufferPixel = m_pBackBufferPixels[px + (py * m_Width)];
+			uint8_t r{}, g{}, b{};
+			UnpackColor(backBufferPixel, r, g, b);
+			const ColorRGB opaqueColor = ColorRGB{ float(r), float(g), float(b) } / 255.f;
+
+			const ColorRGB averageColor = accumulatedColor[tilePixelIndex] / std::max(accumulatedAlpha[tilePixelIndex], 1e-5f);
+			ColorRGB finalColor = averageColor * (1.f - revealage[tilePixelIndex]) + opaqueColor * revealage[tilePixelIndex];
+			finalColor.MaxToOne();
+
+			backBufferPixel = PackColor(
+				static_cast<uint8_t>(finalColor.r * 255),
+				static_cast<uint8_t>(finalColor.g * 255),
+				static_cast<uint8_t>(finalColor.b * 255));
+		}
+	}
+
+	threadArena.Rewind(threadArenaMarker);
+}
+
+void Renderer_Software::CullInstances(std::vector<Mesh_Software*>& pMeshes_in) const {
+	const Frustum frustum = Frustum::FromViewProjection(m_pCamera->viewMatrix * m_pCamera->projectionMatrix);
 	for (auto pSoftwareMesh : pMeshes_in) {
 		Mesh* pMesh = pSoftwareMesh->internalMesh;
-		Matrix worldViewProjectionMatrix = pMesh->worldMatrix * m_pCamera->viewMatrix * m_pCamera->projectionMatrix;
-		//clear the current vertices_out
-		pSoftwareMesh->vertices_out.clear();
-		for (const Vertex_In& vertex : pMesh->vertices) {
-			//make sure w is initialised as 1
-			Vector4 position{ vertex.position, 1 };
+		pSoftwareMesh->visibleInstances.Reserve(m_pFrameAllocator->GetSharedArena(), pMesh->instances.size());
+		//Instances added since the last frame start at full detail
+		pSoftwareMesh->currentLODs.resize(pMesh->instances.size());
+		uint32_t firstVertex{};
+		for (uint32_t instanceIndex{}; instanceIndex < pMesh->instances.size(); ++instanceIndex) {
+			//Sphere first, it is the cheaper test
+			const MeshInstance& instance = pMesh->instances[instanceIndex];
+			if (!frustum.IsVisible(instance.worldSphere) || !frustum.IsVisible(instance.worldBox)) {
+				continue;
+			}
 
-			Vector4 transformedVertexPos = worldViewProjectionMatrix.TransformPoint(position);
+			const uint32_t lod = SelectLOD(pMesh, instance, pSoftwareMesh->currentLODs[instanceIndex]);
+			pSoftwareMesh->visibleInstances.push_back(VisibleInstance{ instanceIndex, lod, firstVertex });
+			firstVertex += static_cast<uint32_t>(pMesh->GetAmountOfVertices(lod));
+		}
+	}
+}
 
-			//perspective divide
-			transformedVertexPos.x /= transformedVertexPos.w;
-			transformedVertexPos.y /= transformedVertexPos.w;
-			transformedVertexPos.z /= transformedVertexPos.w;
+uint32_t Renderer_Software::SelectLOD(const Mesh* pMesh, const MeshInstance& instance, uint32_t& currentLOD) const {
+	const uint32_t amountOfLODs = pMesh->GetAmountOfLODs();
+	if (amountOfLODs == 1 || instance.localSphere.radius <= 0.f) {
+		return 0;
+	}
 
-			//transform the normals in world space and normalize again
-			Vector3 transformedNormal = pMesh->worldMatrix.TransformVector(vertex.normal);
-			transformedNormal.Normalize();
-			Vector3 transformedTangent = pMesh->worldMatrix.TransformVector(vertex.tangent);
-			transformedTangent.Normalize();
+	//Pixels covered by one object space unit at the closest point of the instance
+	const float distance = std::max((instance.worldSphere.center - m_pCamera->origin).Magnitude() - instance.worldSphere.radius, m_pCamera->nearPlane);
+	const float worldScale = instance.worldSphere.radius / instance.localSphere.radius;
+	const float pixelsPerUnit = worldScale * static_cast<float>(m_Height) * 0.5f / (distance * m_pCamera->fov);
 
-			//calculate the view direction
-			Vector3 vertexWorldPosition = pMesh->worldMatrix.TransformPoint(vertex.position);
-			Vector3 viewDirection{ m_pCamera->origin - vertexWorldPosition };
+	//Go to a finer level as soon as the error gets visible, only go coarser again when it is clearly below the limit
+	//The gap between both keeps an instance near the switching distance from flickering between two levels
+	uint32_t lod = std::min(currentLOD, amountOfLODs - 1);
+	while (lod > 0 && pMesh->GetLODError(lod) * pixelsPerUnit > MaxLODPixelError) {
+		--lod;
+	}
+	while (lod + 1 < amountOfLODs && pMesh->GetLODError(lod + 1) * pixelsPerUnit < MaxLODPixelError * LODHysteresis) {
+		++lod;
+	}
+	currentLOD = lod;
+	return lod;
+}
+
+void Renderer_Software::CullMeshlets(std::vector<Mesh_Software*>& pMeshes_in) const {
+	const Matrix viewProjectionMatrix = m_pCamera->viewMatrix * m_pCamera->projectionMatrix;
+	//The normal cones only describe back faces, the other cull modes only use the spheres
+	const bool canCullBackFaces = m_CurrentCullmode == Cullmode::backFace;
+
+	for (auto pSoftwareMesh : pMeshes_in) {
+		const Mesh* pMesh = pSoftwareMesh->internalMesh;
+		pSoftwareMesh->visibleMeshlets.clear();
 
-			Vertex_Out transformedVertex{ transformedVertexPos, vertex.uv, transformedNormal, transformedTangent, viewDirection };
-			pSoftwareMesh->vertices_out.emplace_back(transformedVertex);
+		//At most every meshlet of every visible instance
+		size_t maxAmountOfMeshlets{};
+		for (const VisibleInstance& visibleInstance : pSoftwareMesh->visibleInstances) {
+			maxAmountOfMeshlets += pMesh->GetMeshlets(visibleInstance.lod).size();
+		}
+		pSoftwareMesh->visibleMeshlets.Reserve(m_pFrameAllocator->GetSharedArena(), maxAmountOfMeshlets);
+
+		for (uint32_t instanceSlot{}; instanceSlot < pSoftwareMesh->visibleInstances.size(); ++instanceSlot) {
+			//Test in object space, so the meshlet bounds don't have to be transformed
+			const VisibleInstance& visibleInstance = pSoftwareMesh->visibleInstances[instanceSlot];
+			const Matrix& worldMatrix = pMesh->instances[visibleInstance.instanceIndex].worldMatrix;
+			const Frustum objectFrustum = Frustum::FromViewProjection(worldMatrix * viewProjectionMatrix);
+			const Vector3 objectCameraPosition = Matrix::InverseAffine(worldMatrix).TransformPoint(m_pCamera->origin);
+
+			const std::vector<Meshlet>& meshlets = pMesh->GetMeshlets(visibleInstance.lod);
+			for (uint32_t meshletIndex{}; meshletIndex < meshlets.size(); ++meshletIndex) {
+				const Meshlet& meshlet = meshlets[meshletIndex];
+				if (canCullBackFaces && MeshletUtils::IsBackFacing(meshlet, objectCameraPosition)) {
+					continue;
+				}
+				if (!objectFrustum.IsVisible(meshlet.sphere)) {
+					continue;
+				}
+				pSoftwareMesh->visibleMeshlets.push_back(VisibleMeshlet{ instanceSlot, meshletIndex });
+			}
 		}
 	}
 }
 
+void Renderer_Software::MeshVertexTransformationFunction(std::vector<Mesh_Software*>& pMeshes_in) const {
+	const Matrix viewProjectionMatrix = m_pCamera->viewMatrix * m_pCamera->projectionMatrix;
+	for (auto pSoftwareMesh : pMeshes_in) {
+		Mesh* pMesh = pSoftwareMesh->internalMesh;
+		//All visible instances of a mesh are transformed in one batch, every visible instance owns the vertices of its level of detail starting at firstVertex
+		const uint32_t amountOfInstances = static_cast<uint32_t>(pSoftwareMesh->visibleInstances.size());
+		size_t amountOfVertices{};
+		if (amountOfInstances > 0) {
+			const VisibleInstance& lastInstance = pSoftwareMesh->visibleInstances.back();
+			amountOfVertices = lastInstance.firstVertex + pMesh->GetAmountOfVertices(lastInstance.lod);
+		}
+		pSoftwareMesh->vertices_out.Resize(m_pFrameAllocator->GetSharedArena(), amountOfVertices);
+		WorldSpaceCache::MeshEntries& meshEntries = m_pWorldSpaceCache->PrepareMesh(pMesh);
+
+		ParallelFor(0u, amountOfInstances, [=, this, &meshEntries](uint32_t instanceSlot)
+			{
+				const VisibleInstance& visibleInstance = pSoftwareMesh->visibleInstances[instanceSlot];
+				const size_t amountOfInstanceVertices = pMesh->GetAmountOfVertices(visibleInstance.lod);
+				if (amountOfInstanceVertices == 0) {
+					return;
+				}
+
+				//Transformed by the first renderer that draws the instance after it moved
+				const std::vector<WorldVertex>& worldVertices = m_pWorldSpaceCache->GetVertices(meshEntries, pMesh, visibleInstance.instanceIndex, visibleInstance.lod);
+
+				//Only the camera dependent part is done every frame
+				Vertex_Out* pVerticesOut = pSoftwareMesh->vertices_out.data() + visibleInstance.firstVertex;
+				//The positions get a w of 1 and are projected in one batch
+				viewProjectionMatrix.TransformPoints(&worldVertices[0].position, &pVerticesOut[0].position, amountOfInstanceVertices, sizeof(WorldVertex), sizeof(Vertex_Out));
+				//The UVs don't depend on the instance, quantized ones are decoded straight into the output
+				if (pMesh->isQuantized) {
+					VertexQuantization::DecodeUVs(pMesh->GetQuantizedVertices(visibleInstance.lod).data(), &pVerticesOut[0].uv, amountOfInstanceVertices, sizeof(Vertex_Out));
+				}
+				else {
+					const std::vector<Vertex_In>& vertices = pMesh->GetVertices(visibleInstance.lod);
+					for (size_t i{}; i < amountOfInstanceVertices; ++i) {
+						pVerticesOut[i].uv = vertices[i].uv;
+					}
+				}
+				for (size_t i{}; i < amountOfInstanceVertices; ++i) {
+					const WorldVertex& worldVertex = worldVertices[i];
+					Vertex_Out& vertexOut = pVerticesOut[i];
+
+					//perspective divide
+					vertexOut.position.x /= vertexOut.position.w;
+					vertexOut.position.y /= vertexOut.position.w;
+					vertexOut.position.z /= vertexOut.position.w;
+
+					vertexOut.normal = worldVertex.normal;
+					vertexOut.tangent = worldVertex.tangent;
+					//calculate the view direction
+					vertexOut.viewDirection = m_pCamera->origin - worldVertex.position;
+					vertexOut.worldPosition = worldVertex.position;
+				}
+			}
+		);
+	}
+}
+
 void Renderer_Software::CycleLightingMode() {
 	switch (m_CurrentShadingMode)
 	{
@@ -484,6 +1751,11 @@ void Renderer_Software::CycleLightingMode() {
 	}
 }
 
+void Renderer_Software::SetShadingPrecision(MathPrecision precision)
+{
+	m_ShadingPrecision = precision;
+}
+
 void Renderer_Software::ToggleBoundingBox()
 {
 	m_CanRenderBoundingBox = !m_CanRenderBoundingBox;
@@ -2,12 +2,25 @@
 #include "Renderer.h"
 #include "DataTypes.h"
 #include "Texture.h"
+#include "LightCuller.h"
+#include "MathSIMD.h"
+#include "FrameArena.h"
+#include "WorldSpaceCache.h"
+#include "ShadowMap.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
 
 struct SDL_Surface;
 
 class Renderer_Software final: public Renderer{
 public:
+#if !defined(DAE_SOFTWARE_ONLY)
 	Renderer_Software(SDL_Window* pWindow, dae::Camera* pCamera, std::vector<Mesh*>& pMeshes);
+#endif
+	//Renders into memory only, read the image with GetPixels
+	Renderer_Software(int width, int height, dae::Camera* pCamera, std::vector<Mesh*>& pMeshes);
 	virtual ~Renderer_Software() override;
 
 	//Rule of 5
@@ -28,38 +41,273 @@ public:
 		Combined,
 	};
 
+	//Every state that changes the image, to put the renderer in a known state at once
+	struct RenderStates
+	{
+		ShadingMode shadingMode{ ShadingMode::Combined };
+		Cullmode cullmode{ Cullmode::backFace };
+		bool renderDepthBuffer{ false };
+		bool useNormalMap{ true };
+		bool renderBoundingBox{ false };
+		bool renderFire{ true };
+		bool useUniformClearColor{ false };
+		//The first directional light casts shadows of the opaque meshes
+		bool renderShadows{ false };
+		//Width in texels of the square shadow filter, odd, 1 gives hard edges
+		int shadowFilterSize{ 3 };
+	};
+	void SetRenderStates(const RenderStates& states);
+
 	void ToggleDepthBuffer();
 	void ToggleRotation();
 	void ToggleNormalMap();
-	bool SaveBufferToImage() const;
+	void ToggleShadows();
+	//Steps through the filter sizes 1, 3, 5 and 7
+	void CycleShadowFilterSize();
+#if !defined(DAE_SOFTWARE_ONLY)
+	//True when the image couldn't be saved
+	bool SaveBufferToImage(const std::string& path = "Rasterizer_ColorBuffer.bmp") const;
+	//Image of the last drawn frame
+	const SDL_Surface* GetBackBuffer() const;
+#endif
+	//Image of the last drawn frame, GetWidth * GetHeight pixels of 0xAARRGGBB without padding
+	const uint32_t* GetPixels() const;
+	int GetWidth() const;
+	int GetHeight() const;
 	void CycleLightingMode();
 	void ToggleBoundingBox();
 	bool CanRotate();
+	void ToggleFire();
+	bool CanRenderFire();
+
+	//Fast trades a tiny bit of accuracy in normalize and pow for shading throughput
+	void SetShadingPrecision(dae::MathPrecision precision);
+
+	//Point lights only light the tiles they reach, so many small lights stay cheap
+	void AddPointLight(const Vector3& origin, const ColorRGB& color, float intensity, float range);
+
+	//High water marks of the frame arenas
+	void PrintFrameMemory() const;
+
+	//Reuses the shading of last frame for pixels that are still visible after a camera move
+	//Off by default, the reprojection and the checks cost about as much as the shading they save in the vehicle scene
+	//It only pays off when the shading is expensive, with many lights per tile or the large shadow filters
+	void ToggleTemporalCache();
+	bool IsTemporalCacheEnabled() const;
+	//Share of the pixels that reused last frame in the last drawn frame
+	void PrintTemporalCacheStatistics() const;
+
+	//Renderers that draw the same meshes can share the world space vertices, every renderer starts with a cache of its own
+	void SetWorldSpaceCache(const std::shared_ptr<WorldSpaceCache>& pWorldSpaceCache);
+	//Renderers that draw the same meshes with the same light can share the shadow map, every renderer starts without one
+	void SetShadowMap(const std::shared_ptr<ShadowMap>& pShadowMap);
+
+	static constexpr int ShadowMapResolution{ 1024 };
+
+	//True when nothing changed since the last frame, so the last Render didn't draw anything
+	bool WasFrameSkipped() const;
+	//Redraws everything in the next frame, for when the window lost its contents
+	void InvalidateFrame();
+	//Stage times and counts of the last call of Render
+	const FrameStatistics& GetFrameStatistics() const;
 
 private:
 	//Window in base class
 
 	SDL_Surface* m_pFrontBuffer{ nullptr };
+	//Wraps the back buffer pixels for SDL, null without SDL
 	SDL_Surface* m_pBackBuffer{ nullptr };
 	uint32_t* m_pBackBufferPixels{};
 
 	float* m_pDepthBufferPixels{};
+	GBufferPixel* m_pGBufferPixels{};
 
 	//Camera and base meshes in base class
 	std::vector<Mesh_Software*> m_pSoftwareMeshes{};
+	//Drawn after the opaque meshes, blended with weighted blended order independent transparency
+	std::vector<Mesh_Software*> m_pTransparentMeshes{};
 	std::vector<Light*> m_pLights{};
+	LightCuller* m_pLightCuller{};
+	//All the data that only lives for one frame, reset at the end of every frame
+	FrameAllocator* m_pFrameAllocator{};
+	//Only the camera dependent part of the vertex transform is redone for static instances
+	std::shared_ptr<WorldSpaceCache> m_pWorldSpaceCache{};
 
 	bool m_RenderDepthBuffer{};
 	bool m_CanUseNormalMap{ true };
 	bool m_CanRenderBoundingBox{ false };
+	bool m_CanRenderFire{ true };
+	bool m_RenderShadows{ false };
+	int m_ShadowFilterSize{ 3 };
+
+	//Made with the first frame that has shadows, it is only drawn again when the light or a caster changed
+	std::shared_ptr<ShadowMap> m_pShadowMap{};
+	//Light the shadow map belongs to in this frame, null when nothing is shadowed
+	const Light* m_pShadowLight{};
+	static constexpr int MaxShadowFilterSize{ 7 };
 
 	ShadingMode m_CurrentShadingMode{ ShadingMode::Combined };
 
+	//Frames are only drawn when something that affects the image changed
+	//When only some instances moved, only the tiles they covered before and cover now are redrawn
+	enum class FrameChange
+	{
+		None,
+		Partial,
+		Full
+	};
+	uint64_t m_RenderedStateHash{};
+	bool m_IsFrameValid{};
+	bool m_WasFrameSkipped{};
+	//Region that is redrawn this frame, in tiles and in pixels, the maximum is exclusive
+	dae::Int2 m_DirtyTileMin{};
+	dae::Int2 m_DirtyTileMax{};
+	dae::Int2 m_DirtyMin{};
+	dae::Int2 m_DirtyMax{};
+	FrameStatistics m_FrameStatistics{};
+
+	//Shaded color of a pixel, what a later frame needs to check that it sees the same surface is in the GBuffer of this frame
+	struct HistoryPixel
+	{
+		uint32_t color;
+		//How far, in pixels, the surface point the color was shaded at is from the pixel
+		//Reused colors come from the nearest pixel of last frame, this keeps that error from adding up
+		dae::Vector2 offset;
+	};
+
+	//Temporal cache, the history of last frame is read while the history of this frame is written
+	//It is only filled in full redraws, any other frame makes it invalid
+	//Off by default, see ToggleTemporalCache
+	bool m_UseTemporalCache{};
+	//GBuffer of the frame that wrote the history, swapped with the GBuffer after every frame that writes history
+	GBufferPixel* m_pHistoryGBufferPixels{};
+	HistoryPixel* m_pHistoryPixels[2]{};
+	int m_HistoryWriteIndex{};
+	bool m_IsHistoryValid{};
+	bool m_ShouldWriteHistory{};
+	bool m_CanReuseHistory{};
+	bool m_HaveInstancesMoved{};
+	//The shading of last frame only carries over when nothing besides the camera changed
+	uint64_t m_HistoryStateHash{};
+	//Camera of the frame that wrote the history that is read
+	dae::Matrix m_HistoryViewProjectionMatrix{};
+	uint32_t m_TemporalFrameIndex{};
+	std::atomic<uint32_t> m_ReusedPixels{};
+	std::atomic<uint32_t> m_ShadedPixels{};
+
+	//Every frame one in this many pixels is shaded again
+	static constexpr int TemporalRefreshInterval{ 8 };
+	//Largest difference in view depth, relative to the depth, for a history pixel to show the same surface
+	static constexpr float HistoryDepthTolerance{ 0.01f };
+	//Smallest cosine between the normals of a pixel and its history pixel
+	static constexpr float HistoryNormalTolerance{ 0.95f };
+	//Largest distance in pixels between a reused color and the surface point it was shaded at
+	static constexpr float MaxHistoryOffset{ 0.5f };
+
+	//Largest error of a level of detail on screen, in pixels
+	//The error of a level is an average distance, single vertices can move further, so this is kept at one pixel
+	static constexpr float MaxLODPixelError{ 1.f };
+	//A coarser level is only picked once its error drops below this fraction of the limit
+	static constexpr float LODHysteresis{ 0.75f };
+	dae::MathPrecision m_ShadingPrecision{ dae::MathPrecision::Fast };
+
+	//GBuffer data of a batch of pixels, one pixel per lane
+	struct ShadingInputN
+	{
+		dae::FloatN depth;
+		dae::Vector2N uv;
+		dae::Vector3N normal;
+		dae::Vector3N tangent;
+		dae::Vector3N viewDirection;
+		dae::Vector3N worldPosition;
+		dae::MaskN canBeShaded;
+		const Mesh_Software* pMeshes[dae::FloatN::Width];
+		//Lanes that have geometry
+		int coveredBits;
+	};
+
+	//Transparent triangle in raster space, binned into every light culling tile it overlaps
+	struct TransparentTriangle
+	{
+		Vertex_Out vertices[3];
+		const Mesh_Software* pMesh;
+	};
+
+	FrameVector<TransparentTriangle> m_TransparentTriangles{};
+	//Compact triangle lists, tile i uses m_TileTriangleCounts[i] indices starting at m_TileTriangleOffsets[i]
+	std::vector<uint32_t> m_TileTriangleOffsets{};
+	std::vector<uint32_t> m_TileTriangleCounts{};
+	FrameVector<uint32_t> m_TileTriangleIndices{};
+
+	//Kernels specialized on the render states, selected once per frame
+	using RenderTriangleFunction = void (Renderer_Software::*)(const RasterTarget&, const Vertex_Out&, const Vertex_Out&, const Vertex_Out&, Mesh_Software*);
+	using ShadeTileFunction = void (Renderer_Software::*)(uint32_t);
+
+	RenderTriangleFunction m_pRenderTriangle{};
+	//Depth buffer and dirty region of the screen, for the kernel of this frame
+	RasterTarget m_ScreenTarget{};
+	ShadeTileFunction m_pShadeTile{};
+	ShadeTileFunction m_pBlendTransparentTile{};
+
+	void SelectKernels();
+
+	//Buffers, lights and meshes, shared by both constructors
+	void Initialize(const std::vector<Mesh*>& pMeshes);
+	//Opaque 0xAARRGGBB, the format of the back buffer
+	static uint32_t PackColor(uint8_t r, uint8_t g, uint8_t b);
+	static void UnpackColor(uint32_t color, uint8_t& r, uint8_t& g, uint8_t& b);
+
+	FrameChange DetectChanges();
+	//Hash of everything besides the instance transforms that affects the image: camera, lights and render states
+	uint64_t CalculateStateHash(bool includeCamera = true) const;
+	//Decides if this frame reads and writes the temporal cache
+	void PrepareHistory(FrameChange frameChange);
+	//Grows the rect with the screen area of a world space box, false if the box reaches behind the camera
+	bool AddScreenRect(const dae::AABB& box, dae::Int2& min, dae::Int2& max) const;
+	//Snaps the pixel rect to whole tiles, false if nothing of it is on screen
+	bool SetDirtyRegion(const dae::Int2& min, const dae::Int2& max);
+	//Runs over the tiles of the dirty region
+	template<typename Function>
+	void ForEachDirtyTile(const Function& function) const;
+
+	//Fills in the frame time and the thread utilization at the end of Render
+	void EndFrameStatistics(std::chrono::steady_clock::time_point frameStart, uint64_t busyTimeStart);
 	void Render_Meshes();
-	void RenderTriangle(const Vertex_Out& vertex1, const Vertex_Out& vertex2, const Vertex_Out& vertex3, Mesh_Software* pSoftwareMesh);
+	//Draws the shadow map again when the shadow light or a caster changed
+	void UpdateShadowMap();
+	//Shared by the list and strip paths, culls the triangle against the sides of the screen and moves it to raster space
+	void RenderNDCTriangle(Vertex_Out vertex1, Vertex_Out vertex2, Vertex_Out vertex3, Mesh_Software* pSoftwareMesh);
+	//DepthOnly only fills the depth of the target, for the shadow map, the mesh can be null and the depth is interpolated linearly
+	template<bool RenderBoundingBox, Cullmode CullMode, bool DepthOnly>
+	void RenderTriangle(const RasterTarget& target, const Vertex_Out& vertex1, const Vertex_Out& vertex2, const Vertex_Out& vertex3, Mesh_Software* pSoftwareMesh);
+
+	//Shades every pixel in the GBuffer, tile by tile with the culled lights of that tile
+	void ShadePixels();
+	template<bool RenderDepth, bool UseNormalMap, ShadingMode Mode, dae::MathPrecision Precision>
+	void ShadeTile(uint32_t tileIndex);
+	//The pixels have to be covered, lanes past the amount of pixels stay empty
+	void GatherShadingInput(const int* pPixelIndices, int amountOfPixels, ShadingInputN& input) const;
+	//Fills the colors of the candidate lanes that pass the checks from the history of last frame, returns those lanes
+	int ReuseHistory(int batchX, int py, int candidateBits, uint32_t* pColors, dae::Vector2* pOffsets) const;
+	//Fraction of the shadow filter of every active lane that the shadow light reaches
+	dae::FloatN SampleShadowLanes(const ShadingInputN& input, const dae::Vector3N& normal, int activeBits) const;
+	static dae::ColorRGBN SampleLanes(const ShadingInputN& input, dae::Texture* Mesh_Software::* pTexture, int activeBits);
+	template<bool UseNormalMap, ShadingMode Mode, dae::MathPrecision Precision>
+	dae::ColorRGBN PixelShading(const ShadingInputN& input, const uint32_t* pLightIndices, uint32_t amountOfLights) const;
 
-	ColorRGB PixelShading(const Vertex_Out& vertex, Mesh_Software* pMesh);
+	//Blends the transparent meshes over the shaded opaque pixels, tile by tile
+	//Depth is tested against the opaque meshes but never written, so no sorting of the triangles is needed
+	void RenderTransparentMeshes();
+	void BinTransparentTriangles();
+	template<Cullmode CullMode>
+	void BlendTransparentTile(uint32_t tileIndex);
 
+	//Fills the visible instances of every mesh with a frustum test on their bounds, and picks their level of detail
+	void CullInstances(std::vector<Mesh_Software*>& meshes_in) const;
+	//Coarsest level whose error projects to less than MaxLODPixelError, with hysteresis against the level of last frame
+	uint32_t SelectLOD(const Mesh* pMesh, const MeshInstance& instance, uint32_t& currentLOD) const;
+	//Fills the visible meshlets of every visible instance, uses the normal cones when back faces are culled
+	void CullMeshlets(std::vector<Mesh_Software*>& meshes_in) const;
 	//Function that transforms the vertices from the mesh from World space to Screen space
 	void MeshVertexTransformationFunction(std::vector<Mesh_Software*>& meshes_in) const;
 };
@@ -0,0 +1,237 @@
+#include "pch.h"
+#include "ShadowMap.h"
+#include "Parallel.h"
+
+using namespace dae;
+
+ShadowMap::ShadowMap(int resolution) :
+	m_Resolution{ resolution }
+{
+	m_pDepthPixels = new float[m_Resolution * m_Resolution];
+}
+
+ShadowMap::~ShadowMap()
+{
+	delete[] m_pDepthPixels;
+	m_pDepthPixels = nullptr;
+}
+
+bool ShadowMap::Update(const Light* pLight, const std::vector<Mesh_Software*>& pCasters, WorldSpaceCache& worldSpaceCache, const DrawFunction& draw)
+{
+	std::lock_guard<std::mutex> lock{ m_UpdateMutex };
+	const uint64_t hash = CalculateHash(pLight, pCasters);
+	if (m_IsValid && hash == m_RenderedHash) {
+		return false;
+	}
+	m_RenderedHash = hash;
+	m_IsValid = true;
+
+	CalculateProjection(pLight->direction.Normalized(), pCasters);
+	std::fill_n(m_pDepthPixels, m_Resolution * m_Resolution, FLT_MAX);
+
+	//Every caster instance gets its own range of vertices, in raster space of the map
+	m_CasterInstances.clear();
+	uint32_t amountOfVertices{};
+	for (const auto pSoftwareMesh : pCasters) {
+		const Mesh* pMesh = pSoftwareMesh->internalMesh;
+		for (size_t instanceIndex{}; instanceIndex < pMesh->instances.size(); ++instanceIndex) {
+			m_CasterInstances.push_back(CasterInstance{ amountOfVertices, &pMesh->GetIndices(0) });
+			amountOfVertices += static_cast<uint32_t>(pMesh->GetAmountOfVertices(0));
+		}
+	}
+	m_ShadowVertices.resize(amountOfVertices);
+
+	uint32_t casterIndex{};
+	for (const auto pSoftwareMesh : pCasters) {
+		const Mesh* pMesh = pSoftwareMesh->internalMesh;
+		WorldSpaceCache::MeshEntries& meshEntries = worldSpaceCache.PrepareMesh(pMesh);
+		const uint32_t amountOfInstances = static_cast<uint32_t>(pMesh->instances.size());
+		ParallelFor(0u, amountOfInstances, [=, this, &meshEntries, &worldSpaceCache](uint32_t instanceIndex)
+			{
+				//The instances the camera sees are already transformed by the main pass of this frame
+				const std::vector<WorldVertex>& worldVertices = worldSpaceCache.GetVertices(meshEntries, pMesh, instanceIndex, 0);
+				if (worldVertices.empty()) {
+					return;
+				}
+				const CasterInstance& casterInstance = m_CasterInstances[casterIndex + instanceIndex];
+				m_WorldToRaster.TransformPoints(&worldVertices[0].position, &m_ShadowVertices[casterInstance.firstVertex].position, worldVertices.size(), sizeof(WorldVertex), sizeof(Vertex_Out));
+			}
+		);
+		casterIndex += amountOfInstances;
+	}
+
+	const int amountOfBands = (m_Resolution + BandHeight - 1) / BandHeight;
+	BinTriangles(amountOfBands);
+	ParallelFor(0, amountOfBands, [this, &draw](int bandIndex)
+		{
+			const int startY = bandIndex * BandHeight;
+			const RasterTarget target{ m_pDepthPixels, m_Resolution, Int2{ 0, startY }, Int2{ m_Resolution, std::min(startY + BandHeight, m_Resolution) } };
+			const uint32_t firstTriangle = m_BandStarts[bandIndex];
+			draw(target, m_ShadowVertices.data(), m_BandTriangles.data() + 3 * static_cast<size_t>(firstTriangle), m_BandStarts[bandIndex + 1] - firstTriangle);
+		}
+	);
+	return true;
+}
+
+float ShadowMap::SampleVisibility(const Vector3& worldPosition, const Vector3& normal, int filterSize) const
+{
+	const Vector3 shadowPosition = m_ViewProjection.TransformPoint(worldPosition + normal * (NormalOffset * m_TexelSize));
+	const float depth = shadowPosition.z - DepthBias * m_TexelSize * m_DepthScale;
+	//Texel that contains the point, from NDC space
+	const float resolution = static_cast<float>(m_Resolution);
+	const int centerX = static_cast<int>(std::floor((shadowPosition.x + 1.f) * 0.5f * resolution));
+	const int centerY = static_cast<int>(std::floor((1.f - shadowPosition.y) * 0.5f * resolution));
+	const int radius = filterSize / 2;
+
+	//Percentage closer filtering, every texel is tested on its own and the results are averaged
+	int amountLit{};
+	for (int y{ centerY - radius }; y <= centerY + radius; ++y) {
+		for (int x{ centerX - radius }; x <= centerX + radius; ++x) {
+			//Outside of the map there are no casters
+			if (x < 0 || y < 0 || x >= m_Resolution || y >= m_Resolution || depth <= m_pDepthPixels[x + (y * m_Resolution)]) {
+				++amountLit;
+			}
+		}
+	}
+	const int amountOfSamples = (2 * radius + 1) * (2 * radius + 1);
+	return static_cast<float>(amountLit) / static_cast<float>(amountOfSamples);
+}
+
+int ShadowMap::GetResolution() const
+{
+	return m_Resolution;
+}
+
+uint64_t ShadowMap::CalculateHash(const Light* pLight, const std::vector<Mesh_Software*>& pCasters)
+{
+	//FNV-1a
+	uint64_t hash{ 14695981039346656037ull };
+	auto add = [&hash](const auto& value)
+		{
+			const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(&value);
+			for (size_t i{}; i < sizeof(value); ++i) {
+				hash ^= pBytes[i];
+				hash *= 1099511628211ull;
+			}
+		};
+
+	add(pLight->direction);
+	for (const auto pSoftwareMesh : pCasters) {
+		const Mesh* pMesh = pSoftwareMesh->internalMesh;
+		add(pMesh);
+		add(pMesh->instances.size());
+		for (const MeshInstance& instance : pMesh->instances) {
+			add(instance.worldVersion);
+		}
+	}
+	return hash;
+}
+
+void ShadowMap::BinTriangles(int amountOfBands)
+{
+	//Triangle with the bands it overlaps, counted first so every band gets one range of the list
+	struct BinnedTriangle
+	{
+		uint32_t vertices[3]{};
+		int firstBand{};
+		int lastBand{};
+	};
+	size_t amountOfTriangles{};
+	for (const CasterInstance& casterInstance : m_CasterInstances) {
+		amountOfTriangles += casterInstance.pIndices->GetAmountOfIndices() / 3;
+	}
+	std::vector<BinnedTriangle> triangles{};
+	triangles.reserve(amountOfTriangles);
+	m_BandStarts.assign(static_cast<size_t>(amountOfBands) + 1, 0);
+
+	for (const CasterInstance& casterInstance : m_CasterInstances) {
+		const IndexBuffer& indices = *casterInstance.pIndices;
+		const size_t amountOfIndices = indices.GetAmountOfIndices();
+		//Compiled for 16 and 32 bit indices
+		indices.Visit([&](const auto* pIndices)
+			{
+				for (size_t i{}; i + 2 < amountOfIndices; i += 3) {
+					BinnedTriangle triangle{ { casterInstance.firstVertex + pIndices[i], casterInstance.firstVertex + pIndices[i + 1], casterInstance.firstVertex + pIndices[i + 2] } };
+					const float y1 = m_ShadowVertices[triangle.vertices[0]].position.y;
+					const float y2 = m_ShadowVertices[triangle.vertices[1]].position.y;
+					const float y3 = m_ShadowVertices[triangle.vertices[2]].position.y;
+					//Same rows as the bounding box of the rasterizer
+					const int minY = int(std::min(y1, std::min(y2, y3)));
+					const int maxY = int(std::max(y1, std::max(y2, y3)));
+					if (maxY < 0 || minY >= m_Resolution) {
+						continue;
+					}
+					triangle.firstBand = std::max(minY, 0) / BandHeight;
+					triangle.lastBand = std::min(maxY, m_Resolution - 1) / BandHeight;
+					for (int band{ triangle.firstBand }; band <= triangle.lastBand; ++band) {
+						++m_BandStarts[band + 1];
+					}
+					triangles.push_back(triangle);
+				}
+			});
+	}
+
+	for (int band{}; band < amountOfBands; ++band) {
+		m_BandStarts[band + 1] += m_BandStarts[band];
+	}
+	m_BandTriangles.resize(3 * static_cast<size_t>(m_BandStarts[amountOfBands]));
+	//The triangles keep their order within a band, so the depth ties resolve like before
+	std::vector<uint32_t> nextTriangles(m_BandStarts.begin(), m_BandStarts.end() - 1);
+	for (const BinnedTriangle& triangle : triangles) {
+		for (int band{ triangle.firstBand }; band <= triangle.lastBand; ++band) {
+			std::copy_n(triangle.vertices, 3, &m_BandTriangles[3 * static_cast<size_t>(nextTriangles[band]++)]);
+		}
+	}
+}
+
+void ShadowMap::CalculateProjection(const Vector3& lightDirection, const std::vector<Mesh_Software*>& pCasters)
+{
+	//Axes of the light, any up works as long as it isn't the light direction itself
+	const Vector3 up = std::abs(lightDirection.y) < 0.99f ? Vector3::UnitY : Vector3::UnitZ;
+	const Vector3 right = Vector3::Cross(up, lightDirection).Normalized();
+	const Vector3 lightUp = Vector3::Cross(lightDirection, right);
+
+	Vector3 min{ FLT_MAX, FLT_MAX, FLT_MAX };
+	Vector3 max{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (const auto pSoftwareMesh : pCasters) {
+		for (const MeshInstance& instance : pSoftwareMesh->internalMesh->instances) {
+			const AABB& box = instance.worldBox;
+			for (int corner{}; corner < 8; ++corner) {
+				const Vector3 worldCorner{
+					(corner & 1) ? box.max.x : box.min.x,
+					(corner & 2) ? box.max.y : box.min.y,
+					(corner & 4) ? box.max.z : box.min.z };
+				const Vector3 lightCorner{ Vector3::Dot(worldCorner, right), Vector3::Dot(worldCorner, lightUp), Vector3::Dot(worldCorner, lightDirection) };
+				min = { std::min(min.x, lightCorner.x), std::min(min.y, lightCorner.y), std::min(min.z, lightCorner.z) };
+				max = { std::max(max.x, lightCorner.x), std::max(max.y, lightCorner.y), std::max(max.z, lightCorner.z) };
+			}
+		}
+	}
+
+	//Square texels, with a texel of border so the filter of the outer texels stays on the map
+	//The depth range gets the same border, so the casters stay inside of 0 to 1 after rounding
+	const float size = std::max(std::max(max.x - min.x, max.y - min.y), FLT_EPSILON);
+	m_TexelSize = size / static_cast<float>(m_Resolution - 2);
+	const float extent = m_TexelSize * static_cast<float>(m_Resolution);
+	const float startX = min.x - m_TexelSize;
+	const float startY = max.y + m_TexelSize - extent;
+	const float startZ = min.z - m_TexelSize;
+	m_DepthScale = 1.f / (max.z - min.z + 2.f * m_TexelSize);
+	const float scale = 2.f / extent;
+
+	//Left handed like the camera, x along right, y along the up of the light and the depth along the light direction
+	m_ViewProjection = Matrix{
+		Vector3{ right.x * scale, lightUp.x * scale, lightDirection.x * m_DepthScale },
+		Vector3{ right.y * scale, lightUp.y * scale, lightDirection.y * m_DepthScale },
+		Vector3{ right.z * scale, lightUp.z * scale, lightDirection.z * m_DepthScale },
+		Vector3{ -startX * scale - 1.f, -startY * scale - 1.f, -startZ * m_DepthScale } };
+
+	//The NDC to raster space step of the renderer, moved by half a texel so texel x is sampled at its center
+	const float halfResolution = 0.5f * static_cast<float>(m_Resolution);
+	const Matrix ndcToRaster{
+		Vector3{ halfResolution, 0.f, 0.f },
+		Vector3{ 0.f, -halfResolution, 0.f },
+		Vector3{ 0.f, 0.f, 1.f },
+		Vector3{ halfResolution - 0.5f, halfResolution - 0.5f, 0.f } };
+	m_WorldToRaster = m_ViewProjection * ndcToRaster;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "DataTypes.h"
+#include "WorldSpaceCache.h"
+
+//Depth of the opaque meshes seen from a directional light, for shadows in the software renderer
+//The light looks down an orthographic box fitted around the world bounds of the casters
+//The map owns the depth and the view projection of the light, the triangles are drawn by the depth only kernel of the renderer
+//The map is only drawn again when the light direction changes or a caster moved, so a static scene renders it once
+//Renderers that draw the same meshes with the same light can share one map, the first one to update it draws it for all of them
+class ShadowMap final
+{
+public:
+	explicit ShadowMap(int resolution);
+	~ShadowMap();
+
+	//Rule of 5
+	ShadowMap(const ShadowMap&) = delete;
+	ShadowMap(ShadowMap&&) noexcept = delete;
+	ShadowMap& operator=(const ShadowMap&) = delete;
+	ShadowMap& operator=(ShadowMap&&) noexcept = delete;
+
+	//Draws the triangles of one band into the rows of the target, the vertices are in raster space of the map
+	//Every triangle is three indices into the vertices
+	using DrawFunction = std::function<void(const RasterTarget& target, const Vertex_Out* pVertices, const uint32_t* pTriangles, size_t amountOfTriangles)>;
+
+	//Draws the map again when it doesn't match the light and the casters anymore, returns true if it did
+	//The casters are drawn at full detail with the world space vertices of the cache
+	//A renderer that updates the map while another one draws it waits for it
+	bool Update(const Light* pLight, const std::vector<Mesh_Software*>& pCasters, WorldSpaceCache& worldSpaceCache, const DrawFunction& draw);
+	//Share of the filter around the point that the light reaches, 1 is fully lit
+	//The filter is filterSize by filterSize texels, 1 is a single hard edged lookup
+	//The point is moved along the geometric normal first, so surfaces don't shadow themselves
+	float SampleVisibility(const dae::Vector3& worldPosition, const dae::Vector3& normal, int filterSize) const;
+
+	int GetResolution() const;
+
+private:
+	//Triangles of one caster instance, its vertices start at firstVertex in m_ShadowVertices
+	struct CasterInstance
+	{
+		uint32_t firstVertex{};
+		const IndexBuffer* pIndices{};
+	};
+
+	int m_Resolution{};
+	float* m_pDepthPixels{};
+
+	//Orthographic view projection of the light, the depth goes from 0 to 1 over the casters
+	dae::Matrix m_ViewProjection{};
+	//Same projection to raster space of the map, texel x and y are sampled at x and y
+	dae::Matrix m_WorldToRaster{};
+	//World space size of a texel, the biases are in texels
+	float m_TexelSize{};
+	//Depth in the map of one world space unit along the light direction
+	float m_DepthScale{};
+	uint64_t m_RenderedHash{};
+	bool m_IsValid{};
+	std::mutex m_UpdateMutex{};
+
+	std::vector<Vertex_Out> m_ShadowVertices{};
+	std::vector<CasterInstance> m_CasterInstances{};
+	//Triangles of every band, band i has the triangles from m_BandStarts[i] to m_BandStarts[i + 1]
+	//A triangle is only set up by the bands that contain its rows
+	std::vector<uint32_t> m_BandStarts{};
+	std::vector<uint32_t> m_BandTriangles{};
+
+	//Rows of texels drawn by one task, the tasks write to their own rows so they need no synchronization
+	static constexpr int BandHeight{ 16 };
+	static constexpr float NormalOffset{ 1.5f };
+	static constexpr float DepthBias{ 1.f };
+
+	//Hash of the light direction and the transforms of every caster instance
+	static uint64_t CalculateHash(const Light* pLight, const std::vector<Mesh_Software*>& pCasters);
+	//Fits the orthographic box of the light around the casters
+	void CalculateProjection(const dae::Vector3& lightDirection, const std::vector<Mesh_Software*>& pCasters);
+	//Sorts the triangles of the casters into the bands that their rows overlap
+	void BinTriangles(int amountOfBands);
+};
@@ -0,0 +1,278 @@
+#include "pch.h"
+#include "SoftwareRasterizer.h"
+#include "MeshSimplifier.h"
+#include "VertexQuantization.h"
+#include "Stripifier.h"
+#include "Utils.h"
+#include <chrono>
+#include <cstring> //memcpy
+#include <stdexcept>
+
+namespace dae
+{
+	SoftwareRasterizer::SoftwareRasterizer(int width, int height, float fovAngle) :
+		m_Width{ width },
+		m_Height{ height }
+	{
+		if (width <= 0 || height <= 0) {
+			throw std::invalid_argument("The size of the image has to be positive");
+		}
+
+		m_pCamera = new Camera();
+		m_pCamera->Initialize(fovAngle, { 0.f, 0.f, 0.f }, static_cast<float>(width) / static_cast<float>(height));
+		m_pCamera->CalculateViewMatrix();
+		m_pCamera->CalculateProjectionMatrix();
+		m_pTextureManager = new TextureManager();
+	}
+
+	SoftwareRasterizer::~SoftwareRasterizer()
+	{
+		delete m_pRenderer;
+		m_pRenderer = nullptr;
+
+		delete m_pMultiViewRenderer;
+		m_pMultiViewRenderer = nullptr;
+
+		for (auto pCamera : m_pViewCameras) {
+			delete pCamera;
+			pCamera = nullptr;
+		}
+
+		for (auto pMesh : m_pMeshes) {
+			delete pMesh;
+			pMesh = nullptr;
+		}
+
+		delete m_pTextureManager;
+		m_pTextureManager = nullptr;
+
+		delete m_pCamera;
+		m_pCamera = nullptr;
+	}
+
+	size_t SoftwareRasterizer::LoadMesh(const std::string& objPath, const std::vector<std::string>& texturePaths,
+		const Vector3& translation, const Vector3& scale, float yawRotation, bool isTransparent)
+	{
+		if (m_pRenderer || m_pMultiViewRenderer) {
+			throw std::logic_error("Meshes can only be loaded before the first frame");
+		}
+
+		std::vector<Vertex_In> vertices{};
+		std::vector<uint32_t> indices{};
+		if (!Utils::ParseOBJ(objPath, vertices, indices)) {
+			throw std::runtime_error("Failed to load mesh " + objPath);
+		}
+
+		std::vector<TextureHandle> pTextures{};
+		for (const std::string& path : texturePaths) {
+			pTextures.push_back(m_pTextureManager->Load(path));
+		}
+
+		Vector3 meshTranslation{ translation };
+		Vector3 meshScale{ scale };
+		Mesh* pMesh = new Mesh(vertices, indices, meshTranslation, meshScale, yawRotation, pTextures, isTransparent);
+		//Transparent meshes are blended as a whole, they don't get coarser levels
+		if (!isTransparent) {
+			MeshSimplifier::BuildLODs(*pMesh);
+			if (m_UseTriangleStrips) {
+				Stripifier::StripifyMesh(*pMesh);
+			}
+		}
+		if (m_QuantizeVertices) {
+			VertexQuantization::QuantizeMesh(*pMesh);
+		}
+		m_pMeshes.push_back(pMesh);
+		return m_pMeshes.size() - 1;
+	}
+
+	void SoftwareRasterizer::SetVertexQuantization(bool isEnabled)
+	{
+		m_QuantizeVertices = isEnabled;
+	}
+
+	void SoftwareRasterizer::SetTriangleStrips(bool isEnabled)
+	{
+		m_UseTriangleStrips = isEnabled;
+	}
+
+	size_t SoftwareRasterizer::AddInstance(size_t meshIndex, const Vector3& translation, const Vector3& scale, float yawRotation)
+	{
+		return m_pMeshes.at(meshIndex)->AddInstance(translation, scale, yawRotation);
+	}
+
+	MeshInstance& SoftwareRasterizer::GetInstance(size_t meshIndex, size_t instanceIndex)
+	{
+		return m_pMeshes.at(meshIndex)->instances.at(instanceIndex);
+	}
+
+	void SoftwareRasterizer::SetCamera(const Vector3& origin, float yaw, float pitch)
+	{
+		m_pCamera->origin = origin;
+		m_pCamera->totalYaw = yaw;
+		m_pCamera->totalPitch = pitch;
+		m_pCamera->CalculateViewMatrix();
+		m_pCamera->CalculateProjectionMatrix();
+	}
+
+	void SoftwareRasterizer::AddPointLight(const Vector3& origin, const ColorRGB& color, float intensity, float range)
+	{
+		m_PointLights.emplace_back(origin, Vector3::Zero, color, intensity, LightType::Point, range);
+		if (m_pRenderer) {
+			m_pRenderer->AddPointLight(origin, color, intensity, range);
+		}
+		for (size_t i{}; m_pMultiViewRenderer && i < m_pMultiViewRenderer->GetAmountOfViews(); ++i) {
+			m_pMultiViewRenderer->GetView(i)->AddPointLight(origin, color, intensity, range);
+		}
+	}
+
+	void SoftwareRasterizer::SetRenderStates(const Renderer_Software::RenderStates& states)
+	{
+		m_RenderStates = states;
+		if (m_pRenderer) {
+			m_pRenderer->SetRenderStates(states);
+		}
+		for (size_t i{}; m_pMultiViewRenderer && i < m_pMultiViewRenderer->GetAmountOfViews(); ++i) {
+			m_pMultiViewRenderer->GetView(i)->SetRenderStates(states);
+		}
+	}
+
+	void SoftwareRasterizer::SetTemporalCache(bool isEnabled)
+	{
+		m_UseTemporalCache = isEnabled;
+		if (m_pRenderer && m_pRenderer->IsTemporalCacheEnabled() != isEnabled) {
+			m_pRenderer->ToggleTemporalCache();
+		}
+		for (size_t i{}; m_pMultiViewRenderer && i < m_pMultiViewRenderer->GetAmountOfViews(); ++i) {
+			Renderer_Software* pView = m_pMultiViewRenderer->GetView(i);
+			if (pView->IsTemporalCacheEnabled() != isEnabled) {
+				pView->ToggleTemporalCache();
+			}
+		}
+	}
+
+	size_t SoftwareRasterizer::AddView(int width, int height, float fovAngle)
+	{
+		if (m_pMultiViewRenderer) {
+			throw std::logic_error("Views can only be added before the first frame of the views");
+		}
+		if (width <= 0 || height <= 0) {
+			throw std::invalid_argument("The size of the view has to be positive");
+		}
+
+		Camera* pCamera = new Camera();
+		pCamera->Initialize(fovAngle, { 0.f, 0.f, 0.f }, static_cast<float>(width) / static_cast<float>(height));
+		pCamera->CalculateViewMatrix();
+		pCamera->CalculateProjectionMatrix();
+		m_pViewCameras.push_back(pCamera);
+		m_ViewSizes.push_back(Int2{ width, height });
+		return m_pViewCameras.size() - 1;
+	}
+
+	void SoftwareRasterizer::SetViewCamera(size_t viewIndex, const Vector3& origin, float yaw, float pitch)
+	{
+		Camera* pCamera = m_pViewCameras.at(viewIndex);
+		pCamera->origin = origin;
+		pCamera->totalYaw = yaw;
+		pCamera->totalPitch = pitch;
+		pCamera->CalculateViewMatrix();
+		pCamera->CalculateProjectionMatrix();
+	}
+
+	float SoftwareRasterizer::RenderViews(const std::vector<ViewTarget>& targets)
+	{
+		if (targets.size() != m_pViewCameras.size()) {
+			throw std::invalid_argument("RenderViews needs a target for every view");
+		}
+		if (!m_pMultiViewRenderer) {
+			CreateMultiViewRenderer();
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		m_pMultiViewRenderer->Render();
+		const std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+		for (size_t i{}; i < targets.size(); ++i) {
+			if (targets[i].pPixels) {
+				CopyPixels(m_pMultiViewRenderer->GetView(i), targets[i].pPixels, targets[i].pitch);
+			}
+		}
+		return elapsed.count();
+	}
+
+	const SoftwareRasterizer::Statistics& SoftwareRasterizer::Render(uint32_t* pPixels, int pitch)
+	{
+		if (!m_pRenderer) {
+			CreateRenderer();
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		m_pRenderer->Render();
+		const std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		m_Statistics.frameTimeMs = elapsed.count();
+		m_Statistics.wasFrameSkipped = m_pRenderer->WasFrameSkipped();
+
+		//The renderer keeps its own image, so skipped frames still copy the last one
+		if (pPixels) {
+			CopyPixels(m_pRenderer, pPixels, pitch);
+		}
+		return m_Statistics;
+	}
+
+	const SoftwareRasterizer::Statistics& SoftwareRasterizer::GetStatistics() const
+	{
+		return m_Statistics;
+	}
+
+	const FrameStatistics& SoftwareRasterizer::GetFrameStatistics() const
+	{
+		//Zero before the first frame
+		static const FrameStatistics noFrame{};
+		return m_pRenderer ? m_pRenderer->GetFrameStatistics() : noFrame;
+	}
+
+	int SoftwareRasterizer::GetWidth() const
+	{
+		return m_Width;
+	}
+
+	int SoftwareRasterizer::GetHeight() const
+	{
+		return m_Height;
+	}
+
+	void SoftwareRasterizer::CreateRenderer()
+	{
+		m_pRenderer = new Renderer_Software(m_Width, m_Height, m_pCamera, m_pMeshes);
+		ConfigureRenderer(m_pRenderer);
+	}
+
+	void SoftwareRasterizer::CreateMultiViewRenderer()
+	{
+		m_pMultiViewRenderer = new MultiViewRenderer(m_pMeshes);
+		for (size_t i{}; i < m_pViewCameras.size(); ++i) {
+			const size_t viewIndex = m_pMultiViewRenderer->AddView(m_ViewSizes[i].x, m_ViewSizes[i].y, m_pViewCameras[i]);
+			ConfigureRenderer(m_pMultiViewRenderer->GetView(viewIndex));
+		}
+	}
+
+	void SoftwareRasterizer::ConfigureRenderer(Renderer_Software* pRenderer) const
+	{
+		pRenderer->SetRenderStates(m_RenderStates);
+		if (m_UseTemporalCache) {
+			pRenderer->ToggleTemporalCache();
+		}
+		for (const Light& light : m_PointLights) {
+			pRenderer->AddPointLight(light.origin, light.color, light.intensity, light.range);
+		}
+	}
+
+	void SoftwareRasterizer::CopyPixels(const Renderer_Software* pRenderer, uint32_t* pPixels, int pitch)
+	{
+		const uint32_t* pSource = pRenderer->GetPixels();
+		const int width = pRenderer->GetWidth();
+		for (int py{}; py < pRenderer->GetHeight(); ++py) {
+			std::memcpy(reinterpret_cast<uint8_t*>(pPixels) + static_cast<size_t>(py) * pitch, pSource + static_cast<size_t>(py) * width,
+				width * sizeof(uint32_t));
+		}
+	}
+}
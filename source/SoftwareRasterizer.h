@@ -0,0 +1,110 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Renderer_Software.h"
+#include "TextureManager.h"
+#include "MultiViewRenderer.h"
+
+namespace dae
+{
+	//Embedding API of the software renderer, for programs that bring their own window or none at all
+	//Owns the camera, the meshes and the renderer, frames are copied into memory of the caller
+	//Meshes can only be loaded before the first frame, instances and lights can be added at any time
+	//Extra views render the same scene from other cameras in one pass, at their own size
+	class SoftwareRasterizer final
+	{
+	public:
+		SoftwareRasterizer(int width, int height, float fovAngle = 45.f);
+		~SoftwareRasterizer();
+
+		//Rule of 5
+		SoftwareRasterizer(const SoftwareRasterizer&) = delete;
+		SoftwareRasterizer(SoftwareRasterizer&&) noexcept = delete;
+		SoftwareRasterizer& operator=(const SoftwareRasterizer&) = delete;
+		SoftwareRasterizer& operator=(SoftwareRasterizer&&) noexcept = delete;
+
+		struct Statistics
+		{
+			float frameTimeMs{};
+			//Nothing changed since the frame before, the image is the same
+			bool wasFrameSkipped{};
+		};
+
+		//Memory of the caller a view is copied to, 0xAARRGGBB with pitch in bytes between the rows
+		struct ViewTarget
+		{
+			uint32_t* pPixels{};
+			int pitch{};
+		};
+
+		//Loads an OBJ with its textures, in the order diffuse, normal, specular, glossiness
+		//Transparent meshes only use a diffuse texture. Returns the index of the mesh
+		//Throws a runtime_error when a file can't be loaded, and a logic_error after the first frame
+		size_t LoadMesh(const std::string& objPath, const std::vector<std::string>& texturePaths,
+			const Vector3& translation, const Vector3& scale, float yawRotation, bool isTransparent = false);
+		//Meshes loaded after this use quantized vertices, 18 instead of 44 bytes per vertex at a small loss of precision
+		//Only the meshes get smaller, the world space vertices of the drawn instances are still floats
+		void SetVertexQuantization(bool isEnabled);
+		//Opaque meshes loaded after this are drawn from a triangle strip per meshlet, their tangents are averaged over welded corners, see Stripifier
+		void SetTriangleStrips(bool isEnabled);
+		//Returns the index of the new instance of the mesh
+		size_t AddInstance(size_t meshIndex, const Vector3& translation, const Vector3& scale, float yawRotation);
+		MeshInstance& GetInstance(size_t meshIndex, size_t instanceIndex);
+
+		//Angles in radians
+		void SetCamera(const Vector3& origin, float yaw, float pitch);
+		void AddPointLight(const Vector3& origin, const ColorRGB& color, float intensity, float range);
+		void SetRenderStates(const Renderer_Software::RenderStates& states);
+		//Off by default, only worth it when the shading is expensive
+		void SetTemporalCache(bool isEnabled);
+
+		//Returns the index of the new view, views can only be added before the first frame of the views
+		size_t AddView(int width, int height, float fovAngle = 45.f);
+		//Angles in radians
+		void SetViewCamera(size_t viewIndex, const Vector3& origin, float yaw, float pitch);
+		//Renders every view and copies view i to targets[i], the world space work is shared by the views
+		//Returns the time of the whole pass
+		float RenderViews(const std::vector<ViewTarget>& targets);
+
+		//Renders a frame and copies it to the pixels of the caller, 0xAARRGGBB with pitch in bytes between the rows
+		//The pixels have to be at least pitch * height bytes
+		const Statistics& Render(uint32_t* pPixels, int pitch);
+		const Statistics& GetStatistics() const;
+		//Stage times and counts of the last frame, a FrameTelemetry publishes them for tools in other processes
+		const FrameStatistics& GetFrameStatistics() const;
+
+		int GetWidth() const;
+		int GetHeight() const;
+
+	private:
+		int m_Width{};
+		int m_Height{};
+
+		Camera* m_pCamera{};
+		TextureManager* m_pTextureManager{};
+		std::vector<Mesh*> m_pMeshes{};
+		//Created with the first frame, it builds its own meshes from the loaded ones
+		Renderer_Software* m_pRenderer{};
+
+		//Cameras of the views, and their sizes until the first frame of the views creates the renderers
+		std::vector<Camera*> m_pViewCameras{};
+		std::vector<Int2> m_ViewSizes{};
+		MultiViewRenderer* m_pMultiViewRenderer{};
+
+		//Given to the renderers when they are created
+		Renderer_Software::RenderStates m_RenderStates{};
+		std::vector<Light> m_PointLights{};
+		bool m_UseTemporalCache{};
+		bool m_QuantizeVertices{};
+		bool m_UseTriangleStrips{};
+
+		Statistics m_Statistics{};
+
+		void CreateRenderer();
+		void CreateMultiViewRenderer();
+		//Applies the render states, the temporal cache and the lights to a new renderer
+		void ConfigureRenderer(Renderer_Software* pRenderer) const;
+		static void CopyPixels(const Renderer_Software* pRenderer, uint32_t* pPixels, int pitch);
+	};
+}
@@ -0,0 +1,242 @@
+#include "pch.h"
+#include "Stripifier.h"
+#include <cstring> //memcpy, memcmp
+#include <unordered_map>
+
+namespace
+{
+	constexpr uint32_t NoTriangle{ UINT32_MAX };
+	constexpr uint32_t NoVertex{ UINT32_MAX };
+
+	uint64_t GetEdgeKey(uint32_t from, uint32_t to)
+	{
+		return (static_cast<uint64_t>(from) << 32) | to;
+	}
+
+	//Everything of a vertex besides the tangent, corners that match in all of it are the same vertex
+	struct WeldKey
+	{
+		float values[8]{};
+
+		explicit WeldKey(const Vertex_In& vertex)
+		{
+			memcpy(&values[0], &vertex.position, sizeof(Vector3));
+			memcpy(&values[3], &vertex.uv, sizeof(Vector2));
+			memcpy(&values[5], &vertex.normal, sizeof(Vector3));
+		}
+
+		bool operator==(const WeldKey& other) const
+		{
+			return memcmp(values, other.values, sizeof(values)) == 0;
+		}
+	};
+
+	struct WeldKeyHash
+	{
+		size_t operator()(const WeldKey& key) const
+		{
+			uint32_t bits[8]{};
+			memcpy(bits, key.values, sizeof(bits));
+			size_t hash{};
+			for (uint32_t value : bits) {
+				hash = (hash * 31) ^ value;
+			}
+			return hash;
+		}
+	};
+
+	//Merges the corners with the same position, UV and normal and remaps the indices, in order of first use
+	//The tangents of the parser are per triangle, the merged vertex gets their average
+	void WeldVertices(std::vector<Vertex_In>& vertices, std::vector<uint32_t>& indices)
+	{
+		std::unordered_map<WeldKey, uint32_t, WeldKeyHash> weldedIndices{};
+		weldedIndices.reserve(vertices.size());
+		std::vector<Vertex_In> weldedVertices{};
+		std::vector<uint32_t> remap(vertices.size(), NoVertex);
+		for (uint32_t& index : indices) {
+			if (remap[index] == NoVertex) {
+				const auto result = weldedIndices.emplace(WeldKey{ vertices[index] }, static_cast<uint32_t>(weldedVertices.size()));
+				if (result.second) {
+					weldedVertices.push_back(vertices[index]);
+				}
+				else {
+					weldedVertices[result.first->second].tangent += vertices[index].tangent;
+				}
+				remap[index] = result.first->second;
+			}
+			index = remap[index];
+		}
+
+		for (Vertex_In& vertex : weldedVertices) {
+			vertex.tangent = Vector3::Reject(vertex.tangent, vertex.normal).Normalized();
+		}
+		vertices = std::move(weldedVertices);
+	}
+
+	//Mesh and MeshLOD, both have their own vertices, indices and meshlets
+	template<typename Level>
+	void StripifyLevel(Level& level, bool isQuantized)
+	{
+		std::vector<uint32_t> indices = level.indices.ToVector();
+		//Quantized meshes have no full precision vertices left to weld
+		if (!isQuantized) {
+			WeldVertices(level.vertices, indices);
+			//Only the values change, the meshlets keep their ranges and bounds
+			level.indices = IndexBuffer{ indices, level.vertices.size() };
+		}
+
+		//Every meshlet gets a strip of its own, so the renderer culls and picks levels of detail like it does for lists
+		std::vector<uint32_t> stripIndices{};
+		stripIndices.reserve(indices.size());
+		for (Meshlet& meshlet : level.meshlets) {
+			const auto firstIndex = indices.begin() + meshlet.firstIndex;
+			const std::vector<uint32_t> strip = Stripifier::BuildStrip({ firstIndex, firstIndex + 3 * meshlet.amountOfTriangles });
+			meshlet.firstStripIndex = static_cast<uint32_t>(stripIndices.size());
+			meshlet.amountOfStripIndices = static_cast<uint32_t>(strip.size());
+			stripIndices.insert(stripIndices.end(), strip.begin(), strip.end());
+		}
+		const size_t amountOfVertices = isQuantized ? level.quantizedVertices.size() : level.vertices.size();
+		level.stripIndices = IndexBuffer{ stripIndices, amountOfVertices };
+	}
+}
+
+std::vector<uint32_t> Stripifier::BuildStrip(const std::vector<uint32_t>& indices)
+{
+	const uint32_t amountOfTriangles = static_cast<uint32_t>(indices.size() / 3);
+
+	//Triangle that has the edge in its winding order, the first one wins on edges shared by more triangles
+	std::unordered_map<uint64_t, uint32_t> triangleByEdge{};
+	triangleByEdge.reserve(indices.size());
+	std::vector<bool> isUsed(amountOfTriangles);
+	for (uint32_t triangle{}; triangle < amountOfTriangles; ++triangle) {
+		const uint32_t* pCorners = &indices[triangle * 3];
+		//Triangles without area draw nothing, so they are left out
+		if (pCorners[0] == pCorners[1] || pCorners[0] == pCorners[2] || pCorners[1] == pCorners[2]) {
+			isUsed[triangle] = true;
+			continue;
+		}
+		for (uint32_t corner{}; corner < 3; ++corner) {
+			triangleByEdge.emplace(GetEdgeKey(pCorners[corner], pCorners[(corner + 1) % 3]), triangle);
+		}
+	}
+
+	auto findUnusedTriangle = [&](uint32_t from, uint32_t to)
+		{
+			const auto it = triangleByEdge.find(GetEdgeKey(from, to));
+			return it != triangleByEdge.end() && !isUsed[it->second] ? it->second : NoTriangle;
+		};
+
+	//Neighbour over every edge of every triangle, it has the edge in the opposite direction
+	std::vector<uint32_t> neighbours(indices.size(), NoTriangle);
+	for (uint32_t triangle{}; triangle < amountOfTriangles; ++triangle) {
+		if (isUsed[triangle]) {
+			continue;
+		}
+		const uint32_t* pCorners = &indices[triangle * 3];
+		for (uint32_t corner{}; corner < 3; ++corner) {
+			const uint32_t neighbour = findUnusedTriangle(pCorners[(corner + 1) % 3], pCorners[corner]);
+			neighbours[triangle * 3 + corner] = neighbour != triangle ? neighbour : NoTriangle;
+		}
+	}
+	auto countUnusedNeighbours = [&](uint32_t triangle)
+		{
+			uint32_t amountOfNeighbours{};
+			for (uint32_t corner{}; corner < 3; ++corner) {
+				const uint32_t neighbour = neighbours[triangle * 3 + corner];
+				amountOfNeighbours += neighbour != NoTriangle && !isUsed[neighbour];
+			}
+			return amountOfNeighbours;
+		};
+
+	//Strips start at the triangles with the fewest unused neighbours, so few triangles are left behind on their own
+	//A triangle is pushed again when a neighbour is used, the counts only go down so an old entry never hides a better one
+	std::vector<uint32_t> startCandidates[4]{};
+	for (uint32_t triangle{ amountOfTriangles }; triangle-- > 0;) {
+		if (!isUsed[triangle]) {
+			startCandidates[countUnusedNeighbours(triangle)].push_back(triangle);
+		}
+	}
+	auto useTriangle = [&](uint32_t triangle)
+		{
+			isUsed[triangle] = true;
+			for (uint32_t corner{}; corner < 3; ++corner) {
+				const uint32_t neighbour = neighbours[triangle * 3 + corner];
+				if (neighbour != NoTriangle && !isUsed[neighbour]) {
+					startCandidates[countUnusedNeighbours(neighbour)].push_back(neighbour);
+				}
+			}
+		};
+	auto findStartTriangle = [&]()
+		{
+			for (std::vector<uint32_t>& candidates : startCandidates) {
+				while (!candidates.empty()) {
+					const uint32_t triangle = candidates.back();
+					candidates.pop_back();
+					if (!isUsed[triangle]) {
+						return triangle;
+					}
+				}
+			}
+			return NoTriangle;
+		};
+
+	std::vector<uint32_t> strip{};
+	strip.reserve(indices.size());
+	for (uint32_t startTriangle{ findStartTriangle() }; startTriangle != NoTriangle; startTriangle = findStartTriangle()) {
+		useTriangle(startTriangle);
+
+		//Start with the corner that leaves an edge with an unused neighbour at the end
+		const uint32_t* pCorners = &indices[startTriangle * 3];
+		uint32_t firstCorner{};
+		for (uint32_t corner{}; corner < 3; ++corner) {
+			//The second triangle of a strip is odd, it has the last edge in the opposite direction
+			if (findUnusedTriangle(pCorners[(corner + 2) % 3], pCorners[(corner + 1) % 3]) != NoTriangle) {
+				firstCorner = corner;
+				break;
+			}
+		}
+
+		//Repeat the last index and the first index of the new strip, once more to keep the new strip on an even position
+		if (!strip.empty()) {
+			const uint32_t lastIndex = strip.back();
+			if (strip.size() % 2 == 1) {
+				strip.push_back(lastIndex);
+			}
+			strip.push_back(lastIndex);
+			strip.push_back(pCorners[firstCorner]);
+		}
+		strip.push_back(pCorners[firstCorner]);
+		strip.push_back(pCorners[(firstCorner + 1) % 3]);
+		strip.push_back(pCorners[(firstCorner + 2) % 3]);
+
+		while (true) {
+			const size_t amountOfIndices = strip.size();
+			const uint32_t from = strip[amountOfIndices - 2];
+			const uint32_t to = strip[amountOfIndices - 1];
+			//The next triangle starts two indices before the end, odd ones are wound the other way
+			const bool isOdd = (amountOfIndices - 2) % 2 == 1;
+			const uint32_t nextTriangle = isOdd ? findUnusedTriangle(to, from) : findUnusedTriangle(from, to);
+			if (nextTriangle == NoTriangle) {
+				break;
+			}
+			useTriangle(nextTriangle);
+
+			const uint32_t* pNextCorners = &indices[nextTriangle * 3];
+			for (uint32_t corner{}; corner < 3; ++corner) {
+				if (pNextCorners[corner] != from && pNextCorners[corner] != to) {
+					strip.push_back(pNextCorners[corner]);
+					break;
+				}
+			}
+		}
+	}
+	return strip;
+}
+
+void Stripifier::StripifyMesh(Mesh& mesh)
+{
+	StripifyLevel(mesh, mesh.isQuantized);
+	for (MeshLOD& lod : mesh.lods) {
+		StripifyLevel(lod, mesh.isQuantized);
+	}
+}
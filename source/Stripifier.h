@@ -0,0 +1,18 @@
+#pragma once
+#include <vector>
+#include "DataTypes.h"
+
+//Turns triangle lists into triangle strips, so the strip path of the software renderer reads fewer indices per triangle
+//Strips are joined with repeated indices, the triangles over a join have no area and are skipped by the renderer
+//Every odd triangle of the strip is wound the other way, joins keep the first triangle of every strip on an even position
+namespace Stripifier
+{
+	//Greedy, a strip is extended over the neighbour that shares the last edge with the right winding
+	std::vector<uint32_t> BuildStrip(const std::vector<uint32_t>& indices);
+	//Fills the strip indices of every level of the mesh with a strip per meshlet, the list indices stay for the other passes
+	//Strips only continue over shared indices and the OBJ parser gives every corner its own vertex,
+	//so corners with the same position, UV and normal are welded first. Call it after BuildLODs and before QuantizeMesh
+	//The welding changes the mesh for every pass that draws it, the hardware renderer and the shadow map included:
+	//the triangles stay the same, but a welded vertex gets the average of the tangents of its corners
+	void StripifyMesh(Mesh& mesh);
+}
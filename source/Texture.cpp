@@ -1,23 +1,29 @@
 #include "pch.h"
 #include "Texture.h"
 #include "Vector2.h"
+#include <cstring> //memcmp
+#include <stdexcept>
+#if defined(DAE_SOFTWARE_ONLY)
+#include <png.h>
+#else
 #include <SDL_image.h>
+#endif
 
 namespace dae
 {
-	Texture::Texture(SDL_Surface* pSurface) :
-		m_pSurface{ pSurface },
-		m_pSurfacePixels{ (uint32_t*)pSurface->pixels }
+	Texture::Texture(int width, int height, uint32_t* pTexels) :
+		m_Width{ width },
+		m_Height{ height },
+		m_pTexels{ pTexels }
 	{
 	}
 
 	Texture::~Texture()
 	{
-		if (m_pSurface != nullptr)
-		{
-			SDL_FreeSurface(m_pSurface);
-			m_pSurface = nullptr;
-		}
+		delete[] m_pTexels;
+		m_pTexels = nullptr;
+
+#if !defined(DAE_SOFTWARE_ONLY)
 		if (m_pResource != nullptr) {
 			m_pResource->Release();
 		}
@@ -25,31 +31,125 @@ namespace dae
 		if (m_pResourceView != nullptr) {
 			m_pResourceView->Release();
 		}
+#endif
 	}
 
 	Texture* Texture::LoadFromFile(const std::string& path)
 	{
+#if defined(DAE_SOFTWARE_ONLY)
+		//The library only reads PNG files, with libpng
+		png_image image{};
+		image.version = PNG_IMAGE_VERSION;
+		if (!png_image_begin_read_from_file(&image, path.c_str())) {
+			throw std::runtime_error("Failed to load texture " + path);
+		}
+		image.format = PNG_FORMAT_RGBA;
+
+		uint32_t* pTexels = new uint32_t[static_cast<size_t>(image.width) * image.height];
+		if (!png_image_finish_read(&image, nullptr, pTexels, 0, nullptr)) {
+			delete[] pTexels;
+			png_image_free(&image);
+			throw std::runtime_error("Failed to decode texture " + path);
+		}
+		return new Texture(static_cast<int>(image.width), static_cast<int>(image.height), pTexels);
+#else
 		//Load SDL_Surface using IMG_LOAD
 		SDL_Surface* pSurface = IMG_Load(path.c_str());
-		//Create & Return a new Texture Object (using SDL_Surface)
-		return new Texture(pSurface);
+		if (pSurface == nullptr) {
+			throw std::runtime_error("Failed to load texture " + path);
+		}
+		//Every file ends up with R, G, B and A bytes, so sampling doesn't depend on the format of the file
+		SDL_Surface* pRGBASurface = SDL_ConvertSurfaceFormat(pSurface, SDL_PIXELFORMAT_RGBA32, 0);
+		SDL_FreeSurface(pSurface);
+		if (pRGBASurface == nullptr) {
+			throw std::runtime_error("Failed to convert texture " + path);
+		}
+
+		const int width = pRGBASurface->w;
+		const int height = pRGBASurface->h;
+		uint32_t* pTexels = new uint32_t[static_cast<size_t>(width) * height];
+		for (int y{}; y < height; ++y) {
+			std::memcpy(pTexels + y * width, static_cast<const uint8_t*>(pRGBASurface->pixels) + y * pRGBASurface->pitch, width * sizeof(uint32_t));
+		}
+		SDL_FreeSurface(pRGBASurface);
+		return new Texture(width, height, pTexels);
+#endif
 	}
 
 	ColorRGB Texture::Sample(const Vector2& uv) const
 	{
 		//Sample the correct texel for the given uv
-		Uint32 pixelX = Uint32(m_pSurface->w * uv.x);
-		Uint32 pixelY = Uint32(m_pSurface->h * uv.y);
+		uint32_t pixelX = uint32_t(m_Width * uv.x);
+		uint32_t pixelY = uint32_t(m_Height * uv.y);
+
+		uint32_t pixelIndex = pixelY * m_Width + pixelX;
+		const uint32_t texel = m_pTexels[pixelIndex];
+
+		ColorRGB texelColor{ float(texel & 0xFF), float((texel >> 8) & 0xFF), float((texel >> 16) & 0xFF) };
+		//put in range 0 to 1
+		texelColor /= 255.f;
+		return texelColor;
+	}
+
+	ColorRGB Texture::Sample(const Vector2& uv, float& alpha) const
+	{
+		//Sample the correct texel for the given uv
+		uint32_t pixelX = uint32_t(m_Width * uv.x);
+		uint32_t pixelY = uint32_t(m_Height * uv.y);
 
-		Uint32 pixelIndex = pixelY * m_pSurface->w + pixelX;
-		Uint8 r{}, g{}, b{};
-		SDL_GetRGB(m_pSurfacePixels[pixelIndex], m_pSurface->format, &r, &g, &b);
+		uint32_t pixelIndex = pixelY * m_Width + pixelX;
+		const uint32_t texel = m_pTexels[pixelIndex];
 
-		ColorRGB texelColor{ float(r), float(g), float(b) };
+		ColorRGB texelColor{ float(texel & 0xFF), float((texel >> 8) & 0xFF), float((texel >> 16) & 0xFF) };
 		//put in range 0 to 1
 		texelColor /= 255.f;
+		alpha = float(texel >> 24) / 255.f;
 		return texelColor;
 	}
+
+	int Texture::GetWidth() const
+	{
+		return m_Width;
+	}
+
+	int Texture::GetHeight() const
+	{
+		return m_Height;
+	}
+
+	size_t Texture::GetSizeInBytes() const
+	{
+		return static_cast<size_t>(m_Width) * m_Height * sizeof(uint32_t);
+	}
+
+	uint64_t Texture::CalculateContentHash() const
+	{
+		constexpr uint64_t fnvOffsetBasis{ 14695981039346656037ull };
+		constexpr uint64_t fnvPrime{ 1099511628211ull };
+
+		uint64_t hash{ fnvOffsetBasis };
+		auto addBytes = [&hash](const void* pData, size_t size)
+			{
+				const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+				for (size_t i{}; i < size; ++i) {
+					hash ^= pBytes[i];
+					hash *= fnvPrime;
+				}
+			};
+
+		addBytes(&m_Width, sizeof(m_Width));
+		addBytes(&m_Height, sizeof(m_Height));
+		addBytes(m_pTexels, GetSizeInBytes());
+		return hash;
+	}
+
+	bool Texture::HasSameTexels(const Texture& other) const
+	{
+		return m_Width == other.m_Width && m_Height == other.m_Height &&
+			std::memcmp(m_pTexels, other.m_pTexels, GetSizeInBytes()) == 0;
+	}
+
+#if !defined(DAE_SOFTWARE_ONLY)
 	ID3D11ShaderResourceView* Texture::GetResourceView()
 	{
 		return m_pResourceView;
@@ -71,16 +171,19 @@ namespace dae
 
 	void Texture::CreateDirectXResources(ID3D11Device* pDevice)
 	{
-		auto pTextureSurface = m_pSurface;
+		//Textures can be shared by several meshes, only upload them once
+		if (m_pResourceView != nullptr) {
+			return;
+		}
 
-		if (m_pSurface == nullptr) {
+		if (m_pTexels == nullptr) {
 			throw std::runtime_error("Texture surface not found");
 		}
 
 		DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
 		D3D11_TEXTURE2D_DESC desc{};
-		desc.Width = pTextureSurface->w;
-		desc.Height = pTextureSurface->h;
+		desc.Width = m_Width;
+		desc.Height = m_Height;
 		desc.MipLevels = 1;
 		desc.ArraySize = 1;
 		desc.Format = format;
@@ -92,9 +195,9 @@ namespace dae
 		desc.MiscFlags = 0;
 
 		D3D11_SUBRESOURCE_DATA initData{};
-		initData.pSysMem = pTextureSurface->pixels;
-		initData.SysMemPitch = static_cast<UINT>(pTextureSurface->pitch);
-		initData.SysMemSlicePitch = static_cast<UINT>(pTextureSurface->h * pTextureSurface->pitch);
+		initData.pSysMem = m_pTexels;
+		initData.SysMemPitch = static_cast<UINT>(m_Width * sizeof(uint32_t));
+		initData.SysMemSlicePitch = static_cast<UINT>(GetSizeInBytes());
 
 		auto* pResource = GetResource();
 		HRESULT hr = pDevice->CreateTexture2D(&desc, &initData, &pResource);
@@ -119,4 +222,5 @@ namespace dae
 
 		SetResourceView(pResourceView);
 	}
+#endif
 }
\ No newline at end of file
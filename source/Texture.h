@@ -1,5 +1,5 @@
 #pragma once
-#include <SDL_surface.h>
+#include <cstdint>
 #include <string>
 #include "ColorRGB.h"
 
@@ -12,22 +12,41 @@ namespace dae
 	public:
 		~Texture();
 
+		//Throws a runtime_error when the file can't be loaded
 		static Texture* LoadFromFile(const std::string& path);
 		ColorRGB Sample(const Vector2& uv) const;
+		//Same as Sample, also returns the alpha of the texel in the range 0 to 1
+		ColorRGB Sample(const Vector2& uv, float& alpha) const;
 
+		int GetWidth() const;
+		int GetHeight() const;
+		//Bytes of texel data kept in memory
+		size_t GetSizeInBytes() const;
+		//FNV-1a over the size and the texels, textures with the same texels have the same hash
+		uint64_t CalculateContentHash() const;
+		bool HasSameTexels(const Texture& other) const;
+
+#if !defined(DAE_SOFTWARE_ONLY)
 		ID3D11ShaderResourceView* GetResourceView();
 		ID3D11Texture2D* GetResource();
 		void CreateDirectXResources(ID3D11Device* pDevice);
+#endif
 
 	private:
-		Texture(SDL_Surface* pSurface);
+		//Takes ownership of the texels
+		Texture(int width, int height, uint32_t* pTexels);
+
+		int m_Width{};
+		int m_Height{};
+		//R, G, B and A bytes in memory, the same layout on every platform and for DirectX
+		uint32_t* m_pTexels{ nullptr };
 
-		SDL_Surface* m_pSurface{ nullptr };
-		uint32_t* m_pSurfacePixels{ nullptr };
+#if !defined(DAE_SOFTWARE_ONLY)
 		ID3D11Texture2D* m_pResource{};
 		ID3D11ShaderResourceView* m_pResourceView{};
 
 		void SetResource(ID3D11Texture2D* pResource);
 		void SetResourceView(ID3D11ShaderResourceView* pResourceView);
+#endif
 	};
 }
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "pch.h"
+#include "TextureManager.h"
+
+namespace dae
+{
+	TextureHandle TextureManager::Load(const std::string& path)
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			++m_AmountOfRequests;
+			const auto pathIt = m_TexturesByPath.find(path);
+			if (pathIt != m_TexturesByPath.end()) {
+				if (TextureHandle pTexture = pathIt->second.lock()) {
+					++m_AmountOfPathHits;
+					return pTexture;
+				}
+			}
+		}
+
+		//Decode without holding the lock, so other files decode at the same time
+		TextureHandle pNewTexture{ Texture::LoadFromFile(path) };
+		const uint64_t hash = pNewTexture->CalculateContentHash();
+
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		//Another thread can have loaded the same path or the same texels in the meantime
+		TextureHandle pTexture = m_TexturesByPath[path].lock();
+		if (pTexture) {
+			++m_AmountOfPathHits;
+			return pTexture;
+		}
+
+		pTexture = FindByContent(hash, *pNewTexture);
+		if (pTexture) {
+			++m_AmountOfContentHits;
+		}
+		else {
+			pTexture = pNewTexture;
+			m_TexturesByHash.emplace(hash, pTexture);
+		}
+		m_TexturesByPath[path] = pTexture;
+		//Only a load that adds a texture erases, the entries of freed textures would otherwise stay forever
+		EraseExpired();
+		return pTexture;
+	}
+
+	size_t TextureManager::GetAmountOfResidentTextures() const
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		size_t amountOfTextures{};
+		for (const auto& texture : m_TexturesByHash) {
+			if (!texture.second.expired()) {
+				++amountOfTextures;
+			}
+		}
+		return amountOfTextures;
+	}
+
+	size_t TextureManager::GetResidentBytes() const
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		size_t residentBytes{};
+		for (const auto& texture : m_TexturesByHash) {
+			if (const TextureHandle pTexture = texture.second.lock()) {
+				residentBytes += pTexture->GetSizeInBytes();
+			}
+		}
+		return residentBytes;
+	}
+
+	void TextureManager::PrintStatistics() const
+	{
+		const size_t amountOfTextures = GetAmountOfResidentTextures();
+		const size_t residentBytes = GetResidentBytes();
+
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		std::cout << "Textures: " << amountOfTextures << " resident (" << residentBytes / (1024 * 1024) << " MB), "
+			<< m_AmountOfRequests << " requests, " << m_AmountOfPathHits << " shared by path, "
+			<< m_AmountOfContentHits << " shared by content" << std::endl;
+	}
+
+	TextureHandle TextureManager::FindByContent(uint64_t hash, const Texture& texture) const
+	{
+		const auto range = m_TexturesByHash.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it) {
+			TextureHandle pTexture = it->second.lock();
+			if (pTexture && pTexture->HasSameTexels(texture)) {
+				return pTexture;
+			}
+		}
+		return nullptr;
+	}
+
+	void TextureManager::EraseExpired()
+	{
+		std::erase_if(m_TexturesByPath, [](const auto& texture) { return texture.second.expired(); });
+		std::erase_if(m_TexturesByHash, [](const auto& texture) { return texture.second.expired(); });
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "Texture.h"
+
+namespace dae
+{
+	//Shared ownership of a texture, the texture is deleted when the last mesh using it is
+	using TextureHandle = std::shared_ptr<Texture>;
+
+	//Hands out shared textures, a texture is only kept once per path and once per unique set of texels
+	//The manager itself doesn't keep textures alive, so unused textures are freed right away, their entries are erased by the next load
+	//Safe to call from several loading threads at once
+	class TextureManager final
+	{
+	public:
+		TextureManager() = default;
+		~TextureManager() = default;
+
+		//Rule of 5
+		TextureManager(const TextureManager&) = delete;
+		TextureManager(TextureManager&&) noexcept = delete;
+		TextureManager& operator=(const TextureManager&) = delete;
+		TextureManager& operator=(TextureManager&&) noexcept = delete;
+
+		//Returns the loaded texture for this path, or the loaded texture with the same texels as the file
+		TextureHandle Load(const std::string& path);
+
+		//Textures that are still in use
+		size_t GetAmountOfResidentTextures() const;
+		size_t GetResidentBytes() const;
+		void PrintStatistics() const;
+
+	private:
+		mutable std::mutex m_Mutex{};
+		std::unordered_map<std::string, std::weak_ptr<Texture>> m_TexturesByPath{};
+		//Several textures can share a hash, they are compared texel by texel
+		std::unordered_multimap<uint64_t, std::weak_ptr<Texture>> m_TexturesByHash{};
+
+		size_t m_AmountOfRequests{};
+		size_t m_AmountOfPathHits{};
+		size_t m_AmountOfContentHits{};
+
+		//Expects the mutex to be locked
+		TextureHandle FindByContent(uint64_t hash, const Texture& texture) const;
+		//Erases the entries of freed textures, expects the mutex to be locked
+		void EraseExpired();
+	};
+}
@@ -2,6 +2,7 @@
 #include <fstream>
 #include "Math.h"
 #include "DataTypes.h"
+#include "MathSIMD.h"
 
 namespace dae
 {
@@ -214,7 +215,37 @@ namespace dae
 			}
 
 			Vector3 pointToLightOrigin{ light->origin - target };
-			return light->color * light->intensity / pointToLightOrigin.SqrMagnitude();
+			const float sqrDistance = pointToLightOrigin.SqrMagnitude();
+			if (light->range <= 0.f) {
+				return light->color * light->intensity / sqrDistance;
+			}
+
+			//Windowed falloff so the light reaches exactly zero at its range
+			if (sqrDistance >= light->range * light->range) {
+				return colors::Black;
+			}
+			const float distanceRatio = sqrDistance / (light->range * light->range);
+			const float window = Square(Saturate(1.f - distanceRatio * distanceRatio));
+			return light->color * light->intensity * window / sqrDistance;
+		}
+
+		//Same as GetRadiance, for a batch of targets
+		inline ColorRGBN GetRadiance(const Light* light, const Vector3N& target)
+		{
+			const ColorRGBN lightColor = ColorRGBN::Broadcast(light->color * light->intensity);
+			if (light->type == LightType::Directional) {
+				return lightColor;
+			}
+
+			const FloatN sqrDistance = (Vector3N::Broadcast(light->origin) - target).SqrMagnitude();
+			if (light->range <= 0.f) {
+				return lightColor * (Broadcast(1.f) / sqrDistance);
+			}
+
+			//Windowed falloff so the light reaches exactly zero at its range
+			const FloatN distanceRatio = sqrDistance * Broadcast(1.f / (light->range * light->range));
+			const FloatN window = Saturate(Broadcast(1.f) - distanceRatio * distanceRatio);
+			return lightColor * (window * window / sqrDistance);
 		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,221 @@
+#include "pch.h"
+#include "VertexQuantization.h"
+#include <cstring> //memcpy
+
+using namespace dae;
+
+namespace
+{
+	constexpr float MaxUnorm16{ 65535.f };
+	constexpr float MaxSnorm16{ 32767.f };
+
+	float SignNotZero(float value)
+	{
+		return value >= 0.f ? 1.f : -1.f;
+	}
+
+	int16_t ToSnorm16(float value)
+	{
+		return static_cast<int16_t>(std::round(Clamp(value, -1.f, 1.f) * MaxSnorm16));
+	}
+
+	//Projects the unit vector on the octahedron and folds the lower half over the upper half, so it fits in two values
+	Vector2 EncodeOctahedral(const Vector3& v)
+	{
+		const float length = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+		if (length <= 0.f) {
+			return { 0.f, 0.f };
+		}
+		const float x = v.x / length;
+		const float y = v.y / length;
+		if (v.z >= 0.f) {
+			return { x, y };
+		}
+		return { (1.f - std::abs(y)) * SignNotZero(x), (1.f - std::abs(x)) * SignNotZero(y) };
+	}
+
+	Vector3 DecodeOctahedral(float x, float y)
+	{
+		Vector3 v{ x, y, 1.f - std::abs(x) - std::abs(y) };
+		//Unfold the lower half
+		const float fold = std::max(-v.z, 0.f);
+		v.x += v.x >= 0.f ? -fold : fold;
+		v.y += v.y >= 0.f ? -fold : fold;
+		return v.Normalized();
+	}
+
+	//Extent of every axis of the bounds per step of 1 in the quantized positions, 0 for flat axes
+	Vector3 GetPositionScale(const AABB& bounds)
+	{
+		const Vector3 extent = bounds.max - bounds.min;
+		return { extent.x / MaxUnorm16, extent.y / MaxUnorm16, extent.z / MaxUnorm16 };
+	}
+
+	uint16_t QuantizePositionAxis(float value, float min, float max)
+	{
+		if (max <= min) {
+			return 0;
+		}
+		return static_cast<uint16_t>(std::round(Clamp((value - min) / (max - min), 0.f, 1.f) * MaxUnorm16));
+	}
+
+	template<typename T>
+	T& AtStride(T* pFirst, size_t index, size_t stride)
+	{
+		return *reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(pFirst) + index * stride);
+	}
+}
+
+QuantizedVertex VertexQuantization::Encode(const Vertex_In& vertex, const AABB& bounds)
+{
+	QuantizedVertex quantizedVertex{};
+	quantizedVertex.position[0] = QuantizePositionAxis(vertex.position.x, bounds.min.x, bounds.max.x);
+	quantizedVertex.position[1] = QuantizePositionAxis(vertex.position.y, bounds.min.y, bounds.max.y);
+	quantizedVertex.position[2] = QuantizePositionAxis(vertex.position.z, bounds.min.z, bounds.max.z);
+
+	quantizedVertex.uv[0] = FloatToHalf(vertex.uv.x);
+	quantizedVertex.uv[1] = FloatToHalf(vertex.uv.y);
+
+	const Vector2 normal = EncodeOctahedral(vertex.normal);
+	quantizedVertex.normal[0] = ToSnorm16(normal.x);
+	quantizedVertex.normal[1] = ToSnorm16(normal.y);
+
+	const Vector2 tangent = EncodeOctahedral(vertex.tangent);
+	quantizedVertex.tangent[0] = ToSnorm16(tangent.x);
+	quantizedVertex.tangent[1] = ToSnorm16(tangent.y);
+	return quantizedVertex;
+}
+
+std::vector<QuantizedVertex> VertexQuantization::Encode(const std::vector<Vertex_In>& vertices, const AABB& bounds)
+{
+	std::vector<QuantizedVertex> quantizedVertices{};
+	quantizedVertices.reserve(vertices.size());
+	for (const Vertex_In& vertex : vertices) {
+		quantizedVertices.push_back(Encode(vertex, bounds));
+	}
+	return quantizedVertices;
+}
+
+Vertex_In VertexQuantization::Decode(const QuantizedVertex& vertex, const AABB& bounds)
+{
+	Vertex_In decodedVertex{};
+	DecodePositions(&vertex, &decodedVertex.position, 1, bounds);
+	DecodeUVs(&vertex, &decodedVertex.uv, 1);
+	DecodeNormals(&vertex, &decodedVertex.normal, 1);
+	DecodeTangents(&vertex, &decodedVertex.tangent, 1);
+	return decodedVertex;
+}
+
+std::vector<Vertex_In> VertexQuantization::Decode(const std::vector<QuantizedVertex>& vertices, const AABB& bounds)
+{
+	std::vector<Vertex_In> decodedVertices(vertices.size());
+	if (vertices.empty()) {
+		return decodedVertices;
+	}
+	DecodePositions(vertices.data(), &decodedVertices[0].position, vertices.size(), bounds, sizeof(Vertex_In));
+	DecodeUVs(vertices.data(), &decodedVertices[0].uv, vertices.size(), sizeof(Vertex_In));
+	DecodeNormals(vertices.data(), &decodedVertices[0].normal, vertices.size(), sizeof(Vertex_In));
+	DecodeTangents(vertices.data(), &decodedVertices[0].tangent, vertices.size(), sizeof(Vertex_In));
+	return decodedVertices;
+}
+
+void VertexQuantization::DecodePositions(const QuantizedVertex* pVertices, Vector3* pPositionsOut, size_t amountOfVertices, const AABB& bounds, size_t strideOut)
+{
+	const Vector3 scale = GetPositionScale(bounds);
+	for (size_t i{}; i < amountOfVertices; ++i) {
+		const QuantizedVertex& vertex = pVertices[i];
+		AtStride(pPositionsOut, i, strideOut) = Vector3{
+			bounds.min.x + static_cast<float>(vertex.position[0]) * scale.x,
+			bounds.min.y + static_cast<float>(vertex.position[1]) * scale.y,
+			bounds.min.z + static_cast<float>(vertex.position[2]) * scale.z };
+	}
+}
+
+void VertexQuantization::DecodeNormals(const QuantizedVertex* pVertices, Vector3* pNormalsOut, size_t amountOfVertices, size_t strideOut)
+{
+	for (size_t i{}; i < amountOfVertices; ++i) {
+		const QuantizedVertex& vertex = pVertices[i];
+		AtStride(pNormalsOut, i, strideOut) = DecodeOctahedral(vertex.normal[0] / MaxSnorm16, vertex.normal[1] / MaxSnorm16);
+	}
+}
+
+void VertexQuantization::DecodeTangents(const QuantizedVertex* pVertices, Vector3* pTangentsOut, size_t amountOfVertices, size_t strideOut)
+{
+	for (size_t i{}; i < amountOfVertices; ++i) {
+		const QuantizedVertex& vertex = pVertices[i];
+		AtStride(pTangentsOut, i, strideOut) = DecodeOctahedral(vertex.tangent[0] / MaxSnorm16, vertex.tangent[1] / MaxSnorm16);
+	}
+}
+
+void VertexQuantization::DecodeUVs(const QuantizedVertex* pVertices, Vector2* pUVsOut, size_t amountOfVertices, size_t strideOut)
+{
+	for (size_t i{}; i < amountOfVertices; ++i) {
+		const QuantizedVertex& vertex = pVertices[i];
+		AtStride(pUVsOut, i, strideOut) = Vector2{ HalfToFloat(vertex.uv[0]), HalfToFloat(vertex.uv[1]) };
+	}
+}
+
+uint16_t VertexQuantization::FloatToHalf(float value)
+{
+	uint32_t bits{};
+	std::memcpy(&bits, &value, sizeof(bits));
+	const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+	const uint32_t absoluteBits = bits & 0x7FFFFFFF;
+
+	//Infinity and NaN, NaN keeps a mantissa bit
+	if (absoluteBits >= 0x7F800000) {
+		return sign | 0x7C00 | (absoluteBits > 0x7F800000 ? 0x0200 : 0);
+	}
+	//Rounds to a value past the largest half
+	if (absoluteBits >= 0x477FF000) {
+		return sign | 0x7C00;
+	}
+	//Below the smallest normal half, in steps of 2^-24
+	if (absoluteBits < 0x38800000) {
+		float absoluteValue{};
+		std::memcpy(&absoluteValue, &absoluteBits, sizeof(absoluteValue));
+		return sign | static_cast<uint16_t>(std::nearbyint(absoluteValue * 16777216.f));
+	}
+	//Rebias the exponent from 127 to 15 and round the mantissa to nearest even
+	const uint32_t roundedBits = absoluteBits + 0x0FFF + ((absoluteBits >> 13) & 1);
+	return sign | static_cast<uint16_t>((roundedBits - 0x38000000) >> 13);
+}
+
+float VertexQuantization::HalfToFloat(uint16_t value)
+{
+	const uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+	const uint32_t exponent = (value >> 10) & 0x1F;
+	const uint32_t mantissa = value & 0x03FF;
+
+	if (exponent == 0) {
+		const float absoluteValue = static_cast<float>(mantissa) / 16777216.f;
+		return sign ? -absoluteValue : absoluteValue;
+	}
+
+	uint32_t bits{};
+	if (exponent == 0x1F) {
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else {
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+	float result{};
+	std::memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+void VertexQuantization::QuantizeMesh(Mesh& mesh)
+{
+	if (mesh.isQuantized) {
+		return;
+	}
+
+	//The levels only use positions of the full detail mesh, so they fit in the same bounds
+	mesh.quantizedVertices = Encode(mesh.vertices, mesh.localBox);
+	std::vector<Vertex_In>{}.swap(mesh.vertices);
+	for (MeshLOD& lod : mesh.lods) {
+		lod.quantizedVertices = Encode(lod.vertices, mesh.localBox);
+		std::vector<Vertex_In>{}.swap(lod.vertices);
+	}
+	mesh.isQuantized = true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <vector>
+#include "DataTypes.h"
+
+//Compact vertex format for large meshes, see QuantizedVertex
+//Positions are 16 bit fractions of the bounds of the mesh, normals and tangents are octahedral encoded and UVs are half floats
+//The decode functions are what the world space cache runs, they write straight into bigger vertex structs through a stride
+//The cache keeps the decoded vertices of the drawn instances as floats, so quantizing only saves memory of the meshes, not time
+namespace VertexQuantization
+{
+	QuantizedVertex Encode(const Vertex_In& vertex, const dae::AABB& bounds);
+	std::vector<QuantizedVertex> Encode(const std::vector<Vertex_In>& vertices, const dae::AABB& bounds);
+	Vertex_In Decode(const QuantizedVertex& vertex, const dae::AABB& bounds);
+	std::vector<Vertex_In> Decode(const std::vector<QuantizedVertex>& vertices, const dae::AABB& bounds);
+
+	//Batched decoding of one attribute, strideOut is the distance in bytes between two outputs
+	void DecodePositions(const QuantizedVertex* pVertices, dae::Vector3* pPositionsOut, size_t amountOfVertices, const dae::AABB& bounds, size_t strideOut = sizeof(dae::Vector3));
+	void DecodeNormals(const QuantizedVertex* pVertices, dae::Vector3* pNormalsOut, size_t amountOfVertices, size_t strideOut = sizeof(dae::Vector3));
+	void DecodeTangents(const QuantizedVertex* pVertices, dae::Vector3* pTangentsOut, size_t amountOfVertices, size_t strideOut = sizeof(dae::Vector3));
+	void DecodeUVs(const QuantizedVertex* pVertices, dae::Vector2* pUVsOut, size_t amountOfVertices, size_t strideOut = sizeof(dae::Vector2));
+
+	uint16_t FloatToHalf(float value);
+	float HalfToFloat(uint16_t value);
+
+	//Replaces the vertices of the mesh and of all its levels of detail with quantized ones
+	//The levels have to be built first, the simplifier works on the full precision vertices
+	void QuantizeMesh(Mesh& mesh);
+}
@@ -0,0 +1,85 @@
+#include "pch.h"
+#include "WorldSpaceCache.h"
+#include "VertexQuantization.h"
+
+WorldSpaceCache::MeshEntries& WorldSpaceCache::PrepareMesh(const Mesh* pMesh)
+{
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	MeshEntries& meshEntries = m_EntriesByMesh[pMesh];
+	//The levels of a mesh are made when it is loaded, other renderers may already read the entries after that
+	if (meshEntries.amountOfLODs == 0) {
+		meshEntries.amountOfLODs = pMesh->GetAmountOfLODs();
+	}
+
+	//Instances are only added between frames, so every renderer of a frame sees the same amount
+	//The entries of a frame are made before any renderer reads them, a deque keeps the old entries in place while it grows
+	const size_t amountOfEntries = pMesh->instances.size() * meshEntries.amountOfLODs;
+	while (meshEntries.entries.size() < amountOfEntries) {
+		meshEntries.entries.emplace_back();
+	}
+	return meshEntries;
+}
+
+const std::vector<WorldVertex>& WorldSpaceCache::GetVertices(MeshEntries& meshEntries, const Mesh* pMesh, uint32_t instanceIndex, uint32_t lod)
+{
+	const MeshInstance& instance = pMesh->instances[instanceIndex];
+	Entry& entry = meshEntries.entries[instanceIndex * meshEntries.amountOfLODs + lod];
+
+	//The first renderer to need the vertices transforms them, the others wait for it and reuse them
+	std::lock_guard<std::mutex> lock{ entry.mutex };
+	if (entry.isValid && entry.worldVersion == instance.worldVersion) {
+		++m_AmountOfReuses;
+		return entry.vertices;
+	}
+
+	const Matrix& worldMatrix = instance.worldMatrix;
+	if (pMesh->isQuantized) {
+		//Decoded into the cached vertices first, then transformed in place
+		const std::vector<QuantizedVertex>& quantizedVertices = pMesh->GetQuantizedVertices(lod);
+		entry.vertices.resize(quantizedVertices.size());
+		if (!quantizedVertices.empty()) {
+			const size_t amountOfVertices = quantizedVertices.size();
+			VertexQuantization::DecodePositions(quantizedVertices.data(), &entry.vertices[0].position, amountOfVertices, pMesh->localBox, sizeof(WorldVertex));
+			VertexQuantization::DecodeNormals(quantizedVertices.data(), &entry.vertices[0].normal, amountOfVertices, sizeof(WorldVertex));
+			VertexQuantization::DecodeTangents(quantizedVertices.data(), &entry.vertices[0].tangent, amountOfVertices, sizeof(WorldVertex));
+			worldMatrix.TransformPoints(&entry.vertices[0].position, &entry.vertices[0].position, amountOfVertices, sizeof(WorldVertex), sizeof(WorldVertex));
+			worldMatrix.TransformVectors(&entry.vertices[0].normal, &entry.vertices[0].normal, amountOfVertices, sizeof(WorldVertex), sizeof(WorldVertex));
+			worldMatrix.TransformVectors(&entry.vertices[0].tangent, &entry.vertices[0].tangent, amountOfVertices, sizeof(WorldVertex), sizeof(WorldVertex));
+		}
+	}
+	else {
+		const std::vector<Vertex_In>& vertices = pMesh->GetVertices(lod);
+		entry.vertices.resize(vertices.size());
+		if (!vertices.empty()) {
+			//Batched straight from the members of the input vertices into the members of the cached vertices
+			worldMatrix.TransformPoints(&vertices[0].position, &entry.vertices[0].position, vertices.size(), sizeof(Vertex_In), sizeof(WorldVertex));
+			worldMatrix.TransformVectors(&vertices[0].normal, &entry.vertices[0].normal, vertices.size(), sizeof(Vertex_In), sizeof(WorldVertex));
+			worldMatrix.TransformVectors(&vertices[0].tangent, &entry.vertices[0].tangent, vertices.size(), sizeof(Vertex_In), sizeof(WorldVertex));
+		}
+	}
+	//normalize the normals in world space again
+	for (WorldVertex& worldVertex : entry.vertices) {
+		worldVertex.normal.Normalize();
+		worldVertex.tangent.Normalize();
+	}
+	entry.worldVersion = instance.worldVersion;
+	entry.isValid = true;
+	++m_AmountOfTransforms;
+	return entry.vertices;
+}
+
+uint64_t WorldSpaceCache::GetAmountOfTransforms() const
+{
+	return m_AmountOfTransforms;
+}
+
+uint64_t WorldSpaceCache::GetAmountOfReuses() const
+{
+	return m_AmountOfReuses;
+}
+
+void WorldSpaceCache::ResetStatistics()
+{
+	m_AmountOfTransforms = 0;
+	m_AmountOfReuses = 0;
+}
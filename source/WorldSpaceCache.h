@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "DataTypes.h"
+
+//World space vertices of the instances, shared by every renderer that draws the same meshes
+//An instance has its own vertices for every level of detail it is drawn at, they are only transformed again when the instance moved
+//Several renderers can use it at once, as long as no instance moves while they render
+//Quantized meshes are decoded here as well, only when the instance moved, the UVs are decoded by the vertex stage
+//The meshes have to outlive the cache
+class WorldSpaceCache final
+{
+public:
+	//World space vertices of one level of detail of one instance
+	struct Entry
+	{
+		//Only held while the vertices are checked and transformed
+		std::mutex mutex{};
+		std::vector<WorldVertex> vertices{};
+		uint32_t worldVersion{};
+		bool isValid{};
+	};
+
+	//Entries of every instance of a mesh, instance i uses the entries from i * amountOfLODs
+	struct MeshEntries
+	{
+		std::deque<Entry> entries{};
+		uint32_t amountOfLODs{};
+	};
+
+	WorldSpaceCache() = default;
+	~WorldSpaceCache() = default;
+
+	//Rule of 5
+	WorldSpaceCache(const WorldSpaceCache&) = delete;
+	WorldSpaceCache(WorldSpaceCache&&) noexcept = delete;
+	WorldSpaceCache& operator=(const WorldSpaceCache&) = delete;
+	WorldSpaceCache& operator=(WorldSpaceCache&&) noexcept = delete;
+
+	//Makes room for every instance of the mesh, call it before GetVertices in every frame
+	MeshEntries& PrepareMesh(const Mesh* pMesh);
+	//Transforms the vertices when they aren't up to date with the world matrix of the instance
+	const std::vector<WorldVertex>& GetVertices(MeshEntries& meshEntries, const Mesh* pMesh, uint32_t instanceIndex, uint32_t lod);
+
+	//How often vertices were transformed and how often transformed vertices were reused, since the last reset
+	uint64_t GetAmountOfTransforms() const;
+	uint64_t GetAmountOfReuses() const;
+	void ResetStatistics();
+
+private:
+	std::mutex m_Mutex{};
+	std::unordered_map<const Mesh*, MeshEntries> m_EntriesByMesh{};
+
+	std::atomic<uint64_t> m_AmountOfTransforms{};
+	std::atomic<uint64_t> m_AmountOfReuses{};
+};
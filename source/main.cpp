@@ -7,6 +7,12 @@
 #undef main
 #include "RenderManager.h"
 #include "Timer.h"
+#include "FrameStream.h"
+#include "FrameTelemetry.h"
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
 
 using namespace dae;
 
@@ -16,11 +22,117 @@ void ShutDown(SDL_Window* pWindow)
 	SDL_Quit();
 }
 
+//Prints the averages of the frame statistics another process publishes, once per second until that process stops
+int RunTelemetryMonitor(const std::string& name)
+{
+	FrameTelemetryReader reader{ name };
+	if (reader.HasFailed()) {
+		std::cout << "Frame telemetry: nothing is published as " << name << std::endl;
+		return 1;
+	}
+
+	std::vector<FrameStatistics> records{};
+	uint64_t amountOfMissedRecords{};
+	auto printTime = std::chrono::steady_clock::now();
+	while (!reader.IsWriterClosed()) {
+		//The ring holds many frames, so polling now and then is enough
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		amountOfMissedRecords += reader.ReadNew(records);
+		if (std::chrono::steady_clock::now() - printTime < std::chrono::seconds(1)) {
+			continue;
+		}
+		printTime = std::chrono::steady_clock::now();
+
+		FrameStatistics average{};
+		uint32_t amountOfDrawnFrames{};
+		for (const FrameStatistics& record : records) {
+			if (record.wasFrameSkipped) {
+				continue;
+			}
+			++amountOfDrawnFrames;
+			average.frameTimeMs += record.frameTimeMs;
+			average.geometryMs += record.geometryMs;
+			average.rasterMs += record.rasterMs;
+			average.shadowMs += record.shadowMs;
+			average.lightCullMs += record.lightCullMs;
+			average.shadeMs += record.shadeMs;
+			average.transparentMs += record.transparentMs;
+			average.threadUtilization += record.threadUtilization;
+			average.amountOfTriangles = record.amountOfTriangles;
+			average.amountOfShadedPixels = record.amountOfShadedPixels;
+		}
+		if (amountOfDrawnFrames > 0) {
+			const float scale = 1.f / static_cast<float>(amountOfDrawnFrames);
+			std::cout << amountOfDrawnFrames << " frames, " << average.frameTimeMs * scale << " ms:"
+				<< " geometry " << average.geometryMs * scale
+				<< " raster " << average.rasterMs * scale
+				<< " shadow " << average.shadowMs * scale
+				<< " lights " << average.lightCullMs * scale
+				<< " shade " << average.shadeMs * scale
+				<< " transparent " << average.transparentMs * scale
+				<< ", threads busy " << static_cast<int>(average.threadUtilization * scale * 100.f) << "%"
+				<< ", last frame " << average.amountOfTriangles << " triangles " << average.amountOfShadedPixels << " pixels";
+		}
+		else {
+			std::cout << "No frames drawn";
+		}
+		std::cout << ", " << amountOfMissedRecords << " missed" << std::endl;
+		records.clear();
+		amountOfMissedRecords = 0;
+	}
+	return 0;
+}
+
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
+	//Trailing options of every mode that opens a window, in any order
+	//--quantize-vertices stores the meshes as quantized vertices
+	//--triangle-strips draws the opaque meshes in software from triangle strips
+	//--telemetry publishes the statistics of every software frame in shared memory, read them with --telemetry-monitor
+	bool quantizeVertices{};
+	bool useTriangleStrips{};
+	bool publishTelemetry{};
+	while (argc > 1) {
+		const std::string option = args[argc - 1];
+		if (option == "--quantize-vertices") {
+			quantizeVertices = true;
+		}
+		else if (option == "--triangle-strips") {
+			useTriangleStrips = true;
+		}
+		else if (option == "--telemetry") {
+			publishTelemetry = true;
+		}
+		else {
+			break;
+		}
+		--argc;
+	}
+
+	const std::string mode = argc > 1 ? args[1] : "";
+
+	//Reads the telemetry of a renderer in another process, without a window
+	//--telemetry-monitor [name]
+	if (mode == "--telemetry-monitor") {
+		return RunTelemetryMonitor(argc > 2 ? args[2] : FrameTelemetry::Settings{}.name);
+	}
+
+	//Streams every software frame to a file or named pipe for an encoder, like ffmpeg -i pipe.y4m
+	//--stream <path> [y4m|rgba] [frames per second]
+	const bool isStreaming = mode == "--stream" && argc > 2;
+	FrameStream::Settings streamSettings{};
+	if (isStreaming && argc > 3 && std::string(args[3]) == "rgba") {
+		streamSettings.format = FrameStream::Format::RawRGBA;
+	}
+	if (isStreaming && argc > 4) {
+		char* pEnd{};
+		const long framesPerSecond = std::strtol(args[4], &pEnd, 10);
+		if (pEnd == args[4] || *pEnd != '\0' || framesPerSecond < 1 || framesPerSecond > 1000) {
+			std::cout << "Usage: --stream <path> [y4m|rgba] [frames per second, 1 to 1000]" << std::endl;
+			return 1;
+		}
+		streamSettings.framesPerSecond = static_cast<int>(framesPerSecond);
+	}
 
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
@@ -39,7 +151,24 @@ int main(int argc, char* args[])
 
 	//Initialize "framework"
 	const auto pTimer = new dae::Timer();
-	const auto pRenderManager = new RenderManager(pWindow);
+	const auto pRenderManager = new RenderManager(pWindow, quantizeVertices, useTriangleStrips);
+
+	FrameStream* pFrameStream{};
+	if (isStreaming) {
+		pFrameStream = new FrameStream(args[2], static_cast<int>(width), static_cast<int>(height), streamSettings);
+	}
+	//Time the video is behind the timer, it starts a frame behind so the first image is pushed right away
+	const float streamFrameTime = 1.f / static_cast<float>(streamSettings.framesPerSecond);
+	float streamTimer = streamFrameTime;
+
+	//Unlike the dFPS print it never waits on a console, monitoring tools read it at their own rate
+	FrameTelemetry* pFrameTelemetry{};
+	if (publishTelemetry) {
+		pFrameTelemetry = new FrameTelemetry(FrameTelemetry::Settings{});
+		if (!pFrameTelemetry->HasFailed()) {
+			std::cout << "Frame telemetry published as " << pFrameTelemetry->GetName() << std::endl;
+		}
+	}
 
 	//Start loop
 	pTimer->Start();
@@ -56,6 +185,11 @@ int main(int argc, char* args[])
 			case SDL_QUIT:
 				isLooping = false;
 				break;
+			case SDL_WINDOWEVENT:
+				if (e.window.event == SDL_WINDOWEVENT_EXPOSED) {
+					pRenderManager->InvalidateFrame();
+				}
+				break;
 			case SDL_KEYUP:
 				//Test for a key
 				if (e.key.keysym.scancode == SDL_SCANCODE_F1) {
@@ -102,6 +236,18 @@ int main(int argc, char* args[])
 					//Toggle print FPW
 					pRenderManager->TogglePrintFPW();
 				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_T) {
+					//Toggle software temporal cache
+					pRenderManager->ToggleTemporalCache();
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_Y) {
+					//Toggle software shadows
+					pRenderManager->ToggleShadows();
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_U) {
+					//Cycle software shadow filter size
+					pRenderManager->CycleShadowFilterSize();
+				}
 				break;
 			default: ;
 			}
@@ -112,20 +258,48 @@ int main(int argc, char* args[])
 
 		//--------- Render ---------
 		pRenderManager->Render();
+		if (pFrameTelemetry && pRenderManager->GetRenderType() == RenderManager::RenderType::Software) {
+			pFrameTelemetry->Publish(pRenderManager->GetSoftwareRenderer()->GetFrameStatistics());
+		}
+		//Nothing changed, sleep until there is input instead of spinning
+		if (pRenderManager->WasFrameSkipped()) {
+			SDL_WaitEventTimeout(nullptr, 100);
+		}
 
 		//--------- Timer ---------
 		pTimer->Update();
+
+		//Every video frame that started since the last push gets the newest image, so the video plays at the rate of its header
+		//Slow frames are pushed once and repeated by the writer, fast ones are left out, pushes that find every buffer waiting are dropped and counted
+		if (pFrameStream && pRenderManager->GetRenderType() == RenderManager::RenderType::Software) {
+			streamTimer += pTimer->GetElapsed();
+			const uint32_t amountOfVideoFrames = static_cast<uint32_t>(streamTimer / streamFrameTime);
+			if (amountOfVideoFrames > 0) {
+				pFrameStream->PushFrame(pRenderManager->GetSoftwareRenderer()->GetPixels(), amountOfVideoFrames);
+				streamTimer -= static_cast<float>(amountOfVideoFrames) * streamFrameTime;
+			}
+		}
 		if (pRenderManager->CanPrintFPW()) {
 			printTimer += pTimer->GetElapsed();
 			if (printTimer >= 1.f)
 			{
 				printTimer = 0.f;
 				std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+				pRenderManager->PrintFrameStatistics();
 			}
 		}	
 	}
 	pTimer->Stop();
 
+	if (pFrameStream) {
+		//Waits for the queued frames to be written
+		delete pFrameStream;
+		pFrameStream = nullptr;
+	}
+	//Monitors see that the renderer stopped
+	delete pFrameTelemetry;
+	pFrameTelemetry = nullptr;
+
 	//Shutdown "framework"
 	delete pRenderManager;
 	delete pTimer;
@@ -5,6 +5,9 @@
 #include <algorithm>
 #include <sstream>
 #include <memory>
+
+//The software renderer library is built without a window and without DirectX
+#if !defined(DAE_SOFTWARE_ONLY)
 #define NOMINMAX  //for directx
 
 // SDL Headers
@@ -18,6 +21,7 @@
 #include <d3d11.h>
 #include <d3dcompiler.h>
 #include <d3dx11effect.h>
+#endif
 
 // Framework Headers
 #include "Timer.h"